@@ -0,0 +1,268 @@
+/** @file
+    Print the records of a CBOR output as JSON, or check the CBOR round trip.
+
+    cbor_dump [FILE...]   print every record of the files (default stdin) as one JSON line
+    cbor_dump -t [COUNT]  write random events as CBOR, read them back and compare
+                          them with the originals, through the JSON printer and bitwise
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "data.h"
+#include "data_printer_cbor.h"
+#include "data_printer_json.h"
+#include "data_printer_jsonstr.h"
+
+#define JSON_BUFLEN 65536
+
+static int dump_file(FILE *file, char const *name, data_output_t *json)
+{
+    data_t *data;
+    int r;
+    while ((r = data_cbor_read(file, &data)) > 0) {
+        data_output_print(json, data);
+        data_free(data);
+    }
+    if (r < 0)
+        fprintf(stderr, "%s: invalid CBOR record.\n", name);
+    return r;
+}
+
+/* round trip check */
+
+static unsigned rnd_state = 1;
+
+static unsigned rnd(unsigned n)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return (rnd_state >> 8) % n;
+}
+
+static char const *const rnd_keys[] = {"model", "id", "channel", "temperature_C", "humidity", "codes", "rows", "mic", "len", "data"};
+
+static char *rnd_string(char *buf)
+{
+    static char const chars[] = "abcXYZ019 _-\"\\/\t\n";
+    int len = rnd(12);
+    for (int i = 0; i < len; ++i)
+        buf[i] = chars[rnd(sizeof(chars) - 1)];
+    buf[len] = '\0';
+    return buf;
+}
+
+static int rnd_int(void)
+{
+    switch (rnd(4)) {
+    case 0: return rnd(24);
+    case 1: return -(int)rnd(1000);
+    case 2: return (int)(rnd(1 << 24) << 7);
+    default: return -(int)(rnd(1 << 24) << 7) - 1;
+    }
+}
+
+static double rnd_double(void)
+{
+    switch (rnd(3)) {
+    case 0: return (int)rnd(2000) / 8.0 - 100.0; // exact as a float
+    case 1: return (int)rnd(2000000) / 1000.0 - 1000.0;
+    default: return ldexp(rnd(1 << 24) + 1, (int)rnd(200) - 100);
+    }
+}
+
+static data_t *rnd_data(int depth);
+
+static data_array_t *rnd_array(int depth)
+{
+    int num_values = rnd(6);
+    char strings[6][16];
+    char *string_ptrs[6];
+    int ints[6];
+    double doubles[6];
+    data_t *datas[6];
+
+    switch (rnd(depth > 0 ? 4 : 3)) {
+    case 0:
+        for (int i = 0; i < num_values; ++i)
+            ints[i] = rnd_int();
+        return data_array(num_values, DATA_INT, ints);
+    case 1:
+        for (int i = 0; i < num_values; ++i)
+            doubles[i] = rnd_double();
+        return data_array(num_values, DATA_DOUBLE, doubles);
+    case 2:
+        for (int i = 0; i < num_values; ++i)
+            string_ptrs[i] = rnd_string(strings[i]);
+        return data_array(num_values, DATA_STRING, string_ptrs);
+    default:
+        for (int i = 0; i < num_values; ++i)
+            datas[i] = rnd_data(depth - 1);
+        return data_array(num_values, DATA_DATA, datas);
+    }
+}
+
+static data_t *rnd_data(int depth)
+{
+    data_t *data = NULL;
+    char buf[16];
+    int num_keys = 1 + rnd(8);
+    for (int i = 0; i < num_keys; ++i) {
+        char const *key = rnd_keys[rnd(sizeof(rnd_keys) / sizeof(*rnd_keys))];
+        switch (rnd(depth > 0 ? 5 : 3)) {
+        case 0: data = data_append(data, key, "", DATA_INT, rnd_int(), NULL); break;
+        case 1: data = data_append(data, key, "", DATA_DOUBLE, rnd_double(), NULL); break;
+        case 2: data = data_append(data, key, "", DATA_STRING, rnd_string(buf), NULL); break;
+        case 3: data = data_append(data, key, "", DATA_DATA, rnd_data(depth - 1), NULL); break;
+        default: data = data_append(data, key, "", DATA_ARRAY, rnd_array(depth - 1), NULL); break;
+        }
+    }
+    return data;
+}
+
+static int data_equal(data_t const *a, data_t const *b);
+
+static int value_equal(data_type_t type, void const *a, void const *b)
+{
+    switch (type) {
+    case DATA_DATA:
+        return data_equal(a, b);
+    case DATA_INT:
+        return *(int const *)a == *(int const *)b;
+    case DATA_DOUBLE:
+        return !memcmp(a, b, sizeof(double));
+    case DATA_STRING:
+        return !strcmp(a, b);
+    case DATA_ARRAY: {
+        data_array_t const *x = a;
+        data_array_t const *y = b;
+        if (x->num_values != y->num_values)
+            return 0;
+        if (x->type != y->type && x->num_values)
+            return 0; // an empty array has no element type in CBOR
+        for (int i = 0; i < x->num_values; ++i) {
+            int equal;
+            if (x->type == DATA_INT)
+                equal = value_equal(DATA_INT, (int const *)x->values + i, (int const *)y->values + i);
+            else if (x->type == DATA_DOUBLE)
+                equal = value_equal(DATA_DOUBLE, (double const *)x->values + i, (double const *)y->values + i);
+            else
+                equal = value_equal(x->type, ((void *const *)x->values)[i], ((void *const *)y->values)[i]);
+            if (!equal)
+                return 0;
+        }
+        return 1;
+    }
+    default:
+        return 0;
+    }
+}
+
+static int data_equal(data_t const *a, data_t const *b)
+{
+    for (; a && b; a = a->next, b = b->next) {
+        if (a->type != b->type || strcmp(a->key, b->key) || !value_equal(a->type, a->value, b->value))
+            return 0;
+    }
+    return !a && !b;
+}
+
+static int round_trip(unsigned count)
+{
+    FILE *file = tmpfile();
+    if (!file) {
+        perror("tmpfile");
+        return 1;
+    }
+    data_output_t *cbor = data_output_cbor_create(file);
+    data_t **events = calloc(count, sizeof(*events));
+    char *json_a = malloc(JSON_BUFLEN);
+    char *json_b = malloc(JSON_BUFLEN);
+    if (!cbor || !events || !json_a || !json_b) {
+        fprintf(stderr, "cbor_dump: out of memory.\n");
+        return 1;
+    }
+
+    long json_size = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        events[i] = rnd_data(3);
+        data_output_print(cbor, events[i]);
+        json_size += (long)data_print_jsons(events[i], json_a, JSON_BUFLEN);
+    }
+    long cbor_size = ftell(file);
+    rewind(file);
+
+    unsigned json_diff = 0, value_diff = 0, read = 0;
+    data_t *data;
+    while (read < count && data_cbor_read(file, &data) > 0) {
+        data_print_jsons(events[read], json_a, JSON_BUFLEN);
+        data_print_jsons(data, json_b, JSON_BUFLEN);
+        if (strcmp(json_a, json_b)) {
+            if (!json_diff)
+                fprintf(stderr, "first JSON difference at event %u:\n%s\n%s\n", read, json_a, json_b);
+            json_diff++;
+        }
+        value_diff += !data_equal(events[read], data);
+        data_free(data);
+        data_free(events[read]);
+        read++;
+    }
+    for (unsigned i = read; i < count; ++i)
+        data_free(events[i]);
+
+    printf("%u events, %u read back, %u differ in JSON, %u differ in value, CBOR is %.0f%% of the JSON size\n",
+            count, read, json_diff, value_diff, json_size ? 100.0 * cbor_size / json_size : 0.0);
+
+    data_output_free(cbor); // closes the file
+    free(events);
+    free(json_a);
+    free(json_b);
+    return read != count || json_diff || value_diff;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-t"))
+        return round_trip(argc > 2 ? (unsigned)atoi(argv[2]) : 10000);
+    if (argc > 1 && argv[1][0] == '-' && argv[1][1]) {
+        fprintf(stderr, "Usage: %s [FILE...]\n       %s -t [COUNT]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    data_output_t *json = data_output_json_create(stdout);
+    if (!json)
+        return 1;
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    int r = 0;
+    if (argc < 2)
+        r = dump_file(stdin, "stdin", json) < 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-")) {
+            r |= dump_file(stdin, "stdin", json) < 0;
+            continue;
+        }
+        FILE *file = fopen(argv[i], "rb");
+        if (!file) {
+            perror(argv[i]);
+            r = 1;
+            continue;
+        }
+        r |= dump_file(file, argv[i], json) < 0;
+        fclose(file);
+    }
+    data_output_free(json);
+    return r;
+}
@@ -24,6 +24,26 @@
 */
 void envelope_detect(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
 
+/// Implementations of the envelope and magnitude kernels.
+typedef enum {
+    BASEBAND_IMPL_SCALAR = 0, ///< plain C reference
+    BASEBAND_IMPL_SSE2   = 1,
+    BASEBAND_IMPL_AVX2   = 2,
+    BASEBAND_IMPL_NEON   = 3,
+} baseband_impl_t;
+
+/** Select the envelope, magnitude and FM discriminator kernels for this CPU.
+
+    Called by baseband_init(), all implementations give bit-identical output,
+    except the CS16 FM discriminator which may be off by 1 LSB (float division).
+    @param force_scalar: use the plain C reference kernels (e.g. for verification)
+    @return the selected implementation
+*/
+baseband_impl_t baseband_select_impl(int force_scalar);
+
+/// Name of a kernel implementation, e.g. "AVX2".
+char const *baseband_impl_name(baseband_impl_t impl);
+
 // for evaluation
 void envelope_detect_nolut(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
 void magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
@@ -57,7 +77,8 @@ void baseband_low_pass_filter(uint16_t const *x_buf, int16_t *y_buf, uint32_t le
 
 /** FM demodulator.
 
-    Function is stateful
+    Function is stateful. The discriminator runs vectorized over tiles of
+    samples, then the low pass filter; output is identical to the scalar loop.
     @param x_buf: input samples (I/Q samples in interleaved uint8)
     @param[out] y_buf: output from FM demodulator
     @param len: number of samples to process
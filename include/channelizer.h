@@ -0,0 +1,50 @@
+/** @file
+    Channelizer: split one wideband IQ capture into narrowband channels.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_CHANNELIZER_H_
+#define INCLUDE_CHANNELIZER_H_
+
+#include <stdint.h>
+
+#define CHANNELIZER_MIN_RATE 250000 ///< Minimum channel sample rate for automatic decimation.
+#define CHANNELIZER_TAPS_PER_PHASE 8 ///< FIR taps per polyphase branch.
+
+typedef struct channelizer channelizer_t;
+
+/** Create a channelizer.
+
+    Each channel is shifted to baseband by a NCO and low pass filtered and
+    decimated by a polyphase FIR, only every decimation-th output is computed.
+    Channel offsets need not be on a uniform grid.
+
+    @param samp_rate: sample rate of the wideband capture
+    @param offsets_hz: channel center frequencies relative to the capture center
+    @param num_channels: number of channels
+    @param decimation: decimation factor, 0 for automatic (at least CHANNELIZER_MIN_RATE per channel)
+    @return the channelizer or NULL if a channel does not fit into the capture bandwidth
+*/
+channelizer_t *channelizer_create(uint32_t samp_rate, int32_t const *offsets_hz, unsigned num_channels, unsigned decimation);
+
+void channelizer_free(channelizer_t *ch);
+
+/// Decimation factor in use.
+unsigned channelizer_decimation(channelizer_t const *ch);
+
+/** Process a block of wideband samples.
+
+    Function is stateful, blocks of any length can be fed.
+    @param iq_buf: input samples (interleaved CU8 or CS16)
+    @param sample_size: 1 for CU8, 2 for CS16
+    @param n_samples: number of input samples
+    @param[out] out: one buffer per channel for at least n_samples / decimation + 1 CS16 samples
+    @return number of samples written to each channel buffer
+*/
+unsigned long channelizer_process(channelizer_t *ch, void const *iq_buf, int sample_size, unsigned long n_samples, int16_t **out);
+
+#endif /* INCLUDE_CHANNELIZER_H_ */
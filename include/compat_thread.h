@@ -0,0 +1,72 @@
+/** @file
+    compat_thread addresses compatibility thread functions.
+
+    topic: threads, mutexes and condition variables
+    issue: pthreads are not available on Windows systems
+    solution: provide a minimal common interface for pthreads and Win32 threads
+*/
+
+#ifndef INCLUDE_COMPAT_THREAD_H_
+#define INCLUDE_COMPAT_THREAD_H_
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION mutex_t;
+typedef CONDITION_VARIABLE cond_t;
+#define THREAD_RETURN DWORD
+#define THREAD_CALL WINAPI
+#else
+#include <pthread.h>
+typedef pthread_t thread_t;
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+#define THREAD_RETURN void *
+#define THREAD_CALL
+#endif
+
+typedef THREAD_RETURN (THREAD_CALL *thread_func_t)(void *arg);
+
+/// Start a thread, returns 0 on success.
+int thread_start(thread_t *thread, thread_func_t fn, void *arg);
+void thread_join(thread_t thread);
+/// Pin a thread to one CPU, returns 0 on success or -1 if not supported.
+int thread_set_affinity(thread_t thread, unsigned cpu);
+/// Number of online CPUs, at least 1.
+unsigned thread_num_cpus(void);
+
+void mutex_init(mutex_t *mutex);
+void mutex_destroy(mutex_t *mutex);
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+
+/// Load with acquire semantics, pairs with compat_store_release() for lock-free handoff.
+unsigned compat_load_acquire(unsigned const volatile *ptr);
+/// Store with release semantics, earlier writes are visible to a compat_load_acquire() seeing the value.
+void compat_store_release(unsigned volatile *ptr, unsigned val);
+/// Atomic add, returns the previous value.
+unsigned compat_fetch_add(unsigned volatile *ptr, unsigned val);
+/// Atomic subtract, returns the previous value.
+unsigned compat_fetch_sub(unsigned volatile *ptr, unsigned val);
+/// Atomic exchange, returns the previous value.
+unsigned compat_exchange(unsigned volatile *ptr, unsigned val);
+/// 64-bit load with acquire semantics, never torn on 32-bit targets.
+uint64_t compat_load_acquire64(uint64_t const volatile *ptr);
+/// 64-bit store with release semantics, never torn on 32-bit targets.
+void compat_store_release64(uint64_t volatile *ptr, uint64_t val);
+/// 64-bit atomic add, returns the previous value.
+uint64_t compat_fetch_add64(uint64_t volatile *ptr, uint64_t val);
+/// Pointer load with acquire semantics.
+void *compat_load_acquire_ptr(void *const volatile *ptr);
+/// Atomically replace @p expected by @p desired, returns 1 on success.
+int compat_cas_ptr(void *volatile *ptr, void *expected, void *desired);
+
+void cond_init(cond_t *cond);
+void cond_destroy(cond_t *cond);
+void cond_wait(cond_t *cond, mutex_t *mutex);
+void cond_signal(cond_t *cond);
+void cond_broadcast(cond_t *cond);
+
+#endif  /* INCLUDE_COMPAT_THREAD_H_ */
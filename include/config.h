@@ -2,6 +2,7 @@
 #define RTL_433_CONFIG_H
 
 #include "list.h"
+#include "output_queue.h"
 
 #define MAX_GAINSTR_LEN 100
 #define MAX_SDRSET_LEN 100
@@ -38,6 +39,7 @@ typedef enum {
 #define OVR_SUBJ_DEC_KV   4  // allows to overwrite files with decoded output in KV format
 #define OVR_SUBJ_DEC_CSV  8  // allows to overwrite files with decoded output in CSV format
 #define OVR_SUBJ_DEC_JSON 16 // allows to overwrite files with decoded output in JSON format
+#define OVR_SUBJ_DEC_CBOR 32 // allows to overwrite files with decoded output in CBOR format
 
 // valid bits for outputs_configured mask:
 #define OUTPUT_KV     1 // textual key value output
@@ -45,6 +47,7 @@ typedef enum {
 #define OUTPUT_JSON   4 // JSON output
 #define OUTPUT_UDP    8 // syslog output
 #define OUTPUT_MQTT  16 // syslog output
+#define OUTPUT_CBOR  32 // length prefixed CBOR output
 #define OUTPUT_EXT  128 // extended output to external callback
 
 typedef struct r_cfg { // following explanations contain the former command line switches in brackets
@@ -56,6 +59,8 @@ typedef struct r_cfg { // following explanations contain the former command line
     int frequencies;                                    ///< [-f] number of target frequencies.
     int hop_times;                                      
     int hop_time[MAX_FREQS];                            ///< [-H] Hop intervals for polling of multiple frequencies.
+    int channelize;                                     ///< 1 to receive all [-f] frequencies at once from one wideband capture instead of hopping.
+    uint32_t channel_decimation;                        ///< Channelizer decimation (0 = auto, at least 250 kS/s per channel).
     int ppm_error;                                      ///< [-p] Correct rtl-sdr tuner frequency offset error.
     uint32_t samp_rate;                                 ///< [-s] Sample rate.
     uint32_t out_block_size;                            ///< [-b] Output block size for RTL-SDR.
@@ -77,6 +82,7 @@ typedef struct r_cfg { // following explanations contain the former command line
     char output_path_csv[MAX_PATHLEN];                  ///< [-F] target file for CSV output.
     char output_path_json[MAX_PATHLEN];                 ///< [-F] target file for JSON output.
     char output_path_kv[MAX_PATHLEN];                   ///< [-F] target file for KV output.
+    char output_path_cbor[MAX_PATHLEN];                 ///< [-F] target file for CBOR output.
     char output_udp_host[100];                          ///< [-F] target host for syslog output.
     char output_udp_port[10];                           ///< [-F] target port for syslog output.
     char output_mqtt_host[100];                         ///< [-F] target host for MQTT output.
@@ -100,6 +106,21 @@ typedef struct r_cfg { // following explanations contain the former command line
     conversion_mode_t conversion_mode;                  ///< [-C] Convert units in decoded output.
     uint32_t duration;                                  ///< [-T] Specify number of seconds to run.
     int after_successful_events_flag;                   ///< [-E] 1 for stopping after outputting successful event(s).
+    int force_scalar;                                   ///< 1 to use the plain C reference DSP kernels instead of SIMD (e.g. to verify output).
+    int lazy_fm_demod;                                  ///< 1 to FM demodulate only where the pulse detector needs it, approximate: the discriminator restarts with a short look-back.
+    int exhaustive_demod;                               ///< 1 to run every decoder on every package, disables the timing prefilter.
+    unsigned decode_threads;                            ///< Threads decoding a package, including the demod thread (0 or 1: decode serially).
+    int decode_affinity;                                ///< CPU for the first decoder worker thread, the others follow (-1: don't pin).
+    unsigned dsp_ring_buffers;                          ///< Buffers queued from the SDR thread to a DSP thread (0: process in the SDR callback).
+    unsigned output_queue_depth;                        ///< Events queued for each output, which then prints on its own thread (0: print in the decoder thread), external callbacks always print in the decoder thread.
+    output_queue_policy_t output_queue_policy;          ///< What to do with an event if an output queue is full.
+    unsigned output_flush_records;                      ///< Records written to file outputs between flushes (1: flush every record, 0: no limit).
+    unsigned output_flush_ms;                           ///< Flush records pending in file outputs for this long (0: no limit).
+    int output_fsync;                                   ///< 1 to fsync() file outputs on every flush.
+    unsigned output_udp_batch;                          ///< Syslog messages sent together in one batch (1: send each at once).
+    unsigned output_udp_flush_ms;                       ///< Send batched syslog messages pending for this long (0: on the next poll).
+    unsigned output_udp_mtu;                            ///< Largest syslog datagram, longer messages are dropped and counted.
+    int data_arena;                                     ///< 1 to build events in pooled arena chunks instead of one allocation per field.
 } r_cfg_t;
 
 void r_init_cfg(r_cfg_t *cfg); // Fills a config with all default elements
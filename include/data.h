@@ -22,6 +22,7 @@
 #define INCLUDE_DATA_H_
 
 #include <stdio.h>
+#include <string.h>
 #include "librtl_433_export.h"
 
 #if defined(_MSC_VER) && !defined(__clang__)
@@ -64,8 +65,15 @@ typedef struct data {
     void        *value;
     unsigned    retain; /**< incremented on data_retain, data_free only frees if this is zero */
     struct data *next; /**< chaining to the next element in the linked list; NULL indicates end-of-list */
+    struct data_arena *arena; /**< if not null, the chunk holding this element with its key, format and plain value */
+    unsigned    interned; /**< DATA_INTERNED_KEY, DATA_INTERNED_PRETTY_KEY and DATA_INTERNED_FORMAT bits, those strings are shared and never freed */
+    char        *json; /**< if not null, the compact JSON of the object from here on, see data_print_jsons_cached() */
 } data_t;
 
+#define DATA_INTERNED_KEY        1
+#define DATA_INTERNED_PRETTY_KEY 2
+#define DATA_INTERNED_FORMAT     4
+
 /** Constructs a structured data object.
 
     Example:
@@ -124,6 +132,64 @@ data_array_t *data_array(int num_values, data_type_t type, void *ptr);
 /** Releases a data array. */
 void data_array_free(data_array_t *array);
 
+/** Build new structured data objects in pooled arena chunks.
+
+    An arena holds all elements of an object with their keys, formats and
+    int, double and string values, appending and prepending use the arena of
+    the object. Releasing the object then returns the chunk to the pool
+    instead of freeing every field. Nested objects and arrays are still
+    released one by one.
+    Elements of an arena must not be freed field by field, use
+    data_replace_key() and friends to change them.
+    Enable before data is created on several threads.
+*/
+RTL_433_API void data_arena_enable(int enable);
+
+/** Get the shared copy of a key from the global key table.
+
+    Keys, pretty keys and formats of new elements are interned, equal keys then have
+    the same pointer. Interned keys are never freed.
+    @return the interned key, or NULL if the table is full or out of memory
+*/
+char const *data_key_intern(char const *key);
+
+/** Look up a key in the global key table without adding it.
+
+    @return the interned key, or NULL if the key was never interned
+*/
+char const *data_key_find(char const *key);
+
+/** Check the key of an element, @p key must be from data_key_intern().
+
+    Pointer equality, unless the element key was not interned.
+*/
+static inline int data_key_is(data_t const *data, char const *key)
+{
+    return data->key == key || (!(data->interned & DATA_INTERNED_KEY) && !strcmp(data->key, key));
+}
+
+/** Replace the key of an element, takes ownership of the malloc'd key. */
+void data_replace_key(data_t *data, char *key);
+
+/** Replace the format of an element, takes ownership of the malloc'd format (may be NULL). */
+void data_replace_format(data_t *data, char *format);
+
+/** Replace the key of an element with a key from data_key_intern(), nothing is allocated. */
+void data_replace_interned_key(data_t *data, char const *key);
+
+/** Replace the format of an element with a format from data_key_intern() (may be NULL), nothing is allocated. */
+void data_replace_interned_format(data_t *data, char const *format);
+
+/** Replace the value of an element with an int, returns -1 on allocation failure. */
+int data_replace_int(data_t *data, int value);
+
+/** Move the first element into a bigger struct that starts with a data_t (e.g. data_ext_t).
+
+    The new struct is released together with the object.
+    @return the new first element, or NULL on allocation failure (then @p data is unchanged)
+*/
+data_t *data_replace_head(data_t *data, size_t size);
+
 /** Retain a structure object, returns the structure object passed in. */
 RTL_433_API data_t *data_retain(data_t *data);
 
@@ -140,7 +206,11 @@ typedef struct _data_output {
     void(*output_start)(data_output_t *output, const char **fields, int num_fields);
     void(*output_poll)(data_output_t *output);
     void(*output_free)(data_output_t *output);
+    data_t *(*output_stats)(data_output_t *output, data_t *stats);
+    void(*output_stats_reset)(data_output_t *output);
     FILE *file;
+    struct file_writer *writer; ///< flush policy of the file, NULL to flush every record
+    int binary; ///< records are framed by the printer, no newline after each
     void *ext_callback;
 } data_output_t;
 
@@ -150,6 +220,15 @@ void data_output_print(data_output_t *output, data_t *data);
 /** Allows to polls an event loop, if necessary. */
 void data_output_poll(data_output_t *output);
 
+/** Appends the counters of an output to stats, returns the new list.
+
+    Outputs without counters return stats unchanged, i.e. NULL for a NULL list.
+*/
+data_t *data_output_stats(data_output_t *output, data_t *stats);
+
+/** Resets the counters of an output. */
+void data_output_stats_reset(data_output_t *output);
+
 void data_output_free(data_output_t *output);
 
 /* data output helpers. */
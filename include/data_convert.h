@@ -0,0 +1,43 @@
+/** @file
+    Unit conversion plan, rewrites decoder output for -C si|customary and -M newmodel.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_DATA_CONVERT_H_
+#define INCLUDE_DATA_CONVERT_H_
+
+#include "data.h"
+
+typedef struct data_convert data_convert_t;
+
+/** Create an empty conversion plan.
+
+    @param conversion_mode: a conversion_mode_t, CONVERT_SI or CONVERT_CUSTOMARY converts units
+    @param new_model_keys: replace a textual "battery" with a numerical "battery_ok"
+    @return the plan or NULL on allocation failure
+*/
+data_convert_t *data_convert_create(int conversion_mode, int new_model_keys);
+
+void data_convert_free(data_convert_t *conv);
+
+/** Resolve the target key, format and conversion of the fields of a decoder.
+
+    Done when the decoder is registered, keys a decoder does not list are
+    resolved on first use.
+    @param fields: NULL terminated list of keys, e.g. r_device.fields, may be NULL
+    @return 0 on success, -1 on allocation failure
+*/
+int data_convert_add_fields(data_convert_t *conv, char const *const *fields);
+
+/** Convert the top level elements of an event in place.
+
+    Resolved keys need no string search and no allocation, the new keys and
+    formats are interned.
+*/
+void data_convert_apply(data_convert_t *conv, data_t *data);
+
+#endif /* INCLUDE_DATA_CONVERT_H_ */
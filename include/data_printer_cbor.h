@@ -0,0 +1,49 @@
+/** @file
+    CBOR output of structured data, with a reader for the records.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_DATA_PRINTER_CBOR_H_
+#define INCLUDE_DATA_PRINTER_CBOR_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "data.h"
+
+/// Largest record data_cbor_read() accepts.
+#define CBOR_RECORD_MAX (1 << 20)
+
+/** Create a CBOR (RFC 8949) output.
+
+    Each event is written as a 4 byte big endian length followed by a CBOR
+    map of the keys to their values. Ints are CBOR integers, doubles are
+    single or double precision floats, whichever is exact, nested data
+    are maps and arrays are CBOR arrays. Pretty keys and formats are left
+    out, like in JSON.
+    @param file: the output file, opened in binary mode
+*/
+data_output_t *data_output_cbor_create(FILE *file);
+
+/** Decode one CBOR map into structured data.
+
+    Accepts what data_output_cbor_create() writes, plus half precision
+    floats, booleans (as ints) and tags (which are ignored).
+    @param buf: the CBOR encoded map, without the length prefix
+    @param len: the size of @p buf, which must hold exactly one item
+    @return the data or NULL if the encoding is invalid or memory allocation failed
+*/
+data_t *data_cbor_decode(uint8_t const *buf, size_t len);
+
+/** Read the next length prefixed record written by a CBOR output.
+
+    @param[out] data: the decoded record, release with data_free()
+    @return 1 if a record was read, 0 at the end of the file, -1 on error
+*/
+int data_cbor_read(FILE *file, data_t **data);
+
+#endif /* INCLUDE_DATA_PRINTER_CBOR_H_ */
@@ -27,4 +27,18 @@
 
 size_t data_print_jsons(data_t *data, char *dst, size_t len);
 
+/** Compact JSON of an object, serialized once and cached on the object.
+
+    All outputs sending the compact JSON of an event share the same text,
+    the object must not change after the first call. Thread safe.
+    @param[out] len: length of the text, may be NULL
+    @return the text, owned by @p data, or NULL on allocation failure
+*/
+char const *data_print_jsons_cached(data_t *data, size_t *len);
+
+/// Counters of data_print_jsons_cached(): objects serialized and serializations reused.
+void data_print_jsons_stats(unsigned *serialized, unsigned *reused);
+
+void data_print_jsons_stats_reset(void);
+
 #endif // RTL_433_DATA_PRINTER_JSONSTR_H
@@ -25,6 +25,31 @@
 
 #include "data.h"
 
-data_output_t *data_output_syslog_create(const char *host, const char *port);
+/// Largest UDP payload over IPv4, the limit of the MTU setting.
+#define SYSLOG_MTU_MAX 65507
+/// Most messages sent in one batch.
+#define SYSLOG_BATCH_MAX 64
+
+/// Syslog output metrics, since creation or the last data_output_syslog_stats_reset().
+typedef struct syslog_stats {
+    unsigned sent;     ///< datagrams sent
+    unsigned failed;   ///< datagrams the socket refused
+    unsigned oversize; ///< messages dropped as larger than the MTU
+    unsigned batches;  ///< flushes of pending messages
+} syslog_stats_t;
+
+/** Create a syslog (RFC 5424) output sending UDP datagrams.
+
+    @param batch: messages gathered before they are sent together (0 or 1: send each at once)
+    @param flush_ms: send gathered messages on a poll after this long (0: on the next poll)
+    @param mtu: largest datagram, longer messages are dropped and counted (0: SYSLOG_MTU_MAX)
+*/
+data_output_t *data_output_syslog_create(const char *host, const char *port, unsigned batch, unsigned flush_ms, unsigned mtu);
+
+/// Get the metrics of a syslog output, returns -1 if @p output is not syslog.
+int data_output_syslog_stats(data_output_t *output, syslog_stats_t *stats);
+
+/// Reset the metrics of a syslog output, other outputs are ignored.
+void data_output_syslog_stats_reset(data_output_t *output);
 
 #endif // RTL_433_DATA_PRINTER_UDP_H
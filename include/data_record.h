@@ -0,0 +1,69 @@
+/** @file
+    Schema indexed records, O(1) field lookup for structured data.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_DATA_RECORD_H_
+#define INCLUDE_DATA_RECORD_H_
+
+#include "data.h"
+
+/// A field list resolved to slot indices.
+typedef struct data_schema {
+    unsigned num_slots;
+    char const **keys;   ///< interned key of each slot
+    unsigned hash_mask;
+    char const **hash_keys; ///< open addressing on the key pointer
+    int *hash_slots;
+} data_schema_t;
+
+/** Resolve a field list once, e.g. r_device.fields or the CSV columns.
+
+    Duplicate keys map to their first slot.
+    @param keys: the field keys, not copied
+    @param num_keys: number of keys, or -1 if @p keys is NULL terminated
+    @return the schema or NULL on allocation failure
+*/
+data_schema_t *data_schema_create(char const *const *keys, int num_keys);
+
+void data_schema_free(data_schema_t *schema);
+
+/// Slot of an element by its key, -1 if the key is not in the schema.
+int data_schema_slot(data_schema_t const *schema, data_t const *data);
+
+/** Flat view of one event in the slots of a schema.
+
+    The record only points to the elements of the event, indexing a data_t
+    list is the shim that lets printers look up fields by slot for every
+    decoder. A record is reused from event to event.
+*/
+typedef struct data_record {
+    data_schema_t const *schema;
+    unsigned num_set;
+    int *set;         ///< slots found, in event order
+    data_t **slots;   ///< element of each slot, NULL if the event has none
+} data_record_t;
+
+/// Create an empty record for a schema, returns NULL on allocation failure.
+data_record_t *data_record_create(data_schema_t const *schema);
+
+void data_record_free(data_record_t *record);
+
+/** Index the top level elements of an event.
+
+    Clears the previous event first. If a key occurs more than once the
+    first element wins. The elements must outlive the use of the record.
+*/
+void data_record_index(data_record_t *record, data_t *data);
+
+/// Element of a slot, NULL if the indexed event has none.
+static inline data_t *data_record_get(data_record_t const *record, int slot)
+{
+    return record->slots[slot];
+}
+
+#endif /* INCLUDE_DATA_RECORD_H_ */
@@ -0,0 +1,46 @@
+/** @file
+    Worker pool to run the decoders of a package in parallel.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_DECODE_POOL_H_
+#define INCLUDE_DECODE_POOL_H_
+
+#include "pulse_demod.h"
+
+typedef struct decode_pool decode_pool_t;
+
+/// Output callback of the decoders, see r_device.output_fn.
+typedef void (*decode_output_fn)(r_device *decoder, struct data *data, extdata_t *ext);
+
+/** Create a pool.
+
+    @param num_threads: threads decoding a package, including the thread calling decode_pool_run()
+                        (0 or 1: decode on the calling thread only)
+    @param affinity: CPU for the first worker thread, the n-th worker on affinity + n (-1: don't pin)
+    @param output_fn: decoder output callback the collected output is passed on to
+    @param order: the registered decoders, the output is passed on in this order
+    @return the pool or NULL if the threads could not be started
+*/
+decode_pool_t *decode_pool_create(unsigned num_threads, int affinity, decode_output_fn output_fn, list_t const *order);
+
+void decode_pool_free(decode_pool_t *pool);
+
+/** Demodulate and decode a package with each group.
+
+    The groups are split into one contiguous range per thread, a thread out
+    of work steals groups from the end of the other ranges.
+    A group always runs on one thread, so decoder statistics and buffers are
+    not shared. The decoder output is collected and passed on to output_fn
+    once all groups are done, in decoder registration order, i.e. exactly as
+    a serial loop over the decoders without groups.
+    @param serial: decode all groups on the calling thread, e.g. to keep debug output readable
+    @return number of events processed
+*/
+int decode_pool_run(decode_pool_t *pool, demod_group_t **groups, unsigned num_groups, pulse_data_t const *pulses, int serial);
+
+#endif /* INCLUDE_DECODE_POOL_H_ */
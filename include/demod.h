@@ -6,11 +6,36 @@
     #include "samp_grab.h"
     #include "am_analyze.h"
     #include "data_printer_ext.h"
+    #include "channelizer.h"
+    #include "decode_pool.h"
+    #include "data_convert.h"
 
 #define MINIMAL_BUF_LENGTH      512
 #define MAXIMAL_BUF_LENGTH      (256 * 16384)
 #define SIGNAL_GRABBER_BUFFER   (12 * DEFAULT_BUF_LENGTH)
 
+/// On demand FM demodulation of one block, driven by the pulse detector (see pulse_detect_set_fm_source()).
+/// The discriminator filter restarts with a short look-back, the output only approximates full demodulation.
+typedef struct fm_lazy {
+        void const *iq_buf;
+        int sample_size;         // CU8: 1, CS16: 2
+        unsigned long n_samples;
+        unsigned long pos;       // samples before pos are demodulated or skipped
+        int16_t *fm_buf;
+        demodfm_state_t *state;
+} fm_lazy_t;
+
+/// Per channel demodulation state in channelizer mode (cfg->channelize).
+typedef struct dm_channel {
+        uint32_t frequency;          // channel center frequency
+        int16_t *iq_buf;             // decimated CS16 samples of the current block
+        pulse_detect_t *pulse_detect;
+        filter_state_t lowpass_filter_state;
+        demodfm_state_t demod_FM_state;
+        pulse_data_t pulse_data;     // in channel samples, scaled to input samples for the decoders
+        pulse_data_t fsk_pulse_data; // in channel samples, scaled to input samples for the decoders
+} dm_channel_t;
+
 typedef struct _dm_state{
         rtl_433_t *rtl;     // pointer to rtl_433 instance that created this object (no need to free this here)
         int16_t am_buf[MAXIMAL_BUF_LENGTH];  // AM demodulated signal (for OOK decoding)
@@ -26,6 +51,7 @@ typedef struct _dm_state{
         filter_state_t lowpass_filter_state;
         demodfm_state_t demod_FM_state;
         int enable_FM_demod;
+        int lazy_FM_demod; // FM demodulate only where the pulse detector needs it, see fm_lazy_t
         samp_grab_t *samp_grab;   // (only allocated if cfg->grab_mode != 0; created by dm_state_init, freed by dm_state_destroy)
         am_analyze_t *am_analyze; // (only allocated if cfg->analyze_am != 0; created by dm_state_init, freed by dm_state_destroy)
         file_info_t load_info;   
@@ -36,6 +62,12 @@ typedef struct _dm_state{
 
         /* Protocol states */
         list_t r_devs; // elements are alloced in register_protocol, freed in destructor
+        list_t demod_groups; // demod_group_t elements, decoders grouped by demodulation parameters
+        unsigned demod_runs;    // stats counter: decoder invocations
+        unsigned demod_skipped; // stats counter: decoder invocations avoided by the timing prefilter
+        list_t demod_batch;     // demod_group_t elements of the current package for the decode pool (not owned)
+        decode_pool_t *decode_pool; // (only allocated if cfg->decode_threads > 1; created by dm_state_init, freed by dm_state_destroy)
+        data_convert_t *data_convert; // (only allocated if cfg->conversion_mode or cfg->new_model_keys is set; created by dm_state_init, freed by dm_state_destroy)
 
         list_t output_handler;
 
@@ -46,6 +78,8 @@ typedef struct _dm_state{
         unsigned frame_end_ago;
         struct timeval now;
         float sample_file_pos;
+        channelizer_t *channelizer; // (only allocated in channelizer mode; created by dm_channels_init, freed by dm_state_destroy)
+        list_t channels;            // dm_channel_t elements, one per frequency in channelizer mode
 } dm_state;
 
 //  public:
@@ -57,6 +91,12 @@ int registerNonflexDevices(dm_state *dm);
 int registerFlexDevices(dm_state *dm, list_t *flex_specs);
 int Perform_AM_Demodulation(dm_state *dm, unsigned char *iq_buf, unsigned long n_samples);
 int Perform_FM_Demodulation(dm_state *dm, unsigned char *iq_buf, unsigned long n_samples);
+int Perform_Demodulation(dm_state *dm, unsigned char *iq_buf, unsigned long n_samples); // AM and FM in one pass
+void fm_lazy_begin(fm_lazy_t *lazy, void const *iq_buf, int sample_size, unsigned long n_samples, int16_t *fm_buf, demodfm_state_t *state);
+void fm_lazy_demod(void *ctx, int start, int end); // pulse_detect_fm_fn
+void fm_lazy_end(fm_lazy_t *lazy);
+int dm_channels_init(dm_state *dm, uint32_t *center_frequency);
+int Perform_Channel_Demodulation(dm_state *dm, dm_channel_t *chan, unsigned long n_samples); // AM and FM of a channel
 
 int run_ook_demods(dm_state *dm);
 int run_fsk_demods(dm_state *dm);
@@ -69,6 +109,7 @@ void start_outputs(dm_state *dm, char const **well_known);
 int add_json_output(dm_state *dm, char *param, int allow_overwrite);
 int add_csv_output(dm_state *dm, char *param, int allow_overwrite);
 int add_kv_output(dm_state *dm, char *param, int allow_overwrite);
+int add_cbor_output(dm_state *dm, char *param, int allow_overwrite);
 int add_mqtt_output(dm_state *dm, char *host, char *port, char *opts);
 int add_syslog_output(dm_state *dm, char *host, char *port);
 int add_ext_output(dm_state *dm, void *extcb);
@@ -77,7 +118,9 @@ int add_ext_output(dm_state *dm, void *extcb);
 static void data_acquired_handler(r_device *r_dev, data_t *data, extdata_t *ext);
 static void update_protocol(r_cfg_t *cfg, r_device *r_dev);
 static int register_protocol(dm_state *dm, r_device* t_dev, char *arg);
+static int add_demod_group(dm_state *dm, r_device *r_dev);
 static char const **determine_csv_fields(dm_state *dm, char const **well_known, int *num_fields);
-static FILE *fopen_output(char *param, int allow_overwrite);
+static FILE *fopen_output(char *param, int allow_overwrite, int binary);
+static void dm_channel_free(dm_channel_t *chan);
 
 #endif // RTL_433_DEMOD_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+/** @file
+    Buffered writes of file outputs, flushed in batches of records.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_FILE_WRITER_H_
+#define INCLUDE_FILE_WRITER_H_
+
+#include <stdio.h>
+
+/// Buffer given to files opened for output, records collect here until a flush.
+#define FILE_WRITER_BUFLEN 65536
+
+typedef struct file_writer file_writer_t;
+
+/** Create a flush policy for an output file.
+
+    @param file: the output file, if it is not stdout it gets a buffer of
+                 FILE_WRITER_BUFLEN and must not have been written to yet
+    @param records: flush after this many records (0: no limit)
+    @param interval_ms: flush records pending for this long (0: no limit)
+    @param sync: 1 to fsync() the file after each flush
+    @return the writer or NULL on allocation failure, then the file flushes every record
+*/
+file_writer_t *file_writer_create(FILE *file, unsigned records, unsigned interval_ms, int sync);
+
+/// Release the writer, only after the file is closed as the writer owns its buffer.
+void file_writer_free(file_writer_t *writer);
+
+/// Count a record that was written to the file, flushes as the policy says.
+void file_writer_record(file_writer_t *writer);
+
+/// Flush records pending for longer than the interval, may be called from any thread.
+void file_writer_poll(file_writer_t *writer);
+
+/// Write out all pending records.
+void file_writer_flush(file_writer_t *writer);
+
+#endif /* INCLUDE_FILE_WRITER_H_ */
@@ -0,0 +1,52 @@
+/** @file
+    Number formatting and string escaping for the data printers.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_FMT_H_
+#define INCLUDE_FMT_H_
+
+#include <stddef.h>
+
+/// Buffer size for any fmt_*() number, "%.9f" of the largest double is 320 chars.
+#define FMT_BUFLEN 330
+
+/** Format an int like "%d".
+
+    @return the length, without the terminating NUL
+*/
+size_t fmt_int(char *buf, int value);
+
+/** Format a double like "%.<precision>f".
+
+    The digits are computed with integer arithmetic unless the value is too
+    big or too close to a rounding tie, then snprintf() decides. Output is
+    identical to printf() either way.
+    @param precision: digits after the decimal point, 0 to 9
+    @return the length, without the terminating NUL
+*/
+size_t fmt_fixed(char *buf, double value, int precision);
+
+/// Format a double like "%g", with the same fast path as fmt_fixed().
+size_t fmt_general(char *buf, double value);
+
+/** Check for a format of the form "%.<precision>f<suffix>" without other conversions.
+
+    @param[out] precision: the precision, 6 if not given
+    @param[out] suffix: the text after the conversion
+    @return 1 if fmt_fixed() and the suffix can replace the format, 0 otherwise
+*/
+int fmt_parse_fixed(char const *format, int *precision, char const **suffix);
+
+/** Length of the run of bytes that need no escaping.
+
+    Stops at the terminating NUL or the first @p c1 or @p c2, scans 16 bytes
+    at a time where SSE2 is available.
+*/
+size_t fmt_escape_span(char const *str, char c1, char c2);
+
+#endif /* INCLUDE_FMT_H_ */
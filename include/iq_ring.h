@@ -0,0 +1,57 @@
+/** @file
+    Single producer, single consumer ring of IQ sample buffers.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_IQ_RING_H_
+#define INCLUDE_IQ_RING_H_
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct iq_ring iq_ring_t;
+
+/** Create a ring.
+
+    Buffers are handed over lock-free, the consumer only takes a mutex to
+    sleep while the ring is empty, the producer only to wake it from that.
+    @param num_bufs: number of buffers
+    @param buf_size: size of each buffer in bytes
+    @return the ring or NULL on allocation failure
+*/
+iq_ring_t *iq_ring_create(unsigned num_bufs, uint32_t buf_size);
+
+void iq_ring_free(iq_ring_t *ring);
+
+/** Producer: copy a buffer into the ring.
+
+    Never blocks, if the ring is full the buffer is dropped and counted.
+    @return 0 on success, -1 if the buffer was dropped
+*/
+int iq_ring_push(iq_ring_t *ring, unsigned char const *buf, uint32_t len);
+
+/// Producer: no more buffers, wakes the consumer once the ring is drained.
+void iq_ring_close(iq_ring_t *ring);
+
+/// Accept buffers again after iq_ring_close(), only while there is no consumer.
+void iq_ring_reopen(iq_ring_t *ring);
+
+/** Consumer: wait for the oldest buffer.
+
+    @param[out] len: length of the buffer in bytes
+    @param[out] dropped: bytes dropped right before this buffer
+    @return the buffer, valid until iq_ring_release(), or NULL if the ring is closed and empty
+*/
+unsigned char *iq_ring_wait(iq_ring_t *ring, uint32_t *len, uint64_t *dropped);
+
+/// Consumer: hand the buffer from iq_ring_wait() back to the producer.
+void iq_ring_release(iq_ring_t *ring);
+
+/// Overrun counters: dropped bytes, dropped buffers, and the time of the last drop (0 if none).
+void iq_ring_stats(iq_ring_t *ring, uint64_t *dropped_bytes, unsigned *overruns, time_t *last_overrun);
+
+#endif /* INCLUDE_IQ_RING_H_ */
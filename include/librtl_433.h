@@ -18,6 +18,7 @@ typedef struct _rtl_433 rtl_433_t;
 #include "fileformat.h"
 #include "redir_print.h"
 #include "data_printer_ext.h"
+#include "iq_ring.h"
 
 #define MAX_FREQS               32
 #define DEFAULT_BUF_LENGTH      (16 * 32 * 512) // librtlsdr default
@@ -69,6 +70,7 @@ typedef struct _rtl_433 {
         dm_state *demod;
         uint32_t center_frequency;
         int frequency_index;
+        iq_ring_t *iq_ring;                             // SDR to DSP thread buffers (only while reading with cfg->dsp_ring_buffers)
         /* stats*/
         unsigned frames_count; ///< stats counter for interval
         unsigned frames_fsk; ///< stats counter for interval
@@ -91,7 +93,10 @@ char *time_pos_str(rtl_433_t *rtl, unsigned samples_ago, char *buf);
 //private:
 static int InitSdr(rtl_433_t *rtl);
 static int ReadRtlAsync(rtl_433_t *rtl, struct sigaction *sigact);
-static void calc_rssi_snr(rtl_433_t *rtl, pulse_data_t *pulse_data);
+static void sdr_ring_callback(unsigned char *iq_buf, uint32_t len, void *ctx);
+static void calc_rssi_snr(rtl_433_t *rtl, pulse_data_t *pulse_data, dm_channel_t const *chan);
+static int run_package(rtl_433_t *rtl, int package_type, pulse_data_t *pulse_data, dm_channel_t const *chan, unsigned long n_samples);
+static int run_channels(rtl_433_t *rtl, unsigned char *iq_buf, unsigned long n_samples);
 
 #ifdef __cplusplus
 }
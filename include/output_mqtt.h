@@ -14,6 +14,28 @@
 
 #include "data.h"
 
+/// MQTT client metrics, since creation or the last data_output_mqtt_stats_reset().
+typedef struct mqtt_stats {
+    unsigned depth;     ///< batches waiting for the client thread right now
+    unsigned max_depth; ///< most batches waiting at once
+    unsigned published; ///< messages passed to the broker connection
+    unsigned dropped;   ///< messages dropped on overflow
+} mqtt_stats_t;
+
+/** Create an MQTT output.
+
+    Messages are queued for a client thread which runs the broker
+    connection, reconnects with a backoff and drops the oldest messages
+    if the queue overflows meanwhile. Options besides the topics are
+    "user", "pass", "retain", "queue" (depth, default 1024) and
+    "coalesce" (queue all messages of an event as one batch).
+*/
 data_output_t *data_output_mqtt_create(char const *host, char const *port, char *opts, char const *dev_hint);
 
+/// Get the metrics of an MQTT output, returns -1 if @p output is not MQTT.
+int data_output_mqtt_stats(data_output_t *output, mqtt_stats_t *stats);
+
+/// Reset the metrics of an MQTT output, other outputs are ignored.
+void data_output_mqtt_stats_reset(data_output_t *output);
+
 #endif /* INCLUDE_OUTPUT_MQTT_H_ */
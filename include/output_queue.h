@@ -0,0 +1,54 @@
+/** @file
+    Queued output, runs an output handler on its own thread.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_OUTPUT_QUEUE_H_
+#define INCLUDE_OUTPUT_QUEUE_H_
+
+#include <stdint.h>
+
+#include "data.h"
+
+// valid options for r_cfg_t->output_queue_policy
+typedef enum {
+    QUEUE_BLOCK,       // wait for the output to catch up
+    QUEUE_DROP_OLDEST, // drop the oldest queued event
+    QUEUE_DROP_NEWEST  // drop the new event
+} output_queue_policy_t;
+
+/// Queue metrics, since creation or the last data_output_queue_stats_reset().
+typedef struct output_queue_stats {
+    unsigned depth;       ///< events waiting right now
+    unsigned max_depth;   ///< most events waiting at once
+    unsigned printed;     ///< events passed to the output
+    unsigned dropped;     ///< events dropped on overflow
+    uint64_t latency_us;  ///< sum of the waiting times of the printed events
+    uint64_t max_latency_us;
+} output_queue_stats_t;
+
+/** Move an output handler to its own thread.
+
+    Printing then only retains the data and queues it, the thread passes
+    the events to the wrapped output in order. Polling is also done on
+    that thread, outputs need not be thread safe. Outputs with an
+    external callback are refused, their extended data points to the
+    bitbuffer and pulses of the decoder, which are reused meanwhile.
+    @param output: the output to wrap, owned by the queue on success
+    @param depth: events to queue at most
+    @param policy: what to do with an event if the queue is full
+    @return the queued output or NULL on failure, then the caller keeps @p output
+*/
+data_output_t *data_output_queue_create(data_output_t *output, unsigned depth, output_queue_policy_t policy);
+
+/// Get the metrics of a queued output, returns -1 if @p output is not queued.
+int data_output_queue_stats(data_output_t *output, output_queue_stats_t *stats);
+
+/// Reset the metrics of a queued output, other outputs are ignored.
+void data_output_queue_stats_reset(data_output_t *output);
+
+#endif /* INCLUDE_OUTPUT_QUEUE_H_ */
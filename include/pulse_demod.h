@@ -16,6 +16,47 @@
 
 #include "pulse_detect.h"
 #include "r_device.h"
+#include "bitbuffer.h"
+#include "list.h"
+
+/// Timing summary of a package, computed once and matched against every demod group.
+typedef struct pulse_summary {
+    uint64_t pulse_bins; ///< histogram occupancy of the pulse widths, see pulse_width_bin()
+    uint64_t gap_bins;   ///< histogram occupancy of the gap widths
+} pulse_summary_t;
+
+/// Summarize the pulse and gap widths of a package.
+void pulse_summary(pulse_data_t const *pulses, pulse_summary_t *summary);
+
+/// Decoders with identical demodulation parameters, the pulses are demodulated once for all members.
+typedef struct demod_group {
+    r_device device;     ///< demodulation parameters, decode_fn dispatches to the members
+    list_t members;      ///< r_device elements in registration order (not owned)
+    bitbuffer_t work;    ///< copy of the bits for members, restored only after a decoder changed it
+    unsigned work_rows;  ///< rows of work that may hold bits, all rows after these are zero
+    int filtered;        ///< 0 if the demodulator can't be ruled out by the package timing
+    uint64_t pulse_bins; ///< histogram bins of pulses that can produce bits
+    uint64_t gap_bins;   ///< histogram bins of gaps that can produce bits
+} demod_group_t;
+
+/** Check if a package can produce any decode call for the group.
+
+    Without a pulse (or gap) width inside one of the demodulators acceptance
+    windows no bits are produced and the decoders are never called,
+    a skipped group changes neither the output nor the decoder statistics.
+*/
+int demod_group_accepts(demod_group_t const *group, pulse_summary_t const *summary);
+
+/// Initialize a group from its first member (after the pulse limits are converted).
+void demod_group_init(demod_group_t *group, r_device *first);
+
+/// True if the decoder demodulates exactly like the group and can join it, verbose decoders never join.
+int demod_group_matches(demod_group_t const *group, r_device const *r_dev);
+
+/// Device to pass to the pulse_demod_*() functions, the single member or the group dispatcher.
+r_device *demod_group_device(demod_group_t *group);
+
+void demod_group_free(demod_group_t *group);
 
 /// Demodulate a Pulse Code Modulation signal.
 ///
@@ -125,6 +166,10 @@ int pulse_demod_piwm_dc(const pulse_data_t *pulses, r_device *device);
 
 int pulse_demod_osv1(const pulse_data_t *pulses, r_device *device);
 
+/// Demodulate with the demodulator matching the device modulation.
+/// @return number of events processed
+int pulse_demod_device(const pulse_data_t *pulses, r_device *device);
+
 /// Simulate demodulation using a given signal code string.
 ///
 /// The (optionally "0x" prefixed) hex code is processed into a bitbuffer_t.
@@ -81,6 +81,23 @@ pulse_detect_t *pulse_detect_create(void);
 
 void pulse_detect_free(pulse_detect_t *pulse_detect);
 
+/// Samples seen and samples skipped as silent by the energy gate, since the last reset.
+void pulse_detect_gate_stats(pulse_detect_t const *pulse_detect, uint64_t *samples, uint64_t *skipped);
+
+/// Reset the energy gate stats.
+void pulse_detect_gate_stats_reset(pulse_detect_t *pulse_detect);
+
+/// Callback to fill fm_data for samples [start, end) of the current buffer.
+typedef void (*pulse_detect_fm_fn)(void *ctx, int start, int end);
+
+/** Demodulate FM on demand instead of passing a complete fm_data buffer.
+
+    pulse_detect_package() then requests the spans of fm_data it reads, i.e. while a pulse is detected.
+    @param fm_fn: callback to fill fm_data, NULL if fm_data is always complete
+    @param ctx: context for the callback
+*/
+void pulse_detect_set_fm_source(pulse_detect_t *pulse_detect, pulse_detect_fm_fn fm_fn, void *ctx);
+
 /// Demodulate On/Off Keying (OOK) and Frequency Shift Keying (FSK) from an envelope signal.
 ///
 /// Function is stateful and can be called with chunks of input data.
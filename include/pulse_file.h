@@ -0,0 +1,67 @@
+/** @file
+    Binary pulse data files, and conversion to and from OOK text.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_PULSE_FILE_H_
+#define INCLUDE_PULSE_FILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "pulse_detect.h"
+#include "librtl_433_export.h"
+
+/// Magic at the start of a binary pulse file, followed by the version.
+#define PULSE_FILE_MAGIC "RPLS"
+#define PULSE_FILE_VERSION 1
+
+/// Largest encoded pulse train, two varints of at most 10 bytes per pulse plus the fields.
+#define PULSE_FILE_RECORD_MAX (PD_MAX_PULSES * 2 * 10 + 128)
+
+/** Print the header of the binary pulse format.
+
+    The header is the magic, a version byte and the creation time, as
+    seconds since the epoch in 8 bytes little endian. Records follow:
+    a type byte (PULSE_DATA_OOK or PULSE_DATA_FSK), the record length
+    as varint and the fields, see pulse_data_dump_bin(). Files may be
+    concatenated, a header is accepted between records.
+*/
+RTL_433_API void pulse_data_print_bin_header(FILE *file);
+
+/** Write a pulse train in the binary pulse format.
+
+    Fields are varints (signed ones zigzag coded), in order: offset,
+    sample rate, center frequency, the OOK low and high estimates, the
+    FSK F1 and F2 estimates, then freq1, freq2, rssi, snr and noise as
+    float32 little endian, the number of pulses and for each pulse the
+    difference of the pulse width to the previous pulse width and of
+    the gap width to the previous gap width, all in samples. Readers
+    skip fields appended by later versions.
+    @param fsk: the record type, nonzero if the pulses are FSK demodulated
+    @param center_frequency: the frequency the pulses were received on, 0 if unknown
+*/
+RTL_433_API void pulse_data_dump_bin(FILE *file, pulse_data_t const *data, int fsk, uint32_t center_frequency);
+
+/** Read the next pulse train in the binary pulse format.
+
+    A record without a sample rate or with a width outside 0 to INT_MAX is invalid.
+    @param[out] center_frequency: the frequency the pulses were received on, may be NULL
+    @return the record type (PULSE_DATA_OOK or PULSE_DATA_FSK) if a pulse train was read,
+            0 at the end of the file, -1 on invalid data
+*/
+int pulse_data_load_bin(FILE *file, pulse_data_t *data, uint32_t *center_frequency);
+
+/** Convert pulse data between the OOK text and the binary pulse format.
+
+    Formats are detected from the file specs like for inputs and dumpers,
+    e.g. "in.ook" and "out.pulse", "-" is stdin or stdout. Text has no
+    sample rate, it converts to 1 MHz samples and binary converts to us.
+    @return the number of pulse trains converted or -1 on error
+*/
+RTL_433_API int pulse_file_convert(char const *in_spec, char const *out_spec);
+
+#endif /* INCLUDE_PULSE_FILE_H_ */
@@ -84,7 +84,7 @@ typedef struct r_device {
 
     /* private for flex decoder and output callback */
     void *decode_ctx;
-    //  void *output_ctx;
+    void *output_ctx; ///< decode pool task collecting the output while the decoder runs on a worker
     rtl_433_t *ctx;
 
     /* private pulse limits (converted to count of samples) */
@@ -33,6 +33,14 @@
 */
 void get_time_now(struct timeval *tv);
 
+/** Get current time in usec, for measuring intervals.
+
+    Interval timers in ms use the truncated value, i.e. `(unsigned)(get_time_us() / 1000)`.
+
+    @return wall clock time in usec since the epoch
+*/
+uint64_t get_time_us(void);
+
 /** Printable timestamp in local time.
 
     @param buf[out]: output buffer, long enough for "YYYY-MM-DD HH:MM:SS"
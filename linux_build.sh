@@ -4,26 +4,37 @@ gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/abuf.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/am_analyze.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/baseband.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/bitbuffer.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/channelizer.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/compat_time.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/compat_thread.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/config.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_printer_cbor.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_printer_csv.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_printer_ext.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_printer_json.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_printer_jsonstr.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_printer_kv.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_printer_udp.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_record.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/data_convert.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/decode_pool.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/decoder_util.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/demod.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/fileformat.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/file_writer.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/fmt.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/iq_ring.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/librtl_433.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/list.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/mongoose.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/optparse.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/output_mqtt.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/output_queue.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/pulse_analyze.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/pulse_demod.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/pulse_detect.c
+gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/pulse_file.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/r_util.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/redir_print.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/samp_grab.c
@@ -144,4 +155,5 @@ gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/devices/wt0124.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/devices/wt450.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/devices/x10_rf.c
 gcc -Iinclude -lm -D RTLSDR -lrtlsdr -c src/devices/x10_sec.c
-ar rcs librtl_433.a abuf.o am_analyze.o baseband.o bitbuffer.o compat_time.o config.o data.o data_printer_csv.o data_printer_ext.o data_printer_json.o data_printer_jsonstr.o data_printer_kv.o data_printer_udp.o decoder_util.o demod.o fileformat.o librtl_433.o list.o mongoose.o optparse.o output_mqtt.o pulse_analyze.o pulse_demod.o pulse_detect.o r_util.o redir_print.o samp_grab.o sdr.o term_ctl.o util.o acurite.o akhan_100F14.o alecto.o ambient_weather.o ambientweather_tx8300.o ambientweather_wh31e.o blyss.o brennenstuhl_rcs_2044.o bresser_3ch.o bresser_5in1.o bt_rain.o calibeur.o cardin.o chuango.o companion_wtr001.o current_cost.o danfoss.o digitech_xc0324.o directv.o dish_remote_6_3.o dsc.o ecowitt.o efergy_e2_classic.o efergy_optical.o elro_db286a.o elv.o emontx.o esa.o esperanza_ews.o eurochron.o fineoffset.o fineoffset_wh1050.o fineoffset_wh1080.o flex.o fordremote.o fs20.o ft004b.o ge_coloreffects.o generic_motion.o generic_remote.o generic_temperature_sensor.o gt_wt_02.o hcs200.o hideki.o holman_ws5029.o hondaremote.o honeywell.o honeywell_wdb.o ht680.o ibis_beacon.o ikea_sparsnas.o infactory.o inovalley-kw9015b.o interlogix.o intertechno.o kedsum.o kerui.o lacrosse.o lacrosse_TX141TH_Bv2.o lacrosse_tx35.o lacrosse_ws7000.o lacrossews.o lightwave_rf.o m_bus.o maverick_et73.o maverick_et73x.o mebus.o new_template.o newkaku.o nexa.o nexus.o oil_standard.o oil_watchman.o opus_xt300.o oregon_scientific.o oregon_scientific_sl109h.o oregon_scientific_v1.o philips.o prologue.o proove.o quhwa.o radiohead_ask.o rftech.o rubicson.o rubicson_48659.o s3318p.o schraeder.o silvercrest.o simplisafe.o smoke_gs558.o solight_te44.o springfield.o steelmate.o tfa_30_3196.o tfa_pool_thermometer.o tfa_twin_plus_30.3049.o thermopro_tp11.o thermopro_tp12.o tpms_citroen.o tpms_ford.o tpms_jansite.o tpms_pmv107j.o tpms_renault.o tpms_toyota.o ts_ft002.o ttx201.o vaillant_vrt340f.o waveman.o wg_pb12v1.o wssensor.o wt0124.o wt450.o x10_rf.o x10_sec.o
+ar rcs librtl_433.a abuf.o am_analyze.o baseband.o bitbuffer.o channelizer.o compat_time.o compat_thread.o config.o data.o data_printer_cbor.o data_printer_csv.o data_printer_ext.o data_printer_json.o data_printer_jsonstr.o data_printer_kv.o data_printer_udp.o data_record.o data_convert.o decode_pool.o decoder_util.o demod.o fileformat.o file_writer.o fmt.o iq_ring.o librtl_433.o list.o mongoose.o optparse.o output_mqtt.o output_queue.o pulse_analyze.o pulse_demod.o pulse_detect.o pulse_file.o r_util.o redir_print.o samp_grab.o sdr.o term_ctl.o util.o acurite.o akhan_100F14.o alecto.o ambient_weather.o ambientweather_tx8300.o ambientweather_wh31e.o blyss.o brennenstuhl_rcs_2044.o bresser_3ch.o bresser_5in1.o bt_rain.o calibeur.o cardin.o chuango.o companion_wtr001.o current_cost.o danfoss.o digitech_xc0324.o directv.o dish_remote_6_3.o dsc.o ecowitt.o efergy_e2_classic.o efergy_optical.o elro_db286a.o elv.o emontx.o esa.o esperanza_ews.o eurochron.o fineoffset.o fineoffset_wh1050.o fineoffset_wh1080.o flex.o fordremote.o fs20.o ft004b.o ge_coloreffects.o generic_motion.o generic_remote.o generic_temperature_sensor.o gt_wt_02.o hcs200.o hideki.o holman_ws5029.o hondaremote.o honeywell.o honeywell_wdb.o ht680.o ibis_beacon.o ikea_sparsnas.o infactory.o inovalley-kw9015b.o interlogix.o intertechno.o kedsum.o kerui.o lacrosse.o lacrosse_TX141TH_Bv2.o lacrosse_tx35.o lacrosse_ws7000.o lacrossews.o lightwave_rf.o m_bus.o maverick_et73.o maverick_et73x.o mebus.o new_template.o newkaku.o nexa.o nexus.o oil_standard.o oil_watchman.o opus_xt300.o oregon_scientific.o oregon_scientific_sl109h.o oregon_scientific_v1.o philips.o prologue.o proove.o quhwa.o radiohead_ask.o rftech.o rubicson.o rubicson_48659.o s3318p.o schraeder.o silvercrest.o simplisafe.o smoke_gs558.o solight_te44.o springfield.o steelmate.o tfa_30_3196.o tfa_pool_thermometer.o tfa_twin_plus_30.3049.o thermopro_tp11.o thermopro_tp12.o tpms_citroen.o tpms_ford.o tpms_jansite.o tpms_pmv107j.o tpms_renault.o tpms_toyota.o ts_ft002.o ttx201.o vaillant_vrt340f.o waveman.o wg_pb12v1.o wssensor.o wt0124.o wt450.o x10_rf.o x10_sec.o
+gcc -Iinclude -o cbor_dump examples/cbor_dump.c librtl_433.a -lrtlsdr -lpthread -lm
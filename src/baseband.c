@@ -32,7 +32,7 @@ static void calc_squares()
     The output will be written in the input buffer
     @returns   pointer to the input buffer
 */
-void envelope_detect(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static void envelope_detect_scalar(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     for (i = 0; i < len; i++) {
@@ -57,7 +57,7 @@ void envelope_detect_nolut(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 /** 122/128, 51/128 Magnitude Estimator for CU8 (SIMD has min/max).
     Note that magnitude emphasizes quiet signals / deemphasizes loud signals.
 */
-void magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static void magnitude_est_cu8_scalar(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     for (i = 0; i < len; i++) {
@@ -71,7 +71,7 @@ void magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 }
 
 /// True Magnitude for CU8 (sqrt can SIMD but float is slow).
-void magnitude_true_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static void magnitude_true_cu8_scalar(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     for (i = 0; i < len; i++) {
@@ -82,7 +82,7 @@ void magnitude_true_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 }
 
 /// 122/128, 51/128 Magnitude Estimator for CS16 (SIMD has min/max).
-void magnitude_est_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static void magnitude_est_cs16_scalar(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     for (i = 0; i < len; i++) {
@@ -96,7 +96,7 @@ void magnitude_est_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 }
 
 /// True Magnitude for CS16 (sqrt can SIMD but float is slow).
-void magnitude_true_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+static void magnitude_true_cs16_scalar(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
 {
     unsigned long i;
     for (i = 0; i < len; i++) {
@@ -176,6 +176,12 @@ int16_t atan2_int16(int16_t y, int16_t x)
     return angle;
 }
 
+/// Samples per discriminator pass, keeps the phase tile in L1 for the low pass filter.
+#define FM_TILE_LEN 1024
+
+static void fm_discriminator_cu8(uint8_t const *x_buf, int16_t *phase, uint32_t len, int16_t br, int16_t bi);
+static void fm_discriminator_cs16(int16_t const *x_buf, int32_t *phase, uint32_t len, int32_t br, int32_t bi);
+
 void baseband_demod_FM(uint8_t const *x_buf, int16_t *y_buf, unsigned long num_samples, demodfm_state_t *state)
 {
     ///  [b,a] = butter(1, 0.1) -> 3x tau (95%) ~10 samples
@@ -185,36 +191,31 @@ void baseband_demod_FM(uint8_t const *x_buf, int16_t *y_buf, unsigned long num_s
     static int const alp[2] = {FIX(1.00000), FIX(0.50953)};
     static int const blp[2] = {FIX(0.24524), FIX(0.24524)};
 
-    int16_t ar, ai;  // New IQ sample: x[n]
     int16_t br, bi;  // Old IQ sample: x[n-1]
-    int32_t pr, pi;  // Phase difference vector
     int16_t xlp, ylp, xlp_old, ylp_old;  // Low Pass filter variables
 
     // Pre-feed old sample
-    ar = state->br; ai = state->bi;
+    br = state->br; bi = state->bi;
     xlp_old = state->xlp; ylp_old = state->ylp;
 
-    for (unsigned n = 0; n < num_samples; n++) {
-        // delay old sample
-        br = ar;
-        bi = ai;
-        // get new sample
-        ar = x_buf[2*n]-128;
-        ai = x_buf[2*n+1]-128;
-        // Calculate phase difference vector: x[n] * conj(x[n-1])
-        pr = ar*br+ai*bi;  // May exactly overflow an int16_t (-128*-128 + -128*-128)
-        pi = ai*br-ar*bi;
-//        xlp = (int16_t)((atan2f(pi, pr) / M_PI) * INT16_MAX);    // Floating point implementation
-        xlp = atan2_int16(pi, pr);  // Integer implementation
-//        xlp = pi;                    // Cheat and use only imaginary part (works OK, but is amplitude sensitive)
-        // Low pass filter
-        ylp = ((alp[1] * ylp_old >> 1) + (blp[0] * xlp >> 1) + (blp[1] * xlp_old >> 1)) >> (F_SCALE - 1);
-        ylp_old = ylp; xlp_old = xlp;
-        y_buf[n] = ylp;
+    for (unsigned long t = 0; t < num_samples; t += FM_TILE_LEN) {
+        unsigned len = num_samples - t < FM_TILE_LEN ? num_samples - t : FM_TILE_LEN;
+        // Phase difference of each sample, written in place of the output
+        fm_discriminator_cu8(&x_buf[2 * t], &y_buf[t], len, br, bi);
+        br = x_buf[2 * (t + len) - 2] - 128;
+        bi = x_buf[2 * (t + len) - 1] - 128;
+
+        for (unsigned n = t; n < t + len; n++) {
+            xlp = y_buf[n];
+            // Low pass filter
+            ylp = ((alp[1] * ylp_old >> 1) + (blp[0] * xlp >> 1) + (blp[1] * xlp_old >> 1)) >> (F_SCALE - 1);
+            ylp_old = ylp; xlp_old = xlp;
+            y_buf[n] = ylp;
+        }
     }
 
     // Store newest sample for next run
-    state->br = ar; state->bi = ai;
+    state->br = br; state->bi = bi;
     state->xlp = xlp_old; state->ylp = ylp_old;
 }
 
@@ -256,41 +257,818 @@ void baseband_demod_FM_cs16(int16_t const *x_buf, int16_t *y_buf, unsigned long
     static int64_t const alp[2] = {FIX32(1.00000), FIX32(0.50953)};
     static int64_t const blp[2] = {FIX32(0.24524), FIX32(0.24524)};
 
-    int32_t ar, ai;  // New IQ sample: x[n]
+    int32_t phase[FM_TILE_LEN]; // Phase difference vector angles
     int32_t br, bi;  // Old IQ sample: x[n-1]
-    int64_t pr, pi;  // Phase difference vector
     int32_t xlp, ylp, xlp_old, ylp_old;  // Low Pass filter variables
 
     // Pre-feed old sample
-    ar = state->br; ai = state->bi;
+    br = state->br; bi = state->bi;
     xlp_old = state->xlp; ylp_old = state->ylp;
 
-    for (unsigned n = 0; n < num_samples; n++) {
-        // delay old sample
-        br = ar;
-        bi = ai;
-        // get new sample
-        ar = x_buf[2*n];
-        ai = x_buf[2*n+1];
-        // Calculate phase difference vector: x[n] * conj(x[n-1])
-        pr = (int64_t)ar*br+ai*bi;  // May exactly overflow an int32_t (-32768*-32768 + -32768*-32768)
-        pi = (int64_t)ai*br-ar*bi;
-//        xlp = (int32_t)((atan2f(pi, pr) / M_PI) * INT32_MAX);    // Floating point implementation
-        xlp = atan2_int32(pi, pr);  // Integer implementation
-//        xlp = atan2_int16(pi>>16, pr>>16) << 16;  // Integer implementation
-//        xlp = pi;                    // Cheat and use only imaginary part (works OK, but is amplitude sensitive)
-        // Low pass filter
-        ylp = (alp[1] * ylp_old + blp[0] * xlp + blp[1] * xlp_old) >> F_SCALE32;
-        ylp_old = ylp; xlp_old = xlp;
-        y_buf[n] = ylp >> 16; // not really losing info here, maybe optimize earlier
+    for (unsigned long t = 0; t < num_samples; t += FM_TILE_LEN) {
+        unsigned len = num_samples - t < FM_TILE_LEN ? num_samples - t : FM_TILE_LEN;
+        fm_discriminator_cs16(&x_buf[2 * t], phase, len, br, bi);
+        br = x_buf[2 * (t + len) - 2];
+        bi = x_buf[2 * (t + len) - 1];
+
+        for (unsigned n = 0; n < len; n++) {
+            xlp = phase[n];
+            // Low pass filter
+            ylp = (alp[1] * ylp_old + blp[0] * xlp + blp[1] * xlp_old) >> F_SCALE32;
+            ylp_old = ylp; xlp_old = xlp;
+            y_buf[t + n] = ylp >> 16; // not really losing info here, maybe optimize earlier
+        }
     }
 
     // Store newest sample for next run
-    state->br = ar; state->bi = ai;
+    state->br = br; state->bi = bi;
     state->xlp = xlp_old; state->ylp = ylp_old;
 }
 
 void baseband_init(void)
 {
     calc_squares();
+    baseband_select_impl(0);
+}
+
+// SIMD kernels can be disabled at build time with -DBASEBAND_NO_SIMD
+#ifndef BASEBAND_NO_SIMD
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BASEBAND_HAVE_SSE2
+#define BASEBAND_HAVE_AVX2 // compiled with a function target attribute, selected if the CPU supports it
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BASEBAND_HAVE_NEON
+#endif
+#endif
+
+#ifdef BASEBAND_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef BASEBAND_HAVE_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define BASEBAND_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BASEBAND_TARGET_AVX2
+#endif
+#endif
+#ifdef BASEBAND_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+    SIMD variants of the kernels above.
+
+    All variants are bit-exact to the scalar reference: the integer kernels use
+    the same integer arithmetic, the true magnitude kernels use double precision
+    sqrt and truncation just like the scalar code. Each variant processes whole
+    vectors and hands the remaining tail samples to the scalar reference.
+*/
+
+#ifdef BASEBAND_HAVE_SSE2
+
+/// Envelope I*I + Q*Q for 8 CU8 samples with SSE2.
+static void envelope_detect_sse2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const bias = _mm_set1_epi16(127);
+    __m128i const offs = _mm_set1_epi32(32768);
+    __m128i const flip = _mm_set1_epi16((short)0x8000);
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i iq = _mm_loadu_si128((__m128i const *)&iq_buf[2 * i]);
+        __m128i lo = _mm_sub_epi16(bias, _mm_unpacklo_epi8(iq, zero));
+        __m128i hi = _mm_sub_epi16(bias, _mm_unpackhi_epi8(iq, zero));
+        // I*I + Q*Q is max 32768, offset into the signed range to pack without saturation
+        lo = _mm_sub_epi32(_mm_madd_epi16(lo, lo), offs);
+        hi = _mm_sub_epi32(_mm_madd_epi16(hi, hi), offs);
+        _mm_storeu_si128((__m128i *)&y_buf[i], _mm_xor_si128(_mm_packs_epi32(lo, hi), flip));
+    }
+    envelope_detect_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+/// 122 * max + 51 * min of absolute I/Q pairs (int16 lanes) into int32 lanes.
+static inline __m128i magnitude_est_pairs_sse2(__m128i a)
+{
+    __m128i const coef = _mm_set1_epi32((51 << 16) | 122);
+    __m128i const even = _mm_set1_epi32(0x0000ffff);
+    __m128i s  = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, 0xb1), 0xb1); // swap I and Q
+    __m128i mx = _mm_max_epi16(a, s);
+    __m128i mi = _mm_min_epi16(a, s);
+    return _mm_madd_epi16(_mm_or_si128(_mm_and_si128(even, mx), _mm_andnot_si128(even, mi)), coef);
+}
+
+static void magnitude_est_cu8_sse2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const bias = _mm_set1_epi16(128);
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i iq = _mm_loadu_si128((__m128i const *)&iq_buf[2 * i]);
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(iq, zero), bias);
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(iq, zero), bias);
+        lo = _mm_max_epi16(lo, _mm_sub_epi16(zero, lo)); // abs
+        hi = _mm_max_epi16(hi, _mm_sub_epi16(zero, hi));
+        lo = magnitude_est_pairs_sse2(lo); // max 22144
+        hi = magnitude_est_pairs_sse2(hi);
+        _mm_storeu_si128((__m128i *)&y_buf[i], _mm_packs_epi32(lo, hi));
+    }
+    magnitude_est_cu8_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+/// Magnitude estimate of 4 CS16 samples into int32 lanes (SSE2 has no 32-bit min/max/mullo).
+static inline __m128i magnitude_est_cs16_quad_sse2(__m128i iq)
+{
+    __m128i x  = _mm_srai_epi32(_mm_slli_epi32(iq, 16), 16); // sign extend I
+    __m128i y  = _mm_srai_epi32(iq, 16);                     // sign extend Q
+    __m128i sx = _mm_srai_epi32(x, 31);
+    __m128i sy = _mm_srai_epi32(y, 31);
+    x = _mm_sub_epi32(_mm_xor_si128(x, sx), sx); // abs, max 32768
+    y = _mm_sub_epi32(_mm_xor_si128(y, sy), sy);
+    __m128i gt = _mm_cmpgt_epi32(x, y);
+    __m128i mx = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, y));
+    __m128i mi = _mm_or_si128(_mm_and_si128(gt, y), _mm_andnot_si128(gt, x));
+    // 122 = 128 - 4 - 2, 51 = 32 + 16 + 2 + 1
+    __m128i r = _mm_sub_epi32(_mm_slli_epi32(mx, 7), _mm_add_epi32(_mm_slli_epi32(mx, 2), _mm_slli_epi32(mx, 1)));
+    r = _mm_add_epi32(r, _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(mi, 5), _mm_slli_epi32(mi, 4)),
+                                     _mm_add_epi32(_mm_slli_epi32(mi, 1), mi)));
+    return _mm_srli_epi32(r, 8); // max 22144
+}
+
+static void magnitude_est_cs16_sse2(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i lo = magnitude_est_cs16_quad_sse2(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i]));
+        __m128i hi = magnitude_est_cs16_quad_sse2(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i + 8]));
+        _mm_storeu_si128((__m128i *)&y_buf[i], _mm_packs_epi32(lo, hi));
+    }
+    magnitude_est_cs16_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+/// Truncate int32 lanes to their low 16 bits (as a store to uint16_t would) and pack.
+static inline __m128i pack_low16_sse2(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+}
+
+/// Truncated sqrt(n) * scale of 4 int32 lanes, in double precision like the scalar code.
+static inline __m128i sqrt_scaled_sse2(__m128i n, double scale)
+{
+    __m128d const s = _mm_set1_pd(scale);
+    __m128d lo = _mm_mul_pd(_mm_sqrt_pd(_mm_cvtepi32_pd(n)), s);
+    __m128d hi = _mm_mul_pd(_mm_sqrt_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(n, 0xee))), s);
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+static void magnitude_true_cu8_sse2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const bias = _mm_set1_epi16(128);
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i iq = _mm_loadu_si128((__m128i const *)&iq_buf[2 * i]);
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(iq, zero), bias);
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(iq, zero), bias);
+        lo = sqrt_scaled_sse2(_mm_madd_epi16(lo, lo), 128.0);
+        hi = sqrt_scaled_sse2(_mm_madd_epi16(hi, hi), 128.0);
+        _mm_storeu_si128((__m128i *)&y_buf[i], pack_low16_sse2(lo, hi));
+    }
+    magnitude_true_cu8_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+static void magnitude_true_cs16_sse2(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i lo = _mm_loadu_si128((__m128i const *)&iq_buf[2 * i]);
+        __m128i hi = _mm_loadu_si128((__m128i const *)&iq_buf[2 * i + 8]);
+        // x * x + y * y wraps identically to the scalar int32 arithmetic
+        lo = _mm_srai_epi32(sqrt_scaled_sse2(_mm_madd_epi16(lo, lo), 1.0), 1);
+        hi = _mm_srai_epi32(sqrt_scaled_sse2(_mm_madd_epi16(hi, hi), 1.0), 1);
+        _mm_storeu_si128((__m128i *)&y_buf[i], pack_low16_sse2(lo, hi));
+    }
+    magnitude_true_cs16_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+#endif /* BASEBAND_HAVE_SSE2 */
+
+#ifdef BASEBAND_HAVE_AVX2
+
+/// Check that the CPU and OS support AVX2.
+static int cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return 0;
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28)) // OSXSAVE and AVX
+        return 0;
+    if ((_xgetbv(0) & 6) != 6) // OS saves XMM and YMM state
+        return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+/// Restore sample order after an in-lane 32 to 16 bit pack.
+#define PACK_ORDER_AVX2(v) _mm256_permute4x64_epi64((v), 0xd8)
+
+BASEBAND_TARGET_AVX2
+static void envelope_detect_avx2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m256i const bias = _mm256_set1_epi16(127);
+    __m256i const offs = _mm256_set1_epi32(32768);
+    __m256i const flip = _mm256_set1_epi16((short)0x8000);
+    uint32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i lo = _mm256_sub_epi16(bias, _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i])));
+        __m256i hi = _mm256_sub_epi16(bias, _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i + 16])));
+        lo = _mm256_sub_epi32(_mm256_madd_epi16(lo, lo), offs);
+        hi = _mm256_sub_epi32(_mm256_madd_epi16(hi, hi), offs);
+        __m256i y = PACK_ORDER_AVX2(_mm256_packs_epi32(lo, hi));
+        _mm256_storeu_si256((__m256i *)&y_buf[i], _mm256_xor_si256(y, flip));
+    }
+    envelope_detect_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+BASEBAND_TARGET_AVX2
+static inline __m256i magnitude_est_pairs_avx2(__m256i a)
+{
+    __m256i const coef = _mm256_set1_epi32((51 << 16) | 122);
+    __m256i const even = _mm256_set1_epi32(0x0000ffff);
+    __m256i s  = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a, 0xb1), 0xb1); // swap I and Q
+    __m256i mx = _mm256_max_epi16(a, s);
+    __m256i mi = _mm256_min_epi16(a, s);
+    return _mm256_madd_epi16(_mm256_blendv_epi8(mi, mx, even), coef);
+}
+
+BASEBAND_TARGET_AVX2
+static void magnitude_est_cu8_avx2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m256i const bias = _mm256_set1_epi16(128);
+    uint32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i lo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i])), bias);
+        __m256i hi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i + 16])), bias);
+        lo = magnitude_est_pairs_avx2(_mm256_abs_epi16(lo));
+        hi = magnitude_est_pairs_avx2(_mm256_abs_epi16(hi));
+        _mm256_storeu_si256((__m256i *)&y_buf[i], PACK_ORDER_AVX2(_mm256_packs_epi32(lo, hi)));
+    }
+    magnitude_est_cu8_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+BASEBAND_TARGET_AVX2
+static inline __m256i magnitude_est_cs16_oct_avx2(__m256i iq)
+{
+    __m256i x  = _mm256_abs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(iq, 16), 16));
+    __m256i y  = _mm256_abs_epi32(_mm256_srai_epi32(iq, 16));
+    __m256i mx = _mm256_max_epi32(x, y);
+    __m256i mi = _mm256_min_epi32(x, y);
+    __m256i r  = _mm256_add_epi32(_mm256_mullo_epi32(mx, _mm256_set1_epi32(122)),
+                                  _mm256_mullo_epi32(mi, _mm256_set1_epi32(51)));
+    return _mm256_srli_epi32(r, 8);
+}
+
+BASEBAND_TARGET_AVX2
+static void magnitude_est_cs16_avx2(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i lo = magnitude_est_cs16_oct_avx2(_mm256_loadu_si256((__m256i const *)&iq_buf[2 * i]));
+        __m256i hi = magnitude_est_cs16_oct_avx2(_mm256_loadu_si256((__m256i const *)&iq_buf[2 * i + 16]));
+        _mm256_storeu_si256((__m256i *)&y_buf[i], PACK_ORDER_AVX2(_mm256_packs_epi32(lo, hi)));
+    }
+    magnitude_est_cs16_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+BASEBAND_TARGET_AVX2
+static inline __m256i sqrt_scaled_avx2(__m256i n, double scale)
+{
+    __m256d const s = _mm256_set1_pd(scale);
+    __m256d lo = _mm256_mul_pd(_mm256_sqrt_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(n))), s);
+    __m256d hi = _mm256_mul_pd(_mm256_sqrt_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(n, 1))), s);
+    return _mm256_set_m128i(_mm256_cvttpd_epi32(hi), _mm256_cvttpd_epi32(lo));
+}
+
+BASEBAND_TARGET_AVX2
+static inline __m256i pack_low16_avx2(__m256i lo, __m256i hi)
+{
+    lo = _mm256_srai_epi32(_mm256_slli_epi32(lo, 16), 16);
+    hi = _mm256_srai_epi32(_mm256_slli_epi32(hi, 16), 16);
+    return PACK_ORDER_AVX2(_mm256_packs_epi32(lo, hi));
+}
+
+BASEBAND_TARGET_AVX2
+static void magnitude_true_cu8_avx2(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    __m256i const bias = _mm256_set1_epi16(128);
+    uint32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i lo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i])), bias);
+        __m256i hi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&iq_buf[2 * i + 16])), bias);
+        lo = sqrt_scaled_avx2(_mm256_madd_epi16(lo, lo), 128.0);
+        hi = sqrt_scaled_avx2(_mm256_madd_epi16(hi, hi), 128.0);
+        _mm256_storeu_si256((__m256i *)&y_buf[i], pack_low16_avx2(lo, hi));
+    }
+    magnitude_true_cu8_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+BASEBAND_TARGET_AVX2
+static void magnitude_true_cs16_avx2(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m256i lo = _mm256_loadu_si256((__m256i const *)&iq_buf[2 * i]);
+        __m256i hi = _mm256_loadu_si256((__m256i const *)&iq_buf[2 * i + 16]);
+        lo = _mm256_srai_epi32(sqrt_scaled_avx2(_mm256_madd_epi16(lo, lo), 1.0), 1);
+        hi = _mm256_srai_epi32(sqrt_scaled_avx2(_mm256_madd_epi16(hi, hi), 1.0), 1);
+        _mm256_storeu_si256((__m256i *)&y_buf[i], pack_low16_avx2(lo, hi));
+    }
+    magnitude_true_cs16_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+#endif /* BASEBAND_HAVE_AVX2 */
+
+#ifdef BASEBAND_HAVE_NEON
+
+static void envelope_detect_neon(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    int16x8_t const bias = vdupq_n_s16(127);
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint8x8x2_t iq = vld2_u8(&iq_buf[2 * i]); // deinterleave I and Q
+        int16x8_t x = vsubq_s16(bias, vreinterpretq_s16_u16(vmovl_u8(iq.val[0])));
+        int16x8_t y = vsubq_s16(bias, vreinterpretq_s16_u16(vmovl_u8(iq.val[1])));
+        uint16x8_t xx = vreinterpretq_u16_s16(vmulq_s16(x, x));
+        uint16x8_t yy = vreinterpretq_u16_s16(vmulq_s16(y, y));
+        vst1q_u16(&y_buf[i], vaddq_u16(xx, yy)); // max 32768
+    }
+    envelope_detect_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+static void magnitude_est_cu8_neon(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint8x8_t const bias = vdup_n_u8(128);
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint8x8x2_t iq = vld2_u8(&iq_buf[2 * i]);
+        uint8x8_t x = vabd_u8(iq.val[0], bias); // max 128
+        uint8x8_t y = vabd_u8(iq.val[1], bias);
+        uint16x8_t mx = vmovl_u8(vmax_u8(x, y));
+        uint16x8_t mi = vmovl_u8(vmin_u8(x, y));
+        vst1q_u16(&y_buf[i], vmlaq_n_u16(vmulq_n_u16(mx, 122), mi, 51));
+    }
+    magnitude_est_cu8_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+static inline uint16x4_t magnitude_est_cs16_quad_neon(int16x4_t i_val, int16x4_t q_val)
+{
+    uint32x4_t x  = vreinterpretq_u32_s32(vabsq_s32(vmovl_s16(i_val)));
+    uint32x4_t y  = vreinterpretq_u32_s32(vabsq_s32(vmovl_s16(q_val)));
+    uint32x4_t mx = vmaxq_u32(x, y);
+    uint32x4_t mi = vminq_u32(x, y);
+    return vshrn_n_u32(vmlaq_n_u32(vmulq_n_u32(mx, 122), mi, 51), 8);
+}
+
+static void magnitude_est_cs16_neon(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        int16x8x2_t iq = vld2q_s16(&iq_buf[2 * i]);
+        uint16x4_t lo = magnitude_est_cs16_quad_neon(vget_low_s16(iq.val[0]), vget_low_s16(iq.val[1]));
+        uint16x4_t hi = magnitude_est_cs16_quad_neon(vget_high_s16(iq.val[0]), vget_high_s16(iq.val[1]));
+        vst1q_u16(&y_buf[i], vcombine_u16(lo, hi));
+    }
+    magnitude_est_cs16_scalar(iq_buf + 2 * i, y_buf + i, len - i);
+}
+
+#endif /* BASEBAND_HAVE_NEON */
+
+/*
+    FM discriminator kernels: the phase of x[n] * conj(x[n-1]) for a block of
+    samples, x[-1] is passed in. The low pass filter runs as a separate pass,
+    see baseband_demod_FM().
+*/
+
+static void fm_discriminator_cu8_scalar(uint8_t const *x_buf, int16_t *phase, uint32_t len, int16_t br, int16_t bi)
+{
+    for (uint32_t n = 0; n < len; n++) {
+        int16_t ar = x_buf[2 * n] - 128;
+        int16_t ai = x_buf[2 * n + 1] - 128;
+        // Calculate phase difference vector: x[n] * conj(x[n-1])
+        int32_t pr = ar * br + ai * bi; // May exactly overflow an int16_t (-128*-128 + -128*-128)
+        int32_t pi = ai * br - ar * bi;
+//        phase[n] = (int16_t)((atan2f(pi, pr) / M_PI) * INT16_MAX);    // Floating point implementation
+        phase[n] = atan2_int16(pi, pr); // Integer implementation
+//        phase[n] = pi;                  // Cheat and use only imaginary part (works OK, but is amplitude sensitive)
+        br = ar;
+        bi = ai;
+    }
+}
+
+static void fm_discriminator_cs16_scalar(int16_t const *x_buf, int32_t *phase, uint32_t len, int32_t br, int32_t bi)
+{
+    for (uint32_t n = 0; n < len; n++) {
+        int32_t ar = x_buf[2 * n];
+        int32_t ai = x_buf[2 * n + 1];
+        // Calculate phase difference vector: x[n] * conj(x[n-1])
+        int64_t pr = (int64_t)ar * br + ai * bi; // May exactly overflow an int32_t (-32768*-32768 + -32768*-32768)
+        int64_t pi = (int64_t)ai * br - ar * bi;
+//        phase[n] = (int32_t)((atan2f(pi, pr) / M_PI) * INT32_MAX);    // Floating point implementation
+        phase[n] = atan2_int32(pi, pr); // Integer implementation
+//        phase[n] = atan2_int16(pi>>16, pr>>16) << 16;  // Integer implementation
+        br = ar;
+        bi = ai;
+    }
+}
+
+#ifdef BASEBAND_HAVE_SSE2
+
+/// Low 32 bits of a * b for non-negative int32 lanes (SSE2 has no mullo_epi32).
+static inline __m128i mullo_epi32_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08), _mm_shuffle_epi32(odd, 0x08));
+}
+
+/** atan2_int16() on int32 lanes holding int16 values.
+
+    The quotient is estimated with a reciprocal (one Newton-Raphson step),
+    which is off by at most one, then corrected to the truncated integer
+    quotient. The result is exact.
+*/
+static inline __m128i atan2_int16_sse2(__m128i y, __m128i x)
+{
+    __m128i const pi_4   = _mm_set1_epi32(INT16_MAX / 4);
+    __m128i const pi_3_4 = _mm_set1_epi32(3 * INT16_MAX / 4);
+    __m128i xs  = _mm_srai_epi32(x, 31);
+    __m128i ys  = _mm_srai_epi32(y, 31);
+    __m128i ax  = _mm_sub_epi32(_mm_xor_si128(x, xs), xs);
+    __m128i ay  = _mm_sub_epi32(_mm_xor_si128(y, ys), ys);
+    __m128i den = _mm_add_epi32(ax, ay);
+    den = _mm_sub_epi32(den, _mm_cmpeq_epi32(den, _mm_setzero_si128())); // Prevent divide by zero
+    __m128i dif = _mm_sub_epi32(ax, ay);
+    __m128i ds  = _mm_srai_epi32(dif, 31);
+    __m128i num = mullo_epi32_sse2(_mm_sub_epi32(_mm_xor_si128(dif, ds), ds), pi_4);
+
+    __m128 fden = _mm_cvtepi32_ps(den);
+    __m128 rcp  = _mm_rcp_ps(fden);
+    rcp = _mm_mul_ps(rcp, _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(fden, rcp)));
+    __m128i quo = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(num), rcp));
+    __m128i rem = _mm_sub_epi32(num, mullo_epi32_sse2(quo, den));
+    quo = _mm_add_epi32(quo, _mm_srai_epi32(rem, 31));                                   // rem < 0: one less
+    quo = _mm_sub_epi32(quo, _mm_cmpgt_epi32(rem, _mm_sub_epi32(den, _mm_set1_epi32(1)))); // rem >= den: one more
+    quo = _mm_sub_epi32(_mm_xor_si128(quo, ds), ds);
+
+    // Quadrant I and IV: pi/4 - quo, Quadrant II and III: 3pi/4 + quo
+    __m128i angle = _mm_or_si128(_mm_andnot_si128(xs, _mm_sub_epi32(pi_4, quo)), _mm_and_si128(xs, _mm_add_epi32(pi_3_4, quo)));
+    return _mm_sub_epi32(_mm_xor_si128(angle, ys), ys); // Negate if in III or IV
+}
+
+/// Phase of x[n] * conj(x[n-1]) for 4 CU8 samples in int16 I/Q pairs.
+static inline __m128i fm_phase_cu8_sse2(__m128i a, __m128i b)
+{
+    __m128i const even = _mm_set1_epi32(0x0000ffff);
+    __m128i pr = _mm_madd_epi16(a, b); // ar*br + ai*bi
+    __m128i bs = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b, 0xb1), 0xb1);
+    bs = _mm_or_si128(_mm_and_si128(even, _mm_sub_epi16(_mm_setzero_si128(), bs)), _mm_andnot_si128(even, bs));
+    __m128i pi = _mm_madd_epi16(a, bs); // ai*br - ar*bi
+    // atan2_int16() takes int16_t, truncate just like the scalar call
+    pr = _mm_srai_epi32(_mm_slli_epi32(pr, 16), 16);
+    pi = _mm_srai_epi32(_mm_slli_epi32(pi, 16), 16);
+    return atan2_int16_sse2(pi, pr);
+}
+
+static void fm_discriminator_cu8_sse2(uint8_t const *x_buf, int16_t *phase, uint32_t len, int16_t br, int16_t bi)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const bias = _mm_set1_epi16(128);
+    uint32_t n = 1;
+    if (!len)
+        return;
+    fm_discriminator_cu8_scalar(x_buf, phase, 1, br, bi);
+    for (; n + 8 <= len; n += 8) {
+        __m128i a = _mm_loadu_si128((__m128i const *)&x_buf[2 * n]);     // x[n]
+        __m128i b = _mm_loadu_si128((__m128i const *)&x_buf[2 * n - 2]); // x[n-1]
+        __m128i lo = fm_phase_cu8_sse2(_mm_sub_epi16(_mm_unpacklo_epi8(a, zero), bias), _mm_sub_epi16(_mm_unpacklo_epi8(b, zero), bias));
+        __m128i hi = fm_phase_cu8_sse2(_mm_sub_epi16(_mm_unpackhi_epi8(a, zero), bias), _mm_sub_epi16(_mm_unpackhi_epi8(b, zero), bias));
+        _mm_storeu_si128((__m128i *)&phase[n], _mm_packs_epi32(lo, hi));
+    }
+    fm_discriminator_cu8_scalar(x_buf + 2 * n, phase + n, len - n, x_buf[2 * n - 2] - 128, x_buf[2 * n - 1] - 128);
+}
+
+/// atan2_int32() approximation on 2 lanes, returns the unsigned angle in the low int32 lanes.
+static inline __m128i atan2_int32_half_sse2(__m128d ay, __m128d x)
+{
+    __m128d const pi_4   = _mm_set1_pd(INT32_MAX / 4);
+    __m128d const pi_3_4 = _mm_set1_pd(3ll * INT32_MAX / 4);
+    __m128d const one    = _mm_set1_pd(1.0);
+    __m128d const two    = _mm_set1_pd(2.0);
+    __m128d xneg = _mm_cmplt_pd(x, _mm_setzero_pd());
+    __m128d ax   = _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+    __m128d den  = _mm_add_pd(ax, ay);
+    den = _mm_add_pd(den, _mm_and_pd(_mm_cmpeq_pd(den, _mm_setzero_pd()), one)); // Prevent divide by zero
+    // float reciprocal estimate, refined by two Newton-Raphson steps
+    __m128d rcp = _mm_cvtps_pd(_mm_rcp_ps(_mm_cvtpd_ps(den)));
+    rcp = _mm_mul_pd(rcp, _mm_sub_pd(two, _mm_mul_pd(den, rcp)));
+    rcp = _mm_mul_pd(rcp, _mm_sub_pd(two, _mm_mul_pd(den, rcp)));
+    __m128d quo = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_mul_pd(_mm_mul_pd(pi_4, _mm_sub_pd(ax, ay)), rcp)));
+    // Quadrant I and IV: pi/4 - quo, Quadrant II and III: 3pi/4 + quo
+    __m128d angle = _mm_or_pd(_mm_andnot_pd(xneg, _mm_sub_pd(pi_4, quo)), _mm_and_pd(xneg, _mm_add_pd(pi_3_4, quo)));
+    return _mm_cvttpd_epi32(angle);
+}
+
+static inline __m128i atan2_int32_sse2(__m128i y, __m128i x)
+{
+    __m128i ys = _mm_srai_epi32(y, 31);
+    __m128i ay = _mm_sub_epi32(_mm_xor_si128(y, ys), ys);
+    __m128i lo = atan2_int32_half_sse2(_mm_cvtepi32_pd(ay), _mm_cvtepi32_pd(x));
+    __m128i hi = atan2_int32_half_sse2(_mm_cvtepi32_pd(_mm_shuffle_epi32(ay, 0xee)), _mm_cvtepi32_pd(_mm_shuffle_epi32(x, 0xee)));
+    __m128i angle = _mm_unpacklo_epi64(lo, hi);
+    return _mm_sub_epi32(_mm_xor_si128(angle, ys), ys); // Negate if in III or IV
+}
+
+/// Phase of x[n] * conj(x[n-1]) for 4 CS16 samples.
+static inline __m128i fm_phase_cs16_sse2(__m128i a, __m128i b)
+{
+    __m128i pr = _mm_madd_epi16(a, b); // ar*br + ai*bi, truncated to int32 just like the scalar call
+    __m128i bs = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b, 0xb1), 0xb1);
+    __m128i lo = _mm_mullo_epi16(a, bs);
+    __m128i hi = _mm_mulhi_epi16(a, bs);
+    __m128i p0 = _mm_unpacklo_epi16(lo, hi); // ar*bi, ai*br
+    __m128i p1 = _mm_unpackhi_epi16(lo, hi);
+    p0 = _mm_sub_epi32(_mm_srli_epi64(p0, 32), p0);
+    p1 = _mm_sub_epi32(_mm_srli_epi64(p1, 32), p1);
+    __m128i pi = _mm_unpacklo_epi64(_mm_shuffle_epi32(p0, 0x08), _mm_shuffle_epi32(p1, 0x08)); // ai*br - ar*bi
+    return atan2_int32_sse2(pi, pr);
+}
+
+static void fm_discriminator_cs16_sse2(int16_t const *x_buf, int32_t *phase, uint32_t len, int32_t br, int32_t bi)
+{
+    uint32_t n = 1;
+    if (!len)
+        return;
+    fm_discriminator_cs16_scalar(x_buf, phase, 1, br, bi);
+    for (; n + 4 <= len; n += 4) {
+        __m128i a = _mm_loadu_si128((__m128i const *)&x_buf[2 * n]);     // x[n]
+        __m128i b = _mm_loadu_si128((__m128i const *)&x_buf[2 * n - 2]); // x[n-1]
+        _mm_storeu_si128((__m128i *)&phase[n], fm_phase_cs16_sse2(a, b));
+    }
+    fm_discriminator_cs16_scalar(x_buf + 2 * n, phase + n, len - n, x_buf[2 * n - 2], x_buf[2 * n - 1]);
+}
+
+#endif /* BASEBAND_HAVE_SSE2 */
+
+#ifdef BASEBAND_HAVE_AVX2
+
+/// See atan2_int16_sse2().
+BASEBAND_TARGET_AVX2
+static inline __m256i atan2_int16_avx2(__m256i y, __m256i x)
+{
+    __m256i const pi_4   = _mm256_set1_epi32(INT16_MAX / 4);
+    __m256i const pi_3_4 = _mm256_set1_epi32(3 * INT16_MAX / 4);
+    __m256i xs  = _mm256_srai_epi32(x, 31);
+    __m256i ay  = _mm256_abs_epi32(y);
+    __m256i den = _mm256_max_epi32(_mm256_add_epi32(_mm256_abs_epi32(x), ay), _mm256_set1_epi32(1)); // Prevent divide by zero
+    __m256i dif = _mm256_sub_epi32(_mm256_abs_epi32(x), ay);
+    __m256i num = _mm256_mullo_epi32(_mm256_abs_epi32(dif), pi_4);
+
+    __m256 fden = _mm256_cvtepi32_ps(den);
+    __m256 rcp  = _mm256_rcp_ps(fden);
+    rcp = _mm256_mul_ps(rcp, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(fden, rcp)));
+    __m256i quo = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(num), rcp));
+    __m256i rem = _mm256_sub_epi32(num, _mm256_mullo_epi32(quo, den));
+    quo = _mm256_add_epi32(quo, _mm256_srai_epi32(rem, 31));                                     // rem < 0: one less
+    quo = _mm256_sub_epi32(quo, _mm256_cmpgt_epi32(rem, _mm256_sub_epi32(den, _mm256_set1_epi32(1)))); // rem >= den: one more
+    quo = _mm256_sign_epi32(quo, dif);
+
+    // Quadrant I and IV: pi/4 - quo, Quadrant II and III: 3pi/4 + quo
+    __m256i angle = _mm256_blendv_epi8(_mm256_sub_epi32(pi_4, quo), _mm256_add_epi32(pi_3_4, quo), xs);
+    return _mm256_sign_epi32(angle, _mm256_or_si256(y, _mm256_set1_epi32(1))); // Negate if in III or IV
+}
+
+BASEBAND_TARGET_AVX2
+static inline __m256i fm_phase_cu8_avx2(__m256i a, __m256i b)
+{
+    __m256i pr = _mm256_madd_epi16(a, b); // ar*br + ai*bi
+    __m256i bs = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(b, 0xb1), 0xb1);
+    __m256i pi = _mm256_madd_epi16(a, _mm256_sign_epi16(bs, _mm256_set1_epi32(0x0001ffff))); // ai*br - ar*bi
+    // atan2_int16() takes int16_t, truncate just like the scalar call
+    pr = _mm256_srai_epi32(_mm256_slli_epi32(pr, 16), 16);
+    pi = _mm256_srai_epi32(_mm256_slli_epi32(pi, 16), 16);
+    return atan2_int16_avx2(pi, pr);
+}
+
+BASEBAND_TARGET_AVX2
+static void fm_discriminator_cu8_avx2(uint8_t const *x_buf, int16_t *phase, uint32_t len, int16_t br, int16_t bi)
+{
+    __m256i const bias = _mm256_set1_epi16(128);
+    uint32_t n = 1;
+    if (!len)
+        return;
+    fm_discriminator_cu8_scalar(x_buf, phase, 1, br, bi);
+    for (; n + 16 <= len; n += 16) {
+        __m256i alo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&x_buf[2 * n])), bias);
+        __m256i ahi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&x_buf[2 * n + 16])), bias);
+        __m256i blo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&x_buf[2 * n - 2])), bias);
+        __m256i bhi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const *)&x_buf[2 * n + 14])), bias);
+        __m256i lo  = fm_phase_cu8_avx2(alo, blo);
+        __m256i hi  = fm_phase_cu8_avx2(ahi, bhi);
+        _mm256_storeu_si256((__m256i *)&phase[n], PACK_ORDER_AVX2(_mm256_packs_epi32(lo, hi)));
+    }
+    fm_discriminator_cu8_scalar(x_buf + 2 * n, phase + n, len - n, x_buf[2 * n - 2] - 128, x_buf[2 * n - 1] - 128);
+}
+
+#endif /* BASEBAND_HAVE_AVX2 */
+
+#ifdef BASEBAND_HAVE_NEON
+
+/// See atan2_int16_sse2().
+static inline int32x4_t atan2_int16_neon(int32x4_t y, int32x4_t x)
+{
+    int32x4_t const pi_4   = vdupq_n_s32(INT16_MAX / 4);
+    int32x4_t const pi_3_4 = vdupq_n_s32(3 * INT16_MAX / 4);
+    int32x4_t ay  = vabsq_s32(y);
+    int32x4_t den = vmaxq_s32(vaddq_s32(vabsq_s32(x), ay), vdupq_n_s32(1)); // Prevent divide by zero
+    int32x4_t dif = vsubq_s32(vabsq_s32(x), ay);
+    int32x4_t ds  = vshrq_n_s32(dif, 31);
+    int32x4_t num = vmulq_s32(vabsq_s32(dif), pi_4);
+
+    float32x4_t fden = vcvtq_f32_s32(den);
+    float32x4_t rcp  = vrecpeq_f32(fden);
+    rcp = vmulq_f32(vrecpsq_f32(fden, rcp), rcp);
+    rcp = vmulq_f32(vrecpsq_f32(fden, rcp), rcp);
+    int32x4_t quo = vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(num), rcp));
+    int32x4_t rem = vsubq_s32(num, vmulq_s32(quo, den));
+    quo = vaddq_s32(quo, vshrq_n_s32(rem, 31));                                  // rem < 0: one less
+    quo = vsubq_s32(quo, vreinterpretq_s32_u32(vcgeq_s32(rem, den)));             // rem >= den: one more
+    quo = vsubq_s32(veorq_s32(quo, ds), ds);
+
+    // Quadrant I and IV: pi/4 - quo, Quadrant II and III: 3pi/4 + quo
+    int32x4_t angle = vbslq_s32(vcltq_s32(x, vdupq_n_s32(0)), vaddq_s32(pi_3_4, quo), vsubq_s32(pi_4, quo));
+    int32x4_t ys    = vshrq_n_s32(y, 31);
+    return vsubq_s32(veorq_s32(angle, ys), ys); // Negate if in III or IV
+}
+
+/// Phase of x[n] * conj(x[n-1]) for 4 CU8 samples, I and Q deinterleaved.
+static inline int16x4_t fm_phase_cu8_neon(int16x4_t ar, int16x4_t ai, int16x4_t br, int16x4_t bi)
+{
+    int32x4_t pr = vmlal_s16(vmull_s16(ar, br), ai, bi); // ar*br + ai*bi
+    int32x4_t pi = vmlsl_s16(vmull_s16(ai, br), ar, bi); // ai*br - ar*bi
+    // atan2_int16() takes int16_t, truncate just like the scalar call
+    pr = vmovl_s16(vmovn_s32(pr));
+    pi = vmovl_s16(vmovn_s32(pi));
+    return vmovn_s32(atan2_int16_neon(pi, pr));
+}
+
+static void fm_discriminator_cu8_neon(uint8_t const *x_buf, int16_t *phase, uint32_t len, int16_t br, int16_t bi)
+{
+    uint8x8_t const bias = vdup_n_u8(128);
+    uint32_t n = 1;
+    if (!len)
+        return;
+    fm_discriminator_cu8_scalar(x_buf, phase, 1, br, bi);
+    for (; n + 8 <= len; n += 8) {
+        uint8x8x2_t a = vld2_u8(&x_buf[2 * n]);     // x[n]
+        uint8x8x2_t b = vld2_u8(&x_buf[2 * n - 2]); // x[n-1]
+        int16x8_t cur_r = vreinterpretq_s16_u16(vsubl_u8(a.val[0], bias));
+        int16x8_t cur_i = vreinterpretq_s16_u16(vsubl_u8(a.val[1], bias));
+        int16x8_t prev_r = vreinterpretq_s16_u16(vsubl_u8(b.val[0], bias));
+        int16x8_t prev_i = vreinterpretq_s16_u16(vsubl_u8(b.val[1], bias));
+        int16x4_t lo = fm_phase_cu8_neon(vget_low_s16(cur_r), vget_low_s16(cur_i), vget_low_s16(prev_r), vget_low_s16(prev_i));
+        int16x4_t hi = fm_phase_cu8_neon(vget_high_s16(cur_r), vget_high_s16(cur_i), vget_high_s16(prev_r), vget_high_s16(prev_i));
+        vst1q_s16(&phase[n], vcombine_s16(lo, hi));
+    }
+    fm_discriminator_cu8_scalar(x_buf + 2 * n, phase + n, len - n, x_buf[2 * n - 2] - 128, x_buf[2 * n - 1] - 128);
+}
+
+#endif /* BASEBAND_HAVE_NEON */
+
+/// Kernel dispatch table, filled once by baseband_select_impl().
+static struct {
+    baseband_impl_t impl;
+    void (*envelope_detect)(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+    void (*magnitude_est_cu8)(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+    void (*magnitude_true_cu8)(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+    void (*magnitude_est_cs16)(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+    void (*magnitude_true_cs16)(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len);
+    void (*fm_discriminator_cu8)(uint8_t const *x_buf, int16_t *phase, uint32_t len, int16_t br, int16_t bi);
+    void (*fm_discriminator_cs16)(int16_t const *x_buf, int32_t *phase, uint32_t len, int32_t br, int32_t bi);
+} kernels = {
+        BASEBAND_IMPL_SCALAR,
+        envelope_detect_scalar,
+        magnitude_est_cu8_scalar,
+        magnitude_true_cu8_scalar,
+        magnitude_est_cs16_scalar,
+        magnitude_true_cs16_scalar,
+        fm_discriminator_cu8_scalar,
+        fm_discriminator_cs16_scalar,
+};
+
+baseband_impl_t baseband_select_impl(int force_scalar)
+{
+    kernels.impl                = BASEBAND_IMPL_SCALAR;
+    kernels.envelope_detect     = envelope_detect_scalar;
+    kernels.magnitude_est_cu8   = magnitude_est_cu8_scalar;
+    kernels.magnitude_true_cu8  = magnitude_true_cu8_scalar;
+    kernels.magnitude_est_cs16  = magnitude_est_cs16_scalar;
+    kernels.magnitude_true_cs16 = magnitude_true_cs16_scalar;
+    kernels.fm_discriminator_cu8  = fm_discriminator_cu8_scalar;
+    kernels.fm_discriminator_cs16 = fm_discriminator_cs16_scalar;
+    if (force_scalar)
+        return kernels.impl;
+
+#ifdef BASEBAND_HAVE_SSE2
+    kernels.impl                = BASEBAND_IMPL_SSE2;
+    kernels.envelope_detect     = envelope_detect_sse2;
+    kernels.magnitude_est_cu8   = magnitude_est_cu8_sse2;
+    kernels.magnitude_true_cu8  = magnitude_true_cu8_sse2;
+    kernels.magnitude_est_cs16  = magnitude_est_cs16_sse2;
+    kernels.magnitude_true_cs16 = magnitude_true_cs16_sse2;
+    kernels.fm_discriminator_cu8  = fm_discriminator_cu8_sse2;
+    kernels.fm_discriminator_cs16 = fm_discriminator_cs16_sse2;
+#endif
+#ifdef BASEBAND_HAVE_AVX2
+    if (cpu_has_avx2()) {
+        kernels.impl                = BASEBAND_IMPL_AVX2;
+        kernels.envelope_detect     = envelope_detect_avx2;
+        kernels.magnitude_est_cu8   = magnitude_est_cu8_avx2;
+        kernels.magnitude_true_cu8  = magnitude_true_cu8_avx2;
+        kernels.magnitude_est_cs16  = magnitude_est_cs16_avx2;
+        kernels.magnitude_true_cs16 = magnitude_true_cs16_avx2;
+        kernels.fm_discriminator_cu8  = fm_discriminator_cu8_avx2;
+    }
+#endif
+#ifdef BASEBAND_HAVE_NEON
+    // no double precision NEON on all targets, the true magnitude and CS16 FM stay scalar
+    kernels.impl                = BASEBAND_IMPL_NEON;
+    kernels.envelope_detect     = envelope_detect_neon;
+    kernels.magnitude_est_cu8   = magnitude_est_cu8_neon;
+    kernels.magnitude_est_cs16  = magnitude_est_cs16_neon;
+    kernels.fm_discriminator_cu8  = fm_discriminator_cu8_neon;
+#endif
+    return kernels.impl;
+}
+
+char const *baseband_impl_name(baseband_impl_t impl)
+{
+    switch (impl) {
+    case BASEBAND_IMPL_SSE2:
+        return "SSE2";
+    case BASEBAND_IMPL_AVX2:
+        return "AVX2";
+    case BASEBAND_IMPL_NEON:
+        return "NEON";
+    case BASEBAND_IMPL_SCALAR:
+    default:
+        return "scalar";
+    }
+}
+
+void envelope_detect(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    kernels.envelope_detect(iq_buf, y_buf, len);
+}
+
+void magnitude_est_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    kernels.magnitude_est_cu8(iq_buf, y_buf, len);
+}
+
+void magnitude_true_cu8(uint8_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    kernels.magnitude_true_cu8(iq_buf, y_buf, len);
+}
+
+void magnitude_est_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    kernels.magnitude_est_cs16(iq_buf, y_buf, len);
+}
+
+void magnitude_true_cs16(int16_t const *iq_buf, uint16_t *y_buf, uint32_t len)
+{
+    kernels.magnitude_true_cs16(iq_buf, y_buf, len);
+}
+
+static void fm_discriminator_cu8(uint8_t const *x_buf, int16_t *phase, uint32_t len, int16_t br, int16_t bi)
+{
+    kernels.fm_discriminator_cu8(x_buf, phase, len, br, bi);
+}
+
+static void fm_discriminator_cs16(int16_t const *x_buf, int32_t *phase, uint32_t len, int32_t br, int32_t bi)
+{
+    kernels.fm_discriminator_cs16(x_buf, phase, len, br, bi);
 }
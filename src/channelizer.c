@@ -0,0 +1,198 @@
+/** @file
+    Channelizer: split one wideband IQ capture into narrowband channels.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "channelizer.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define NCO_TABLE_BITS 10
+#define NCO_TABLE_LEN (1 << NCO_TABLE_BITS)
+#define CHUNK_LEN 4096 ///< Input samples mixed per pass, keeps the delay lines small.
+
+/// Per channel state: NCO and the mixed samples delay line.
+typedef struct channel_state {
+    uint32_t phase;
+    uint32_t phase_inc;
+    int16_t *hist; ///< taps - 1 previous plus CHUNK_LEN current mixed I/Q samples.
+} channel_state_t;
+
+struct channelizer {
+    unsigned num_channels;
+    unsigned decimation;
+    unsigned taps;
+    unsigned skip;   ///< Input samples to skip before the next output sample.
+    int16_t *coeffs; ///< Low pass prototype, Q15.
+    int16_t nco[NCO_TABLE_LEN]; ///< sin() table, Q15.
+    channel_state_t *chans;
+};
+
+/// Windowed sinc low pass, cutoff fc in cycles per sample, normalized to unity DC gain.
+static void design_lowpass(int16_t *coeffs, unsigned taps, double fc)
+{
+    double *h = malloc(taps * sizeof(*h));
+    double sum = 0.0;
+    if (!h)
+        return;
+    for (unsigned n = 0; n < taps; n++) {
+        double m = n - (taps - 1) / 2.0;
+        double sinc = m == 0.0 ? 2.0 * fc : sin(2.0 * M_PI * fc * m) / (M_PI * m);
+        double window = taps > 1 ? 0.54 - 0.46 * cos(2.0 * M_PI * n / (taps - 1)) : 1.0; // Hamming
+        h[n] = sinc * window;
+        sum += h[n];
+    }
+    for (unsigned n = 0; n < taps; n++) {
+        coeffs[n] = (int16_t)lrint(h[n] / sum * 32767);
+    }
+    free(h);
+}
+
+channelizer_t *channelizer_create(uint32_t samp_rate, int32_t const *offsets_hz, unsigned num_channels, unsigned decimation)
+{
+    if (!samp_rate || !offsets_hz || !num_channels)
+        return NULL;
+
+    if (!decimation)
+        decimation = samp_rate / CHANNELIZER_MIN_RATE;
+    if (!decimation)
+        decimation = 1;
+
+    // each channel needs its full decimated bandwidth inside the capture
+    for (unsigned c = 0; c < num_channels; c++) {
+        if ((uint64_t)abs(offsets_hz[c]) + samp_rate / decimation / 2 > samp_rate / 2)
+            return NULL;
+    }
+
+    channelizer_t *ch = calloc(1, sizeof(*ch));
+    if (!ch)
+        return NULL;
+    ch->num_channels = num_channels;
+    ch->decimation   = decimation;
+    ch->taps         = decimation * CHANNELIZER_TAPS_PER_PHASE;
+    ch->coeffs       = malloc(ch->taps * sizeof(*ch->coeffs));
+    ch->chans        = calloc(num_channels, sizeof(*ch->chans));
+    if (!ch->coeffs || !ch->chans) {
+        channelizer_free(ch);
+        return NULL;
+    }
+    // pass band up to 80% of the channel Nyquist
+    design_lowpass(ch->coeffs, ch->taps, 0.4 / decimation);
+
+    for (unsigned i = 0; i < NCO_TABLE_LEN; i++) {
+        ch->nco[i] = (int16_t)lrint(sin(2.0 * M_PI * i / NCO_TABLE_LEN) * 32767);
+    }
+
+    for (unsigned c = 0; c < num_channels; c++) {
+        channel_state_t *cs = &ch->chans[c];
+        // rotate the channel down to DC
+        cs->phase_inc = (uint32_t)(int64_t)llrint(-(double)offsets_hz[c] / samp_rate * 4294967296.0);
+        cs->hist = calloc(2 * (ch->taps - 1 + CHUNK_LEN), sizeof(*cs->hist));
+        if (!cs->hist) {
+            channelizer_free(ch);
+            return NULL;
+        }
+    }
+
+    return ch;
+}
+
+void channelizer_free(channelizer_t *ch)
+{
+    if (!ch)
+        return;
+    if (ch->chans) {
+        for (unsigned c = 0; c < ch->num_channels; c++)
+            free(ch->chans[c].hist);
+        free(ch->chans);
+    }
+    free(ch->coeffs);
+    free(ch);
+}
+
+unsigned channelizer_decimation(channelizer_t const *ch)
+{
+    return ch->decimation;
+}
+
+static inline int16_t sat_int16(int32_t x)
+{
+    return x > INT16_MAX ? INT16_MAX : x < INT16_MIN ? INT16_MIN : (int16_t)x;
+}
+
+/// Mix one chunk to baseband. The mixed samples are stored at half scale to not overflow.
+static void mix_chunk(channelizer_t const *ch, channel_state_t *cs, void const *iq_buf, int sample_size, unsigned len)
+{
+    int16_t *m = &cs->hist[2 * (ch->taps - 1)];
+    uint32_t phase = cs->phase;
+    for (unsigned i = 0; i < len; i++) {
+        int32_t xr, xi;
+        if (sample_size == 1) { // CU8
+            xr = (((uint8_t const *)iq_buf)[2 * i] - 128) << 8;
+            xi = (((uint8_t const *)iq_buf)[2 * i + 1] - 128) << 8;
+        }
+        else { // CS16
+            xr = ((int16_t const *)iq_buf)[2 * i];
+            xi = ((int16_t const *)iq_buf)[2 * i + 1];
+        }
+        unsigned idx = phase >> (32 - NCO_TABLE_BITS);
+        int32_t s    = ch->nco[idx];
+        int32_t c    = ch->nco[(idx + NCO_TABLE_LEN / 4) & (NCO_TABLE_LEN - 1)];
+        m[2 * i]     = (xr * c - xi * s) >> 16;
+        m[2 * i + 1] = (xr * s + xi * c) >> 16;
+        phase += cs->phase_inc;
+    }
+    cs->phase = phase;
+}
+
+unsigned long channelizer_process(channelizer_t *ch, void const *iq_buf, int sample_size, unsigned long n_samples, int16_t **out)
+{
+    unsigned const taps = ch->taps;
+    unsigned long n_out = 0;
+
+    for (unsigned long t = 0; t < n_samples; t += CHUNK_LEN) {
+        unsigned len = n_samples - t < CHUNK_LEN ? n_samples - t : CHUNK_LEN;
+        unsigned long chunk_out = 0;
+        void const *chunk_buf = (uint8_t const *)iq_buf + 2 * t * sample_size;
+
+        for (unsigned c = 0; c < ch->num_channels; c++) {
+            channel_state_t *cs = &ch->chans[c];
+            int16_t *y = &out[c][2 * n_out];
+            mix_chunk(ch, cs, chunk_buf, sample_size, len);
+
+            // polyphase decimation: the FIR is only evaluated for every decimation-th input
+            chunk_out = 0;
+            for (unsigned pos = ch->skip; pos < len; pos += ch->decimation) {
+                int16_t const *m = &cs->hist[2 * pos]; // oldest of the taps samples ending at pos
+                int32_t acc_r = 0, acc_i = 0;
+                for (unsigned k = 0; k < taps; k++) {
+                    acc_r += ch->coeffs[taps - 1 - k] * m[2 * k];
+                    acc_i += ch->coeffs[taps - 1 - k] * m[2 * k + 1];
+                }
+                // Q15 coefficients on half scale samples
+                y[2 * chunk_out]     = sat_int16(acc_r >> 14);
+                y[2 * chunk_out + 1] = sat_int16(acc_i >> 14);
+                chunk_out++;
+            }
+
+            // keep the last taps - 1 mixed samples for the next chunk
+            memmove(cs->hist, &cs->hist[2 * len], 2 * (taps - 1) * sizeof(*cs->hist));
+        }
+
+        unsigned next = ch->skip + chunk_out * ch->decimation;
+        ch->skip      = next - len;
+        n_out += chunk_out;
+    }
+
+    return n_out;
+}
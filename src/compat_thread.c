@@ -0,0 +1,275 @@
+// compat_thread addresses following compatibility issue:
+// topic: threads, mutexes and condition variables
+// issue: pthreads are not available on Windows systems
+// solution: provide a minimal common interface for pthreads and Win32 threads
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np()
+#endif
+
+#include "compat_thread.h"
+
+#ifndef _WIN32
+// POSIX variant
+
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+int thread_start(thread_t *thread, thread_func_t fn, void *arg)
+{
+    return pthread_create(thread, NULL, fn, arg);
+}
+
+void thread_join(thread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+
+int thread_set_affinity(thread_t thread, unsigned cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) ? -1 : 0;
+#else
+    (void)thread;
+    (void)cpu;
+    return -1;
+#endif
+}
+
+unsigned thread_num_cpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+}
+
+void mutex_init(mutex_t *mutex)
+{
+    pthread_mutex_init(mutex, NULL);
+}
+
+void mutex_destroy(mutex_t *mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+
+void mutex_lock(mutex_t *mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+void mutex_unlock(mutex_t *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+unsigned compat_load_acquire(unsigned const volatile *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void compat_store_release(unsigned volatile *ptr, unsigned val)
+{
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+
+unsigned compat_fetch_add(unsigned volatile *ptr, unsigned val)
+{
+    return __atomic_fetch_add(ptr, val, __ATOMIC_ACQ_REL);
+}
+
+unsigned compat_fetch_sub(unsigned volatile *ptr, unsigned val)
+{
+    return __atomic_fetch_sub(ptr, val, __ATOMIC_ACQ_REL);
+}
+
+unsigned compat_exchange(unsigned volatile *ptr, unsigned val)
+{
+    return __atomic_exchange_n(ptr, val, __ATOMIC_ACQ_REL);
+}
+
+uint64_t compat_load_acquire64(uint64_t const volatile *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void compat_store_release64(uint64_t volatile *ptr, uint64_t val)
+{
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+
+uint64_t compat_fetch_add64(uint64_t volatile *ptr, uint64_t val)
+{
+    return __atomic_fetch_add(ptr, val, __ATOMIC_ACQ_REL);
+}
+
+void *compat_load_acquire_ptr(void *const volatile *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+int compat_cas_ptr(void *volatile *ptr, void *expected, void *desired)
+{
+    return __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+void cond_init(cond_t *cond)
+{
+    pthread_cond_init(cond, NULL);
+}
+
+void cond_destroy(cond_t *cond)
+{
+    pthread_cond_destroy(cond);
+}
+
+void cond_wait(cond_t *cond, mutex_t *mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+
+void cond_signal(cond_t *cond)
+{
+    pthread_cond_signal(cond);
+}
+
+void cond_broadcast(cond_t *cond)
+{
+    pthread_cond_broadcast(cond);
+}
+
+#else
+// Windows variant
+
+int thread_start(thread_t *thread, thread_func_t fn, void *arg)
+{
+    *thread = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    return *thread ? 0 : -1;
+}
+
+void thread_join(thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+int thread_set_affinity(thread_t thread, unsigned cpu)
+{
+    if (cpu >= sizeof(DWORD_PTR) * 8)
+        return -1;
+    return SetThreadAffinityMask(thread, (DWORD_PTR)1 << cpu) ? 0 : -1;
+}
+
+unsigned thread_num_cpus(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+void mutex_init(mutex_t *mutex)
+{
+    InitializeCriticalSection(mutex);
+}
+
+void mutex_destroy(mutex_t *mutex)
+{
+    DeleteCriticalSection(mutex);
+}
+
+void mutex_lock(mutex_t *mutex)
+{
+    EnterCriticalSection(mutex);
+}
+
+void mutex_unlock(mutex_t *mutex)
+{
+    LeaveCriticalSection(mutex);
+}
+
+unsigned compat_load_acquire(unsigned const volatile *ptr)
+{
+    unsigned val = *ptr;
+    MemoryBarrier();
+    return val;
+}
+
+void compat_store_release(unsigned volatile *ptr, unsigned val)
+{
+    MemoryBarrier();
+    *ptr = val;
+}
+
+unsigned compat_fetch_add(unsigned volatile *ptr, unsigned val)
+{
+    return (unsigned)InterlockedExchangeAdd((LONG volatile *)ptr, (LONG)val);
+}
+
+unsigned compat_fetch_sub(unsigned volatile *ptr, unsigned val)
+{
+    return (unsigned)InterlockedExchangeAdd((LONG volatile *)ptr, -(LONG)val);
+}
+
+unsigned compat_exchange(unsigned volatile *ptr, unsigned val)
+{
+    return (unsigned)InterlockedExchange((LONG volatile *)ptr, (LONG)val);
+}
+
+uint64_t compat_load_acquire64(uint64_t const volatile *ptr)
+{
+    // a plain 64-bit read may tear on 32-bit targets, a no-op exchange never does
+    return (uint64_t)InterlockedCompareExchange64((LONG64 volatile *)ptr, 0, 0);
+}
+
+void compat_store_release64(uint64_t volatile *ptr, uint64_t val)
+{
+    InterlockedExchange64((LONG64 volatile *)ptr, (LONG64)val);
+}
+
+uint64_t compat_fetch_add64(uint64_t volatile *ptr, uint64_t val)
+{
+    return (uint64_t)InterlockedExchangeAdd64((LONG64 volatile *)ptr, (LONG64)val);
+}
+
+void *compat_load_acquire_ptr(void *const volatile *ptr)
+{
+    void *val = *ptr;
+    MemoryBarrier();
+    return val;
+}
+
+int compat_cas_ptr(void *volatile *ptr, void *expected, void *desired)
+{
+    return InterlockedCompareExchangePointer(ptr, desired, expected) == expected;
+}
+
+void cond_init(cond_t *cond)
+{
+    InitializeConditionVariable(cond);
+}
+
+void cond_destroy(cond_t *cond)
+{
+    (void)cond; // nothing to free
+}
+
+void cond_wait(cond_t *cond, mutex_t *mutex)
+{
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+void cond_signal(cond_t *cond)
+{
+    WakeConditionVariable(cond);
+}
+
+void cond_broadcast(cond_t *cond)
+{
+    WakeAllConditionVariable(cond);
+}
+
+#endif
@@ -9,6 +9,8 @@ void r_init_cfg(r_cfg_t *cfg) {
     for (int a = 0; a < MAX_FREQS; a++) cfg->frequency[a] = 0;
     cfg->frequencies = 0;
     cfg->hop_times = 0;
+    cfg->channelize = 0;
+    cfg->channel_decimation = 0;
     cfg->ppm_error = 0;
     cfg->samp_rate = DEFAULT_SAMPLE_RATE;
     cfg->out_block_size = DEFAULT_BUF_LENGTH;
@@ -32,6 +34,7 @@ void r_init_cfg(r_cfg_t *cfg) {
     memset(cfg->output_path_csv, 0, sizeof(cfg->output_path_csv));
     memset(cfg->output_path_json, 0, sizeof(cfg->output_path_json));
     memset(cfg->output_path_kv, 0, sizeof(cfg->output_path_kv));
+    memset(cfg->output_path_cbor, 0, sizeof(cfg->output_path_cbor));
     strcpy(cfg->output_udp_host, "localhost");
     strcpy(cfg->output_udp_port, "514");
     strcpy(cfg->output_mqtt_host, "localhost");
@@ -50,6 +53,21 @@ void r_init_cfg(r_cfg_t *cfg) {
     cfg->conversion_mode = CONVERT_NATIVE;
     cfg->duration = 0;
     cfg->after_successful_events_flag = 0;
+    cfg->force_scalar = 0;
+    cfg->lazy_fm_demod = 0;
+    cfg->exhaustive_demod = 0;
+    cfg->decode_threads = 0;
+    cfg->decode_affinity = -1;
+    cfg->dsp_ring_buffers = 0;
+    cfg->output_queue_depth = 0;
+    cfg->output_queue_policy = QUEUE_BLOCK;
+    cfg->output_flush_records = 1;
+    cfg->output_flush_ms = 0;
+    cfg->output_fsync = 0;
+    cfg->output_udp_batch = 1;
+    cfg->output_udp_flush_ms = 0;
+    cfg->output_udp_mtu = 1024;
+    cfg->data_arena = 0;
 }
 
 r_cfg_t *r_create_cfg(void)
@@ -26,6 +26,8 @@
 #include <stdbool.h>
 
 #include "data.h"
+#include "compat_thread.h"
+#include "file_writer.h"
 
 typedef void* (*array_elementwise_import_fn)(void*);
 typedef void (*array_element_release_fn)(void*);
@@ -116,6 +118,214 @@ static bool import_values(void *dst, void *src, int num_values, data_type_t type
     return true; // error is returned early
 }
 
+/* arena */
+
+#define DATA_ARENA_CHUNK 2048 // bytes, most events fit in one chunk
+#define DATA_ARENA_POOL  32   // free chunks kept for reuse
+
+typedef struct data_arena {
+    struct data_arena *next;     ///< next chunk in the pool, or next overflow chunk
+    struct data_arena *overflow; ///< extra chunks of a large object, newest first
+    size_t size;                 ///< bytes after the header
+    size_t used;
+    unsigned elems;              ///< live elements, the arena is released with the last
+} data_arena_t;
+
+static int data_arena_mode;
+static int data_arena_lock_init;
+static mutex_t data_arena_lock; ///< guards the pool, objects may be released on other threads
+static data_arena_t *data_arena_pool;
+static unsigned data_arena_pool_len;
+
+void data_arena_enable(int enable)
+{
+    if (enable && !data_arena_lock_init) {
+        mutex_init(&data_arena_lock);
+        data_arena_lock_init = 1;
+    }
+    data_arena_mode = enable;
+
+    if (!enable && data_arena_lock_init) {
+        mutex_lock(&data_arena_lock);
+        while (data_arena_pool) {
+            data_arena_t *chunk = data_arena_pool;
+            data_arena_pool     = chunk->next;
+            free(chunk);
+        }
+        data_arena_pool_len = 0;
+        mutex_unlock(&data_arena_lock);
+    }
+}
+
+static data_arena_t *data_arena_get(void)
+{
+    data_arena_t *arena = NULL;
+
+    mutex_lock(&data_arena_lock);
+    if (data_arena_pool) {
+        arena           = data_arena_pool;
+        data_arena_pool = arena->next;
+        data_arena_pool_len--;
+    }
+    mutex_unlock(&data_arena_lock);
+
+    if (!arena) {
+        arena = malloc(sizeof(data_arena_t) + DATA_ARENA_CHUNK);
+        if (!arena)
+            return NULL;
+        arena->size = DATA_ARENA_CHUNK;
+    }
+    arena->next     = NULL;
+    arena->overflow = NULL;
+    arena->used     = 0;
+    arena->elems    = 0;
+    return arena;
+}
+
+static void data_arena_release(data_arena_t *arena)
+{
+    while (arena->overflow) {
+        data_arena_t *chunk = arena->overflow;
+        arena->overflow     = chunk->next;
+        free(chunk);
+    }
+
+    mutex_lock(&data_arena_lock);
+    if (data_arena_mode && data_arena_pool_len < DATA_ARENA_POOL) {
+        arena->next     = data_arena_pool;
+        data_arena_pool = arena;
+        data_arena_pool_len++;
+        arena = NULL;
+    }
+    mutex_unlock(&data_arena_lock);
+    free(arena);
+}
+
+static void *data_arena_alloc(data_arena_t *arena, size_t size)
+{
+    size = (size + 7) & ~(size_t)7; // keep doubles and pointers aligned
+
+    data_arena_t *chunk = arena->overflow ? arena->overflow : arena;
+    if (chunk->size - chunk->used < size) {
+        size_t chunk_size = size > DATA_ARENA_CHUNK ? size : DATA_ARENA_CHUNK;
+        chunk = malloc(sizeof(data_arena_t) + chunk_size);
+        if (!chunk)
+            return NULL;
+        chunk->size     = chunk_size;
+        chunk->used     = 0;
+        chunk->next     = arena->overflow;
+        arena->overflow = chunk;
+    }
+
+    void *ptr = (char *)(chunk + 1) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+/// malloc() or arena allocation.
+static void *data_alloc(data_arena_t *arena, size_t size)
+{
+    return arena ? data_arena_alloc(arena, size) : malloc(size);
+}
+
+/// strdup() or arena allocation.
+static char *data_strdup(data_arena_t *arena, char const *str)
+{
+    if (!arena)
+        return strdup(str);
+    size_t len = strlen(str) + 1;
+    char *copy = data_arena_alloc(arena, len);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+/// Release a value of an element, arena elements only own nested objects and arrays.
+static void data_release_value(data_t *data)
+{
+    if (data->arena && data->type != DATA_DATA && data->type != DATA_ARRAY)
+        return;
+    if (dmt[data->type].value_release)
+        dmt[data->type].value_release(data->value);
+}
+
+/* key table */
+
+#define DATA_KEY_SLOTS 4096 // power of two
+#define DATA_KEY_MAX   (DATA_KEY_SLOTS * 3 / 4) // then keys are copied per element
+
+// open addressing, entries are only ever added, lookups need no lock
+static void *volatile data_key_slots[DATA_KEY_SLOTS];
+static unsigned volatile data_key_count;
+
+static unsigned data_key_hash(char const *key)
+{
+    unsigned hash = 2166136261u; // FNV-1a
+    while (*key)
+        hash = (hash ^ (unsigned char)*key++) * 16777619u;
+    return hash;
+}
+
+char const *data_key_intern(char const *key)
+{
+    unsigned idx = data_key_hash(key) & (DATA_KEY_SLOTS - 1);
+    char *copy   = NULL;
+
+    for (;;) {
+        char const *slot = compat_load_acquire_ptr(&data_key_slots[idx]);
+        if (!slot) {
+            // not in the table, claim the free slot
+            if (!copy) {
+                if (compat_fetch_add(&data_key_count, 1) >= DATA_KEY_MAX) {
+                    compat_fetch_sub(&data_key_count, 1);
+                    return NULL;
+                }
+                copy = strdup(key);
+                if (!copy) {
+                    compat_fetch_sub(&data_key_count, 1);
+                    return NULL;
+                }
+            }
+            if (compat_cas_ptr(&data_key_slots[idx], NULL, copy))
+                return copy;
+            slot = compat_load_acquire_ptr(&data_key_slots[idx]); // another thread was faster
+        }
+        if (!strcmp(slot, key)) {
+            if (copy) {
+                free(copy);
+                compat_fetch_sub(&data_key_count, 1);
+            }
+            return slot;
+        }
+        idx = (idx + 1) & (DATA_KEY_SLOTS - 1);
+    }
+}
+
+char const *data_key_find(char const *key)
+{
+    unsigned idx = data_key_hash(key) & (DATA_KEY_SLOTS - 1);
+
+    for (;;) {
+        char const *slot = compat_load_acquire_ptr(&data_key_slots[idx]);
+        if (!slot)
+            return NULL;
+        if (!strcmp(slot, key))
+            return slot;
+        idx = (idx + 1) & (DATA_KEY_SLOTS - 1);
+    }
+}
+
+/// Interned key, or a copy if the table is full.
+static char *data_key_dup(data_t *data, char const *key, unsigned interned_flag)
+{
+    char const *interned = data_key_intern(key);
+    if (interned) {
+        data->interned |= interned_flag;
+        return (char *)interned;
+    }
+    return data_strdup(data->arena, key);
+}
+
 /* data */
 
 data_array_t *data_array(int num_values, data_type_t type, void *values)
@@ -141,26 +351,39 @@ alloc_error:
     return NULL;
 }
 
-static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key, va_list ap)
+static data_t *vdata_make(data_t *first, data_arena_t *arena, const char *key, const char *pretty_key, va_list ap)
 {
     data_type_t type;
     data_t *prev = first;
     while (prev && prev->next)
         prev = prev->next;
+    // append to the arena of the object, if any
+    if (prev)
+        arena = prev->arena;
+    data_arena_t *new_arena = NULL;
+    if (!arena && !prev && data_arena_mode) {
+        arena = new_arena = data_arena_get();
+    }
     char *format = false;
+    unsigned format_interned = 0;
     type = va_arg(ap, data_type_t);
     do {
         data_t *current;
         void *value = NULL;
 
         switch (type) {
-        case DATA_FORMAT:
-            format = strdup(va_arg(ap, char *));
+        case DATA_FORMAT: {
+            // formats are as few as keys, share them the same way
+            char const *arg = va_arg(ap, char *);
+            format          = (char *)data_key_intern(arg);
+            format_interned = format ? DATA_INTERNED_FORMAT : 0;
+            if (!format)
+                format = data_strdup(arena, arg);
             if (!format)
                 goto alloc_error;
             type = va_arg(ap, data_type_t);
             continue;
-            break;
+        }
         case DATA_COUNT:
             assert(0);
             break;
@@ -168,17 +391,17 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
             value = va_arg(ap, data_t *);
             break;
         case DATA_INT:
-            value = malloc(sizeof(int));
+            value = data_alloc(arena, sizeof(int));
             if (value)
                 *(int *)value = va_arg(ap, int);
             break;
         case DATA_DOUBLE:
-            value = malloc(sizeof(double));
+            value = data_alloc(arena, sizeof(double));
             if (value)
                 *(double *)value = va_arg(ap, double);
             break;
         case DATA_STRING:
-            value = strdup(va_arg(ap, char *));
+            value = data_strdup(arena, va_arg(ap, char *));
             break;
         case DATA_ARRAY:
             value = va_arg(ap, data_t *);
@@ -191,32 +414,42 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
         if (!value)
             goto alloc_error;
 
-        current = calloc(1, sizeof(*current));
+        current = data_alloc(arena, sizeof(*current));
         if (!current)
             goto alloc_error;
+        memset(current, 0, sizeof(*current));
+        current->type     = type;
+        current->format   = format;
+        current->value    = value;
+        current->arena    = arena;
+        current->interned = format_interned;
+        if (arena)
+            arena->elems++;
         if (prev)
             prev->next = current;
+        if (!first)
+            first = current;
 
-        current->key = strdup(key);
+        current->key = data_key_dup(current, key, DATA_INTERNED_KEY);
         if (!current->key)
             goto alloc_error;
-        current->pretty_key = strdup(pretty_key ? pretty_key : key);
+        if (!pretty_key && (current->interned & DATA_INTERNED_KEY)) {
+            current->pretty_key = current->key; // shared, no need to look it up again
+            current->interned |= DATA_INTERNED_PRETTY_KEY;
+        }
+        else
+            current->pretty_key = data_key_dup(current, pretty_key ? pretty_key : key, DATA_INTERNED_PRETTY_KEY);
         if (!current->pretty_key)
             goto alloc_error;
-        current->type = type;
-        current->format = format;
-        current->value = value;
-        current->next = NULL;
 
         prev = current;
-        if (!first)
-            first = current;
 
         key = va_arg(ap, const char *);
         if (key) {
             pretty_key = va_arg(ap, const char *);
             type = va_arg(ap, data_type_t);
             format = NULL;
+            format_interned = 0;
         }
     } while (key);
     va_end(ap);
@@ -224,6 +457,8 @@ static data_t *vdata_make(data_t *first, const char *key, const char *pretty_key
     return first;
 
 alloc_error:
+    if (new_arena && !first)
+        data_arena_release(new_arena); // no element yet, else it goes with the last element
     data_free(first);
     return NULL;
 }
@@ -232,7 +467,7 @@ data_t *data_make(const char *key, const char *pretty_key, ...)
 {
     va_list ap;
     va_start(ap, pretty_key);
-    data_t *result = vdata_make(NULL, key, pretty_key, ap);
+    data_t *result = vdata_make(NULL, NULL, key, pretty_key, ap);
     va_end(ap);
     return result;
 }
@@ -241,7 +476,7 @@ data_t *data_append(data_t *first, const char *key, const char *pretty_key, ...)
 {
     va_list ap;
     va_start(ap, pretty_key);
-    data_t *result = vdata_make(first, key, pretty_key, ap);
+    data_t *result = vdata_make(first, NULL, key, pretty_key, ap);
     va_end(ap);
     return result;
 }
@@ -250,7 +485,8 @@ data_t *data_prepend(data_t *first, const char *key, const char *pretty_key, ...
 {
     va_list ap;
     va_start(ap, pretty_key);
-    data_t *result = vdata_make(NULL, key, pretty_key, ap);
+    // prepend into the arena of the object, if any
+    data_t *result = vdata_make(NULL, first ? first->arena : NULL, key, pretty_key, ap);
     va_end(ap);
 
     if (!result)
@@ -278,29 +514,114 @@ void data_array_free(data_array_t *array)
 
 data_t *data_retain(data_t *data)
 {
+    // atomic, outputs on their own threads may release the same object
     if (data)
-        ++data->retain;
+        compat_fetch_add(&data->retain, 1);
     return data;
 }
 
 void data_free(data_t *data)
 {
-    if (data && data->retain) {
-        --data->retain;
+    // the last owner sees a retain count of zero
+    if (data && compat_fetch_sub(&data->retain, 1) != 0)
         return;
-    }
     while (data) {
-        data_t *prev_data = data;
-        if (dmt[data->type].value_release)
-            dmt[data->type].value_release(data->value);
-        free(data->format);
-        free(data->pretty_key);
-        free(data->key);
+        data_t *prev_data   = data;
+        data_arena_t *arena = data->arena;
+        data_release_value(data);
+        free(data->json); // never in the arena, outputs add it late
+        if (!arena) {
+            if (!(data->interned & DATA_INTERNED_FORMAT))
+                free(data->format);
+            if (!(data->interned & DATA_INTERNED_PRETTY_KEY))
+                free(data->pretty_key);
+            if (!(data->interned & DATA_INTERNED_KEY))
+                free(data->key);
+        }
         data = data->next;
-        free(prev_data);
+        if (!arena)
+            free(prev_data);
+        else if (--arena->elems == 0)
+            data_arena_release(arena);
     }
 }
 
+void data_replace_key(data_t *data, char *key)
+{
+    if (!key)
+        return; // keep the old key on allocation failure
+
+    char const *interned = data_key_intern(key);
+    char *copy           = interned ? (char *)interned : data->arena ? data_strdup(data->arena, key) : key;
+    if (!copy) {
+        free(key);
+        return;
+    }
+    if (!data->arena && !(data->interned & DATA_INTERNED_KEY))
+        free(data->key);
+    data->key = copy;
+    if (interned)
+        data->interned |= DATA_INTERNED_KEY;
+    else
+        data->interned &= ~DATA_INTERNED_KEY;
+    if (copy != key)
+        free(key);
+}
+
+void data_replace_format(data_t *data, char *format)
+{
+    if (data->arena) {
+        data->format = format ? data_strdup(data->arena, format) : NULL;
+        free(format);
+    }
+    else {
+        if (!(data->interned & DATA_INTERNED_FORMAT))
+            free(data->format);
+        data->format = format;
+    }
+    data->interned &= ~DATA_INTERNED_FORMAT;
+}
+
+void data_replace_interned_key(data_t *data, char const *key)
+{
+    if (!data->arena && !(data->interned & DATA_INTERNED_KEY))
+        free(data->key);
+    data->key = (char *)key;
+    data->interned |= DATA_INTERNED_KEY;
+}
+
+void data_replace_interned_format(data_t *data, char const *format)
+{
+    if (!data->arena && !(data->interned & DATA_INTERNED_FORMAT))
+        free(data->format);
+    data->format = (char *)format;
+    data->interned |= DATA_INTERNED_FORMAT;
+}
+
+int data_replace_int(data_t *data, int value)
+{
+    int *copy = data_alloc(data->arena, sizeof(int));
+    if (!copy)
+        return -1;
+    *copy = value;
+    data_release_value(data);
+    data->type  = DATA_INT;
+    data->value = copy;
+    return 0;
+}
+
+data_t *data_replace_head(data_t *data, size_t size)
+{
+    data_t *head = data_alloc(data->arena, size);
+    if (!head)
+        return NULL;
+    memset(head, 0, size);
+    *head = *data;
+    if (!data->arena)
+        free(data); // the rest of the list moves on to the new head
+    return head;
+}
+
 /* data output */
 
 void data_output_print(data_output_t *output, data_t *data)
@@ -309,8 +630,12 @@ void data_output_print(data_output_t *output, data_t *data)
         return;
     output->print_data(output, data, NULL);
     if (output->file) {
-        fputc('\n', output->file);
-        fflush(output->file);
+        if (!output->binary)
+            fputc('\n', output->file);
+        if (output->writer)
+            file_writer_record(output->writer);
+        else
+            fflush(output->file);
     }
 }
 
@@ -323,16 +648,37 @@ void data_output_start(data_output_t *output, const char **fields, int num_field
 
 void data_output_poll(data_output_t *output)
 {
-    if (!output || !output->output_poll)
+    if (!output)
+        return;
+    if (output->writer)
+        file_writer_poll(output->writer);
+    if (output->output_poll)
+        output->output_poll(output);
+}
+
+data_t *data_output_stats(data_output_t *output, data_t *stats)
+{
+    if (!output || !output->output_stats)
+        return stats;
+    return output->output_stats(output, stats);
+}
+
+void data_output_stats_reset(data_output_t *output)
+{
+    if (!output || !output->output_stats_reset)
         return;
-    output->output_poll(output);
+    output->output_stats_reset(output);
 }
 
 void data_output_free(data_output_t *output)
 {
     if (!output)
         return;
+    struct file_writer *writer = output->writer;
+    if (writer)
+        file_writer_flush(writer);
     output->output_free(output);
+    file_writer_free(writer); // the file is closed now, release its buffer
 }
 
 /* output helpers */
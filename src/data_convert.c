@@ -0,0 +1,273 @@
+/** @file
+    Unit conversion plan, rewrites decoder output for -C si|customary and -M newmodel.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data_convert.h"
+#include "librtl_433.h"
+#include "r_util.h"
+
+typedef struct convert_rule {
+    char const *suffix;     ///< applies to double values with keys ending in this
+    char const *key_pre;    ///< replaced by key_pre_to first, if set
+    char const *key_pre_to;
+    char const *key_rep;    ///< replaced by key_with in the key
+    char const *key_with;
+    char const *fmt_rep;    ///< replaced by fmt_with in the format
+    char const *fmt_with;
+    int fmt_last;           ///< only replace the last fmt_rep char, e.g. the F of "%.1f F"
+    float (*convert)(float);
+} convert_rule_t;
+
+// checked in order, the first matching suffix wins
+static convert_rule_t const si_rules[] = {
+        {"_F", NULL, NULL, "_F", "_C", "F", "C", 1, fahrenheit2celsius},
+        {"_mph", NULL, NULL, "_mph", "_kph", "mi/h", "km/h", 0, mph2kmph},
+        {"_mi_h", NULL, NULL, "_mi_h", "_km_h", "mi/h", "km/h", 0, mph2kmph},
+        {"_in", "_inch", "_in", "_in", "_mm", "in", "mm", 0, inch2mm},
+        {"_inch", "_inch", "_in", "_in", "_mm", "in", "mm", 0, inch2mm},
+        {"_in_h", NULL, NULL, "_in_h", "_mm_h", "in/h", "mm/h", 0, inch2mm},
+        {"_inHg", NULL, NULL, "_inHg", "_hPa", "inHg", "hPa", 0, inhg2hpa},
+        {"_PSI", NULL, NULL, "_PSI", "_kPa", "PSI", "kPa", 0, psi2kpa},
+        {NULL},
+};
+
+static convert_rule_t const customary_rules[] = {
+        {"_C", NULL, NULL, "_C", "_F", "C", "F", 1, celsius2fahrenheit},
+        {"_kph", NULL, NULL, "_kph", "_mph", "km/h", "mi/h", 0, kmph2mph},
+        {"_km_h", NULL, NULL, "_km_h", "_mi_h", "km/h", "mi/h", 0, kmph2mph},
+        {"_mm", NULL, NULL, "_mm", "_in", "mm", "in", 0, mm2inch},
+        {"_mm_h", NULL, NULL, "_mm_h", "_in_h", "mm/h", "in/h", 0, mm2inch},
+        {"_hPa", NULL, NULL, "_hPa", "_inHg", "hPa", "inHg", 0, hpa2inhg},
+        {"_kPa", NULL, NULL, "_kPa", "_PSI", "kPa", "PSI", 0, kpa2psi},
+        {NULL},
+};
+
+typedef struct convert_entry {
+    char const *key;            ///< interned source key, NULL if the slot is free
+    convert_rule_t const *rule; ///< NULL if the key is kept
+    char const *to_key;         ///< interned target key
+    char const *from_format;    ///< last format seen with this key, interned
+    char const *to_format;      ///< its rewrite, interned
+} convert_entry_t;
+
+struct data_convert {
+    convert_rule_t const *rules; ///< NULL if units are kept
+    char const *battery_key;     ///< NULL unless new_model_keys
+    char const *battery_ok_key;
+    unsigned size;               ///< power of two
+    unsigned count;
+    convert_entry_t *entries;    ///< open addressing on the key pointer
+};
+
+static unsigned convert_hash(char const *key, unsigned size)
+{
+    // interned keys are unique, hash the pointer
+    return (unsigned)(((uintptr_t)key >> 3) * 2654435761u) & (size - 1);
+}
+
+static convert_rule_t const *convert_find_rule(convert_rule_t const *rules, char const *key)
+{
+    for (; rules->suffix; ++rules)
+        if (str_endswith(key, rules->suffix))
+            return rules;
+    return NULL;
+}
+
+/// The converted key, malloc'd.
+static char *convert_key(convert_rule_t const *rule, char const *key)
+{
+    char *pre = NULL;
+    if (rule->key_pre) {
+        pre = str_replace((char *)key, (char *)rule->key_pre, (char *)rule->key_pre_to);
+        if (!pre)
+            return NULL;
+        key = pre;
+    }
+    char *result = str_replace((char *)key, (char *)rule->key_rep, (char *)rule->key_with);
+    free(pre);
+    return result;
+}
+
+/// The converted format, malloc'd, NULL if @p format is NULL.
+static char *convert_format(convert_rule_t const *rule, char const *format)
+{
+    if (!format)
+        return NULL;
+    if (!rule->fmt_last)
+        return str_replace((char *)format, (char *)rule->fmt_rep, (char *)rule->fmt_with);
+
+    char *result = strdup(format);
+    char *pos;
+    if (result && (pos = strrchr(result, rule->fmt_rep[0])))
+        *pos = rule->fmt_with[0];
+    return result;
+}
+
+static int convert_grow(data_convert_t *conv)
+{
+    unsigned size            = conv->size * 2;
+    convert_entry_t *entries = calloc(size, sizeof(*entries));
+    if (!entries)
+        return -1;
+
+    for (unsigned i = 0; i < conv->size; ++i) {
+        convert_entry_t *entry = &conv->entries[i];
+        if (!entry->key)
+            continue;
+        unsigned idx = convert_hash(entry->key, size);
+        while (entries[idx].key)
+            idx = (idx + 1) & (size - 1);
+        entries[idx] = *entry;
+    }
+    free(conv->entries);
+    conv->entries = entries;
+    conv->size    = size;
+    return 0;
+}
+
+/// Look up an interned key, resolve it on first use. Returns NULL on allocation failure.
+static convert_entry_t *convert_resolve(data_convert_t *conv, char const *key)
+{
+    unsigned idx = convert_hash(key, conv->size);
+    while (conv->entries[idx].key) {
+        if (conv->entries[idx].key == key)
+            return &conv->entries[idx];
+        idx = (idx + 1) & (conv->size - 1);
+    }
+
+    convert_rule_t const *rule = convert_find_rule(conv->rules, key);
+    char const *to_key         = NULL;
+    if (rule) {
+        char *copy = convert_key(rule, key);
+        to_key     = copy ? data_key_intern(copy) : NULL;
+        free(copy);
+        if (!to_key)
+            return NULL;
+    }
+
+    if ((conv->count + 1) * 2 > conv->size) {
+        if (convert_grow(conv))
+            return NULL;
+        idx = convert_hash(key, conv->size);
+        while (conv->entries[idx].key)
+            idx = (idx + 1) & (conv->size - 1);
+    }
+    convert_entry_t *entry = &conv->entries[idx];
+    entry->key             = key;
+    entry->rule            = rule;
+    entry->to_key          = to_key;
+    conv->count++;
+    return entry;
+}
+
+data_convert_t *data_convert_create(int conversion_mode, int new_model_keys)
+{
+    data_convert_t *conv = calloc(1, sizeof(*conv));
+    if (!conv)
+        return NULL;
+
+    conv->rules = conversion_mode == CONVERT_SI ? si_rules
+            : conversion_mode == CONVERT_CUSTOMARY ? customary_rules
+            : NULL;
+    if (new_model_keys) {
+        conv->battery_key    = data_key_intern("battery");
+        conv->battery_ok_key = data_key_intern("battery_ok");
+        if (!conv->battery_key || !conv->battery_ok_key) {
+            free(conv);
+            return NULL;
+        }
+    }
+
+    conv->size    = 64;
+    conv->entries = calloc(conv->size, sizeof(*conv->entries));
+    if (!conv->entries) {
+        free(conv);
+        return NULL;
+    }
+    return conv;
+}
+
+void data_convert_free(data_convert_t *conv)
+{
+    if (!conv)
+        return;
+    free(conv->entries);
+    free(conv);
+}
+
+int data_convert_add_fields(data_convert_t *conv, char const *const *fields)
+{
+    if (!conv->rules)
+        return 0; // only the battery key is converted
+    for (; fields && *fields; ++fields) {
+        char const *key = data_key_intern(*fields);
+        if (!key || !convert_resolve(conv, key))
+            return -1;
+    }
+    return 0;
+}
+
+/// Interned rewrite of an interned format, cached per key. Returns 0 if the format can't be interned.
+static int convert_cache_format(convert_entry_t *entry, char const *format)
+{
+    if (entry->from_format == format)
+        return 1;
+    char *copy            = convert_format(entry->rule, format);
+    char const *to_format = copy ? data_key_intern(copy) : NULL;
+    free(copy);
+    if (!to_format)
+        return 0;
+    entry->from_format = format;
+    entry->to_format   = to_format;
+    return 1;
+}
+
+void data_convert_apply(data_convert_t *conv, data_t *data)
+{
+    int battery_done = !conv->battery_key;
+
+    for (data_t *d = data; d; d = d->next) {
+        // replace textual battery key with numerical battery key
+        if (!battery_done && d->type == DATA_STRING && data_key_is(d, conv->battery_key)) {
+            int ok = d->value && !strcmp(d->value, "OK");
+            data_replace_interned_key(d, conv->battery_ok_key);
+            data_replace_int(d, ok);
+            battery_done = 1;
+            continue;
+        }
+
+        if (!conv->rules || d->type != DATA_DOUBLE)
+            continue;
+
+        if (!(d->interned & DATA_INTERNED_KEY)) {
+            // the key table is full, convert the old way
+            convert_rule_t const *rule = convert_find_rule(conv->rules, d->key);
+            if (rule) {
+                *(double *)d->value = rule->convert(*(double *)d->value);
+                data_replace_key(d, convert_key(rule, d->key));
+                data_replace_format(d, convert_format(rule, d->format));
+            }
+            continue;
+        }
+
+        convert_entry_t *entry = convert_resolve(conv, d->key);
+        if (!entry || !entry->rule)
+            continue;
+
+        *(double *)d->value = entry->rule->convert(*(double *)d->value);
+        data_replace_interned_key(d, entry->to_key);
+        if (d->format && (d->interned & DATA_INTERNED_FORMAT) && convert_cache_format(entry, d->format))
+            data_replace_interned_format(d, entry->to_format);
+        else if (d->format)
+            data_replace_format(d, convert_format(entry->rule, d->format));
+    }
+}
@@ -0,0 +1,519 @@
+/** @file
+    CBOR output of structured data, with a reader for the records.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "redir_print.h"
+#include "data_printer_cbor.h"
+
+// CBOR major types
+#define CBOR_UINT   0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES  2
+#define CBOR_TEXT   3
+#define CBOR_ARRAY  4
+#define CBOR_MAP    5
+#define CBOR_TAG    6
+#define CBOR_SIMPLE 7
+
+#define CBOR_FALSE  20
+#define CBOR_TRUE   21
+#define CBOR_HALF   25
+#define CBOR_FLOAT  26
+#define CBOR_DOUBLE 27
+
+#define CBOR_MAX_DEPTH 32 // nesting the reader accepts
+
+/* CBOR printer */
+
+typedef struct {
+    data_output_t output;
+    uint8_t *buf;  ///< the record being built, reused for every record
+    size_t len;
+    size_t size;
+    int depth;     ///< nesting of print_data, 0 between records
+    int error;     ///< the record did not fit into memory
+} data_output_cbor_t;
+
+static void cbor_put(data_output_cbor_t *cbor, void const *src, size_t n)
+{
+    if (cbor->len + n > cbor->size) {
+        size_t size = cbor->size ? cbor->size * 2 : 256;
+        while (size < cbor->len + n)
+            size *= 2;
+        uint8_t *buf = realloc(cbor->buf, size);
+        if (!buf) {
+            cbor->error = 1;
+            return;
+        }
+        cbor->buf  = buf;
+        cbor->size = size;
+    }
+    memcpy(cbor->buf + cbor->len, src, n);
+    cbor->len += n;
+}
+
+/// Write @p n bytes of @p value big endian.
+static void cbor_put_be(data_output_cbor_t *cbor, uint64_t value, int n)
+{
+    uint8_t bytes[8];
+    for (int i = n - 1; i >= 0; --i) {
+        bytes[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    cbor_put(cbor, bytes, n);
+}
+
+/// Write the initial byte of an item with the shortest argument encoding.
+static void cbor_head(data_output_cbor_t *cbor, unsigned major, uint64_t value)
+{
+    uint8_t initial = (uint8_t)(major << 5);
+    if (value < 24) {
+        initial |= (uint8_t)value;
+        cbor_put(cbor, &initial, 1);
+        return;
+    }
+    int n = value <= 0xff ? 1 : value <= 0xffff ? 2 : value <= 0xffffffff ? 4 : 8;
+    initial |= n == 1 ? 24 : n == 2 ? 25 : n == 4 ? 26 : 27;
+    cbor_put(cbor, &initial, 1);
+    cbor_put_be(cbor, value, n);
+}
+
+static void print_cbor_string(data_output_t *output, const char *str, char *format)
+{
+    data_output_cbor_t *cbor = (data_output_cbor_t *)output;
+
+    size_t len = strlen(str);
+    cbor_head(cbor, CBOR_TEXT, len);
+    cbor_put(cbor, str, len);
+}
+
+static void print_cbor_int(data_output_t *output, int data, char *format)
+{
+    data_output_cbor_t *cbor = (data_output_cbor_t *)output;
+
+    if (data >= 0)
+        cbor_head(cbor, CBOR_UINT, (uint64_t)data);
+    else
+        cbor_head(cbor, CBOR_NEGINT, (uint64_t)(-1 - (int64_t)data));
+}
+
+static void print_cbor_double(data_output_t *output, double data, char *format)
+{
+    data_output_cbor_t *cbor = (data_output_cbor_t *)output;
+
+    // most values come from floats or few decimals, single precision often is exact
+    float single = (float)data;
+    uint8_t initial;
+    if ((double)single == data) {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        initial = CBOR_SIMPLE << 5 | CBOR_FLOAT;
+        cbor_put(cbor, &initial, 1);
+        cbor_put_be(cbor, bits, 4);
+    }
+    else {
+        uint64_t bits;
+        memcpy(&bits, &data, sizeof(bits));
+        initial = CBOR_SIMPLE << 5 | CBOR_DOUBLE;
+        cbor_put(cbor, &initial, 1);
+        cbor_put_be(cbor, bits, 8);
+    }
+}
+
+static void print_cbor_array(data_output_t *output, data_array_t *array, char *format)
+{
+    data_output_cbor_t *cbor = (data_output_cbor_t *)output;
+
+    cbor_head(cbor, CBOR_ARRAY, (uint64_t)array->num_values);
+    for (int c = 0; c < array->num_values; ++c)
+        print_array_value(output, array, format, c);
+}
+
+static void print_cbor_data(data_output_t *output, data_t *data, char *format)
+{
+    data_output_cbor_t *cbor = (data_output_cbor_t *)output;
+
+    if (!cbor->depth) {
+        cbor->len   = 0;
+        cbor->error = 0;
+        cbor_put_be(cbor, 0, 4); // length, filled in below
+    }
+    ++cbor->depth;
+
+    uint64_t count = 0;
+    for (data_t *d = data; d; d = d->next)
+        ++count;
+    cbor_head(cbor, CBOR_MAP, count);
+    for (; data; data = data->next) {
+        print_cbor_string(output, data->key, NULL);
+        print_value(output, data->type, data->value, data->format);
+    }
+
+    if (--cbor->depth)
+        return;
+    if (cbor->error || cbor->len - 4 > 0xffffffff) {
+        rtl433_fprintf(stderr, "CBOR output: record dropped, out of memory.\n");
+        return;
+    }
+    uint64_t len = cbor->len - 4;
+    for (int i = 3; i >= 0; --i) {
+        cbor->buf[i] = (uint8_t)len;
+        len >>= 8;
+    }
+    fwrite(cbor->buf, 1, cbor->len, output->file);
+}
+
+static void data_output_cbor_free(data_output_t *output)
+{
+    data_output_cbor_t *cbor = (data_output_cbor_t *)output;
+
+    if (!output)
+        return;
+
+    if (output->file != stdout)
+        fclose(output->file);
+
+    free(cbor->buf);
+    free(cbor);
+}
+
+data_output_t *data_output_cbor_create(FILE *file)
+{
+    data_output_cbor_t *cbor = calloc(1, sizeof(data_output_cbor_t));
+    if (!cbor) {
+        rtl433_fprintf(stderr, "calloc() failed");
+        return NULL;
+    }
+
+    cbor->output.print_data   = print_cbor_data;
+    cbor->output.print_array  = print_cbor_array;
+    cbor->output.print_string = print_cbor_string;
+    cbor->output.print_double = print_cbor_double;
+    cbor->output.print_int    = print_cbor_int;
+    cbor->output.output_free  = data_output_cbor_free;
+    cbor->output.file         = file;
+    cbor->output.binary       = 1;
+    cbor->output.ext_callback = NULL; // prevents this printer to receive unknown signals
+
+    return &cbor->output;
+}
+
+/* CBOR reader */
+
+typedef struct {
+    uint8_t const *pos;
+    uint8_t const *end;
+    int depth;
+} cbor_reader_t;
+
+typedef struct {
+    data_type_t type;
+    union {
+        int i;
+        double d;
+        char *s;
+        data_t *data;
+        data_array_t *array;
+    } u;
+} cbor_value_t;
+
+static int cbor_read_be(cbor_reader_t *rd, int n, uint64_t *value)
+{
+    if (rd->end - rd->pos < n)
+        return -1;
+    *value = 0;
+    for (int i = 0; i < n; ++i)
+        *value = *value << 8 | *rd->pos++;
+    return 0;
+}
+
+/// Read the initial byte and the argument of an item.
+static int cbor_read_head(cbor_reader_t *rd, unsigned *major, unsigned *info, uint64_t *value)
+{
+    if (rd->pos >= rd->end)
+        return -1;
+    *major = *rd->pos >> 5;
+    *info  = *rd->pos & 0x1f;
+    rd->pos++;
+    if (*info < 24) {
+        *value = *info;
+        return 0;
+    }
+    if (*info > 27)
+        return -1; // indefinite lengths are not used
+    return cbor_read_be(rd, 1 << (*info - 24), value);
+}
+
+static double cbor_half_to_double(unsigned half)
+{
+    int exp       = (half >> 10) & 0x1f;
+    int mant      = half & 0x3ff;
+    double result = exp == 0 ? ldexp(mant, -24)
+            : exp == 31 ? (mant ? NAN : INFINITY)
+            : ldexp(mant + 1024, exp - 25);
+    return half & 0x8000 ? -result : result;
+}
+
+static void cbor_value_free(cbor_value_t *value)
+{
+    switch (value->type) {
+    case DATA_STRING:
+        free(value->u.s);
+        break;
+    case DATA_DATA:
+        data_free(value->u.data);
+        break;
+    case DATA_ARRAY:
+        data_array_free(value->u.array);
+        break;
+    default:
+        break;
+    }
+}
+
+static int cbor_read_value(cbor_reader_t *rd, cbor_value_t *value);
+
+static data_t *cbor_read_map(cbor_reader_t *rd, uint64_t count)
+{
+    data_t *data = NULL;
+    for (uint64_t i = 0; i < count; ++i) {
+        cbor_value_t key, value;
+        if (cbor_read_value(rd, &key))
+            goto error;
+        if (key.type != DATA_STRING) {
+            cbor_value_free(&key);
+            goto error;
+        }
+        if (cbor_read_value(rd, &value)) {
+            free(key.u.s);
+            goto error;
+        }
+
+        data_t *appended = NULL;
+        switch (value.type) {
+        case DATA_INT:
+            appended = data_append(data, key.u.s, NULL, DATA_INT, value.u.i, NULL);
+            break;
+        case DATA_DOUBLE:
+            appended = data_append(data, key.u.s, NULL, DATA_DOUBLE, value.u.d, NULL);
+            break;
+        case DATA_STRING:
+            appended = data_append(data, key.u.s, NULL, DATA_STRING, value.u.s, NULL);
+            free(value.u.s);
+            break;
+        case DATA_DATA:
+            appended = data_append(data, key.u.s, NULL, DATA_DATA, value.u.data, NULL);
+            break;
+        case DATA_ARRAY:
+            appended = data_append(data, key.u.s, NULL, DATA_ARRAY, value.u.array, NULL);
+            break;
+        default:
+            break;
+        }
+        free(key.u.s);
+        if (!appended)
+            return NULL; // data_append() released the list
+        data = appended;
+    }
+    return data;
+
+error:
+    data_free(data);
+    return NULL;
+}
+
+static data_array_t *cbor_read_array(cbor_reader_t *rd, uint64_t count)
+{
+    // every element takes at least one byte
+    if (count > (uint64_t)(rd->end - rd->pos))
+        return NULL;
+
+    cbor_value_t *values = calloc(count ? (size_t)count : 1, sizeof(*values));
+    if (!values)
+        return NULL;
+
+    data_array_t *array = NULL;
+    data_type_t type    = DATA_INT; // for an empty array
+    size_t n            = 0;
+    for (; n < count; ++n) {
+        if (cbor_read_value(rd, &values[n]))
+            goto done;
+        if (n && values[n].type != type) {
+            ++n;
+            goto done; // arrays hold one type only
+        }
+        type = values[n].type;
+    }
+
+    // the elements in the layout data_array() expects
+    size_t element_size = type == DATA_INT ? sizeof(int)
+            : type == DATA_DOUBLE ? sizeof(double)
+            : sizeof(void *);
+    uint8_t *elements = calloc(count ? (size_t)count : 1, element_size);
+    if (!elements)
+        goto done;
+    for (size_t i = 0; i < n; ++i) {
+        void *dst = elements + i * element_size;
+        switch (type) {
+        case DATA_INT:
+            memcpy(dst, &values[i].u.i, element_size);
+            break;
+        case DATA_DOUBLE:
+            memcpy(dst, &values[i].u.d, element_size);
+            break;
+        default:
+            memcpy(dst, &values[i].u, element_size); // the pointer
+            break;
+        }
+    }
+    array = data_array((int)count, type, elements);
+    free(elements);
+    if (array && type != DATA_STRING)
+        n = 0; // moved into the array, strings were copied
+
+done:
+    for (size_t i = 0; i < n; ++i)
+        cbor_value_free(&values[i]);
+    free(values);
+    return array;
+}
+
+static int cbor_read_value(cbor_reader_t *rd, cbor_value_t *value)
+{
+    unsigned major, info;
+    uint64_t arg;
+    if (cbor_read_head(rd, &major, &info, &arg))
+        return -1;
+
+    switch (major) {
+    case CBOR_UINT:
+        if (arg <= INT_MAX) {
+            value->type = DATA_INT;
+            value->u.i  = (int)arg;
+        }
+        else {
+            value->type = DATA_DOUBLE;
+            value->u.d  = (double)arg;
+        }
+        return 0;
+    case CBOR_NEGINT:
+        if (arg <= (uint64_t)INT_MAX) {
+            value->type = DATA_INT;
+            value->u.i  = -1 - (int)arg;
+        }
+        else {
+            value->type = DATA_DOUBLE;
+            value->u.d  = -1.0 - (double)arg;
+        }
+        return 0;
+    case CBOR_TEXT:
+        if (arg > (uint64_t)(rd->end - rd->pos))
+            return -1;
+        value->type = DATA_STRING;
+        value->u.s  = malloc((size_t)arg + 1);
+        if (!value->u.s)
+            return -1;
+        memcpy(value->u.s, rd->pos, (size_t)arg);
+        value->u.s[arg] = '\0';
+        rd->pos += arg;
+        return 0;
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+        if (rd->depth >= CBOR_MAX_DEPTH)
+            return -1;
+        rd->depth++;
+        if (major == CBOR_ARRAY) {
+            value->type    = DATA_ARRAY;
+            value->u.array = cbor_read_array(rd, arg);
+        }
+        else {
+            value->type   = DATA_DATA;
+            value->u.data = arg ? cbor_read_map(rd, arg) : NULL;
+        }
+        rd->depth--;
+        // an empty map has no data_t, it is invalid here like in the printers
+        return value->type == DATA_ARRAY ? (value->u.array ? 0 : -1) : (value->u.data ? 0 : -1);
+    case CBOR_TAG: {
+        if (rd->depth >= CBOR_MAX_DEPTH)
+            return -1;
+        rd->depth++;
+        int ret = cbor_read_value(rd, value);
+        rd->depth--;
+        return ret;
+    }
+    case CBOR_SIMPLE:
+        if (info == CBOR_FALSE || info == CBOR_TRUE) {
+            value->type = DATA_INT;
+            value->u.i  = info == CBOR_TRUE;
+            return 0;
+        }
+        value->type = DATA_DOUBLE;
+        if (info == CBOR_HALF) {
+            value->u.d = cbor_half_to_double((unsigned)arg);
+            return 0;
+        }
+        if (info == CBOR_FLOAT) {
+            uint32_t bits = (uint32_t)arg;
+            float single;
+            memcpy(&single, &bits, sizeof(single));
+            value->u.d = single;
+            return 0;
+        }
+        if (info == CBOR_DOUBLE) {
+            memcpy(&value->u.d, &arg, sizeof(value->u.d));
+            return 0;
+        }
+        return -1; // null and undefined have no data type
+    case CBOR_BYTES:
+    default:
+        return -1; // byte strings have no data type
+    }
+}
+
+data_t *data_cbor_decode(uint8_t const *buf, size_t len)
+{
+    cbor_reader_t rd = {.pos = buf, .end = buf + len};
+    cbor_value_t value;
+
+    if (cbor_read_value(&rd, &value))
+        return NULL;
+    if (value.type != DATA_DATA || rd.pos != rd.end) {
+        cbor_value_free(&value);
+        return NULL;
+    }
+    return value.u.data;
+}
+
+int data_cbor_read(FILE *file, data_t **data)
+{
+    uint8_t prefix[4];
+    size_t got = fread(prefix, 1, sizeof(prefix), file);
+    if (got == 0 && feof(file))
+        return 0;
+    if (got != sizeof(prefix))
+        return -1;
+
+    uint32_t len = (uint32_t)prefix[0] << 24 | (uint32_t)prefix[1] << 16 | (uint32_t)prefix[2] << 8 | prefix[3];
+    if (len == 0 || len > CBOR_RECORD_MAX)
+        return -1;
+    uint8_t *buf = malloc(len);
+    if (!buf)
+        return -1;
+    if (fread(buf, 1, len, file) != len) {
+        free(buf);
+        return -1;
+    }
+    *data = data_cbor_decode(buf, len);
+    free(buf);
+    return *data ? 1 : -1;
+}
@@ -23,13 +23,17 @@
 #include <string.h>
 #include <stdbool.h>
 #include "redir_print.h"
+#include "fmt.h"
 #include "data_printer_csv.h"
+#include "data_record.h"
 
 /* CSV printer; doesn't really support recursive data objects yet */
 
 typedef struct {
     data_output_t output;
     const char **fields;
+    data_schema_t *schema;  ///< the fields resolved to columns
+    data_record_t *record;  ///< the current row
     int data_recursion;
     const char *separator;
 } data_output_csv_t;
@@ -37,22 +41,17 @@ typedef struct {
 static void print_csv_data(data_output_t *output, data_t *data, char *format){
     data_output_csv_t *csv = (data_output_csv_t *)output;
 
-    const char **fields = csv->fields;
     int i;
 
-    if (csv->data_recursion)
+    if (csv->data_recursion || !csv->record)
         return;
 
     ++csv->data_recursion;
-    for (i = 0; fields[i]; ++i) {
-        const char *key = fields[i];
-        data_t *found = NULL;
+    data_record_index(csv->record, data);
+    for (i = 0; i < (int)csv->schema->num_slots; ++i) {
+        data_t *found = data_record_get(csv->record, i);
         if (i)
             fprintf(output->file, "%s", csv->separator);
-        for (data_t *iter = data; !found && iter; iter = iter->next)
-            if (strcmp(iter->key, key) == 0)
-                found = iter;
-
         if (found)
             print_value(output, found->type, found->value, found->format);
     }
@@ -70,6 +69,20 @@ static void print_csv_array(data_output_t *output, data_array_t *array, char *fo
 static void print_csv_string(data_output_t *output, const char *str, char *format){
     data_output_csv_t *csv = (data_output_csv_t *)output;
 
+    if (csv->separator[0] && !csv->separator[1]) {
+        // copy runs up to the next separator
+        char sep = csv->separator[0];
+        for (;;) {
+            size_t run = fmt_escape_span(str, sep, sep);
+            fwrite(str, 1, run, output->file);
+            str += run;
+            if (!*str)
+                return;
+            fputc('\\', output->file);
+            fputc(*str++, output->file);
+        }
+    }
+
     while (*str) {
         if (strncmp(str, csv->separator, strlen(csv->separator)) == 0)
             fputc('\\', output->file);
@@ -140,6 +153,17 @@ void data_output_csv_start(data_output_t *output, const char **fields, int num_f
     free(allowed);
     free(use_count);
 
+    // resolve the columns once, rows are then indexed by slot
+    csv->schema = data_schema_create(csv->fields, csv_fields);
+    csv->record = csv->schema ? data_record_create(csv->schema) : NULL;
+    if (!csv->record) {
+        rtl433_fprintf(stderr, "data_output_csv_start: out of memory\n");
+        data_schema_free(csv->schema);
+        csv->schema = NULL;
+        csv->fields[0] = NULL; // print nothing
+        return;
+    }
+
     // Output the CSV header
     for (i = 0; csv->fields[i]; ++i) {
         fprintf(csv->output.file, "%s%s", i > 0 ? csv->separator : "", csv->fields[i]);
@@ -157,12 +181,14 @@ alloc_error:
 
 static void print_csv_double(data_output_t *output, double data, char *format)
 {
-    fprintf(output->file, "%.3f", data);
+    char buf[FMT_BUFLEN];
+    fwrite(buf, 1, fmt_fixed(buf, data, 3), output->file);
 }
 
 static void print_csv_int(data_output_t *output, int data, char *format)
 {
-    fprintf(output->file, "%d", data);
+    char buf[FMT_BUFLEN];
+    fwrite(buf, 1, fmt_int(buf, data), output->file);
 }
 
 static void data_output_csv_free(data_output_t *output){
@@ -171,6 +197,8 @@ static void data_output_csv_free(data_output_t *output){
     if (output->file != stdout)
         fclose(output->file);
 
+    data_record_free(csv->record);
+    data_schema_free(csv->schema);
     free(csv->fields);
     free(csv);
 }
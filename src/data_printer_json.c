@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "redir_print.h"
+#include "fmt.h"
 #include "data_printer_json.h"
  
 /* JSON printer */
@@ -55,24 +56,29 @@ static void print_json_data(data_output_t *output, data_t *data, char *format)
 
 static void print_json_string(data_output_t *output, const char *str, char *format)
 {
-    fprintf(output->file, "\"");
-    while (*str) {
-        if (*str == '"')
-            fputc('\\', output->file);
-        fputc(*str, output->file);
-        ++str;
+    fputc('"', output->file);
+    for (;;) {
+        size_t run = fmt_escape_span(str, '"', '"');
+        fwrite(str, 1, run, output->file);
+        str += run;
+        if (!*str)
+            break;
+        fputc('\\', output->file);
+        fputc(*str++, output->file);
     }
-    fprintf(output->file, "\"");
+    fputc('"', output->file);
 }
 
 static void print_json_double(data_output_t *output, double data, char *format)
 {
-    fprintf(output->file, "%.3f", data);
+    char buf[FMT_BUFLEN];
+    fwrite(buf, 1, fmt_fixed(buf, data, 3), output->file);
 }
 
 static void print_json_int(data_output_t *output, int data, char *format)
 {
-    fprintf(output->file, "%d", data);
+    char buf[FMT_BUFLEN];
+    fwrite(buf, 1, fmt_int(buf, data), output->file);
 }
 
 static void data_output_json_free(data_output_t *output)
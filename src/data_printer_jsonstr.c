@@ -23,6 +23,8 @@
 #include <string.h>
 #include "redir_print.h"
 #include "abuf.h"
+#include "compat_thread.h"
+#include "fmt.h"
 #include "data_printer_jsonstr.h"
  
 /* JSON string printer */
@@ -30,19 +32,50 @@
 typedef struct {
     data_output_t output;
     abuf_t msg;
+    int overflow; ///< something did not fit and was cut or left out
 } data_print_jsons_t;
 
+static unsigned volatile jsons_serialized;
+static unsigned volatile jsons_reused;
+
+static void jsons_cat(data_print_jsons_t *jsons, const char *str)
+{
+    if (jsons->msg.left < strlen(str) + 1)
+        jsons->overflow = 1;
+    abuf_cat(&jsons->msg, str);
+}
+
+/// Append @p n chars, cut like abuf_printf() does.
+static void jsons_put(data_print_jsons_t *jsons, char const *str, size_t n)
+{
+    abuf_t *msg = &jsons->msg;
+    if (n >= msg->left) {
+        jsons->overflow = 1;
+        if (!msg->left)
+            return;
+        memcpy(msg->tail, str, msg->left - 1);
+        msg->tail[msg->left - 1] = '\0';
+        msg->tail += msg->left;
+        msg->left = 0;
+        return;
+    }
+    memcpy(msg->tail, str, n);
+    msg->tail[n] = '\0';
+    msg->tail += n;
+    msg->left -= n;
+}
+
 static void format_jsons_array(data_output_t *output, data_array_t *array, char *format)
 {
     data_print_jsons_t *jsons = (data_print_jsons_t *)output;
 
-    abuf_cat(&jsons->msg, "[");
+    jsons_cat(jsons, "[");
     for (int c = 0; c < array->num_values; ++c) {
         if (c)
-            abuf_cat(&jsons->msg, ",");
+            jsons_cat(jsons, ",");
         print_array_value(output, array, format, c);
     }
-    abuf_cat(&jsons->msg, "]");
+    jsons_cat(jsons, "]");
 }
 
 static void format_jsons_object(data_output_t *output, data_t *data, char *format)
@@ -50,17 +83,17 @@ static void format_jsons_object(data_output_t *output, data_t *data, char *forma
     data_print_jsons_t *jsons = (data_print_jsons_t *)output;
 
     bool separator = false;
-    abuf_cat(&jsons->msg, "{");
+    jsons_cat(jsons, "{");
     while (data) {
         if (separator)
-            abuf_cat(&jsons->msg, ",");
+            jsons_cat(jsons, ",");
         output->print_string(output, data->key, NULL);
-        abuf_cat(&jsons->msg, ":");
+        jsons_cat(jsons, ":");
         print_value(output, data->type, data->value, data->format);
         separator = true;
         data      = data->next;
     }
-    abuf_cat(&jsons->msg, "}");
+    jsons_cat(jsons, "}");
 }
 
 static void format_jsons_string(data_output_t *output, const char *str, char *format)
@@ -71,23 +104,36 @@ static void format_jsons_string(data_output_t *output, const char *str, char *fo
     size_t size = jsons->msg.left;
 
     if (size < strlen(str) + 3) {
+        jsons->overflow = 1;
         return;
     }
 
     *buf++ = '"';
     size--;
-    for (; *str && size >= 3; ++str) {
-        if (*str == '"' || *str == '\\') {
+    while (*str && size >= 3) {
+        size_t run = fmt_escape_span(str, '"', '\\');
+        if (run > size - 2)
+            run = size - 2;
+        memcpy(buf, str, run);
+        buf += run;
+        str += run;
+        size -= run;
+        if (*str && size >= 3) {
+            // the run stopped at a quote or backslash
             *buf++ = '\\';
-            size--;
+            *buf++ = *str++;
+            size -= 2;
         }
-        *buf++ = *str;
-        size--;
     }
+    if (*str)
+        jsons->overflow = 1;
     if (size >= 2) {
         *buf++ = '"';
         size--;
     }
+    else {
+        jsons->overflow = 1;
+    }
     *buf = '\0';
 
     jsons->msg.tail = buf;
@@ -97,12 +143,13 @@ static void format_jsons_string(data_output_t *output, const char *str, char *fo
 static void format_jsons_double(data_output_t *output, double data, char *format)
 {
     data_print_jsons_t *jsons = (data_print_jsons_t *)output;
+    char buf[FMT_BUFLEN];
     // use scientific notation for very big/small values
     if (data > 1e7 || data < 1e-4) {
-        abuf_printf(&jsons->msg, "%g", data);
+        jsons_put(jsons, buf, fmt_general(buf, data));
     }
     else {
-        abuf_printf(&jsons->msg, "%.5f", data);
+        jsons_put(jsons, buf, fmt_fixed(buf, data, 5));
         // remove trailing zeros, always keep one digit after the decimal point
         while (jsons->msg.left > 0 && *(jsons->msg.tail - 1) == '0' && *(jsons->msg.tail - 2) != '.') {
             jsons->msg.tail--;
@@ -115,10 +162,11 @@ static void format_jsons_double(data_output_t *output, double data, char *format
 static void format_jsons_int(data_output_t *output, int data, char *format)
 {
     data_print_jsons_t *jsons = (data_print_jsons_t *)output;
-    abuf_printf(&jsons->msg, "%d", data);
+    char buf[FMT_BUFLEN];
+    jsons_put(jsons, buf, fmt_int(buf, data));
 }
 
-size_t data_print_jsons(data_t *data, char *dst, size_t len)
+static size_t jsons_serialize(data_t *data, char *dst, size_t len, int *overflow)
 {
     data_print_jsons_t jsons = {
             .output.print_data   = format_jsons_object,
@@ -132,5 +180,64 @@ size_t data_print_jsons(data_t *data, char *dst, size_t len)
 
     format_jsons_object(&jsons.output, data, NULL);
 
+    if (overflow)
+        *overflow = jsons.overflow;
     return len - jsons.msg.left;
 }
+
+size_t data_print_jsons(data_t *data, char *dst, size_t len)
+{
+    return jsons_serialize(data, dst, len, NULL);
+}
+
+char const *data_print_jsons_cached(data_t *data, size_t *len)
+{
+    char *json = compat_load_acquire_ptr((void *const volatile *)&data->json);
+    if (json) {
+        compat_fetch_add(&jsons_reused, 1);
+        if (len)
+            *len = strlen(json);
+        return json;
+    }
+
+    // most events are around 500 bytes, grow the buffer for the full state messages
+    size_t size = 1024;
+    size_t json_len;
+    for (;;) {
+        json = malloc(size);
+        if (!json)
+            return NULL;
+        int overflow;
+        json_len = jsons_serialize(data, json, size, &overflow);
+        if (!overflow)
+            break;
+        free(json);
+        size *= 2;
+    }
+
+    // outputs on their own threads might race, the first one wins
+    if (!compat_cas_ptr((void *volatile *)&data->json, NULL, json)) {
+        free(json);
+        json = compat_load_acquire_ptr((void *const volatile *)&data->json);
+        json_len = strlen(json);
+        compat_fetch_add(&jsons_reused, 1);
+    }
+    else {
+        compat_fetch_add(&jsons_serialized, 1);
+    }
+    if (len)
+        *len = json_len;
+    return json;
+}
+
+void data_print_jsons_stats(unsigned *serialized, unsigned *reused)
+{
+    *serialized = compat_load_acquire(&jsons_serialized);
+    *reused     = compat_load_acquire(&jsons_reused);
+}
+
+void data_print_jsons_stats_reset(void)
+{
+    compat_store_release(&jsons_serialized, 0);
+    compat_store_release(&jsons_reused, 0);
+}
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include "redir_print.h"
+#include "fmt.h"
 #include "data_printer_kv.h"
 #include "term_ctl.h"
 
@@ -163,22 +164,45 @@ static void print_kv_array(data_output_t *output, data_array_t *array, char *for
 static void print_kv_double(data_output_t *output, double data, char *format)
 {
     data_output_kv_t *kv = (data_output_kv_t *)output;
-    
-    kv->column += fprintf(output->file, format ? format : "%.3f", data);
+    char buf[FMT_BUFLEN];
+    int precision       = 3;
+    char const *suffix  = "";
+
+    // most decoder formats are "%.<precision>f<unit>"
+    if (format && !fmt_parse_fixed(format, &precision, &suffix)) {
+        kv->column += fprintf(output->file, format, data);
+        return;
+    }
+    size_t len = fmt_fixed(buf, data, precision);
+    fwrite(buf, 1, len, output->file);
+    fputs(suffix, output->file);
+    kv->column += (int)(len + strlen(suffix));
 }
 
 static void print_kv_int(data_output_t *output, int data, char *format)
 {
     data_output_kv_t *kv = (data_output_kv_t *)output;
-    
-    kv->column += fprintf(output->file, format ? format : "%d", data);
+    char buf[FMT_BUFLEN];
+
+    if (format && strcmp(format, "%d")) {
+        kv->column += fprintf(output->file, format, data);
+        return;
+    }
+    size_t len = fmt_int(buf, data);
+    fwrite(buf, 1, len, output->file);
+    kv->column += (int)len;
 }
 
 static void print_kv_string(data_output_t *output, const char *data, char *format)
 {
     data_output_kv_t *kv = (data_output_kv_t *)output;
-    
-    kv->column += fprintf(output->file, format ? format : "%s", data);
+
+    if (format && strcmp(format, "%s")) {
+        kv->column += fprintf(output->file, format, data);
+        return;
+    }
+    fputs(data, output->file);
+    kv->column += (int)strlen(data);
 }
 
 static void data_output_kv_free(data_output_t *output)
@@ -18,6 +18,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// sendmmsg() needs _GNU_SOURCE
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
 
 #include <stdlib.h>
 #include <string.h>
@@ -29,7 +33,9 @@
 #include "data_printer_jsonstr.h" // TODO: include here instead of own(?) printer file?
 #include "redir_print.h"
 // gethostname() needs _XOPEN_SOURCE 500 on unistd.h
+#ifndef _XOPEN_SOURCE
 #define _XOPEN_SOURCE 500
+#endif
 
 #ifndef _MSC_VER
 #include <unistd.h>
@@ -46,6 +52,8 @@
 #else
   #include <netdb.h>
   #include <netinet/in.h>
+  #include <sys/socket.h>
+  #include <errno.h>
 
   #define SOCKET          int
   #define INVALID_SOCKET  -1
@@ -54,6 +62,9 @@
 #include <time.h>
 
 #include "data.h"
+#include "data_printer_udp.h"
+#include "compat_thread.h"
+#include "r_util.h"
 
 #ifdef _WIN32
   #define _POSIX_HOST_NAME_MAX  128
@@ -134,12 +145,51 @@ static void datagram_client_close(datagram_client_t *client)
 #endif
 }
 
-static void datagram_client_send(datagram_client_t *client, const char *message, size_t message_len)
+static int datagram_client_send(datagram_client_t *client, const char *message, size_t message_len)
 {
     int r =  sendto(client->sock, message, message_len, 0, (struct sockaddr *)&client->addr, client->addr_len);
     if (r == -1) {
         perror("sendto");
     }
+    return r == -1 ? -1 : 0;
+}
+
+/// Send @p count messages of @p stride bytes each, returns the number sent.
+static unsigned datagram_client_send_batch(datagram_client_t *client, char const *buf, size_t stride, size_t const *lens, unsigned count)
+{
+    unsigned next = 0;
+    unsigned sent = 0;
+#ifdef __linux__
+    // one system call for the whole batch
+    struct mmsghdr msgs[SYSLOG_BATCH_MAX];
+    struct iovec iovs[SYSLOG_BATCH_MAX];
+    memset(msgs, 0, count * sizeof(*msgs));
+    for (unsigned i = 0; i < count; ++i) {
+        iovs[i].iov_base            = (void *)(buf + i * stride);
+        iovs[i].iov_len             = lens[i];
+        msgs[i].msg_hdr.msg_name    = &client->addr;
+        msgs[i].msg_hdr.msg_namelen = client->addr_len;
+        msgs[i].msg_hdr.msg_iov     = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen  = 1;
+    }
+    while (next < count) {
+        int r = sendmmsg(client->sock, msgs + next, count - next, 0);
+        if (r > 0) {
+            next += r;
+            sent += r;
+            continue;
+        }
+        if (errno == ENOSYS)
+            break; // fall back to a sendto() each
+        perror("sendmmsg");
+        ++next; // skip the message which failed
+    }
+#endif
+    for (; next < count; ++next) {
+        if (!datagram_client_send(client, buf + next * stride, lens[next]))
+            ++sent;
+    }
+    return sent;
 }
 
 /* Syslog UDP printer, RFC 5424 (IETF-syslog protocol) */
@@ -149,37 +199,127 @@ typedef struct {
     datagram_client_t client;
     int pri;
     char hostname[_POSIX_HOST_NAME_MAX + 1];
+    time_t header_time;   ///< second the cached header was made for
+    char header[64 + _POSIX_HOST_NAME_MAX];
+    size_t header_len;
+    unsigned mtu;
+    unsigned batch;
+    unsigned flush_ms;
+    mutex_t lock;
+    char *buf;            ///< pending messages, mtu bytes apart
+    size_t lens[SYSLOG_BATCH_MAX];
+    unsigned pending;
+    unsigned since_ms;    ///< time of the first pending message
+    syslog_stats_t stats;
 } data_output_syslog_t;
 
+/// Send the pending messages, the lock must be held.
+static void syslog_flush(data_output_syslog_t *syslog)
+{
+    if (!syslog->pending)
+        return;
+    unsigned sent = datagram_client_send_batch(&syslog->client, syslog->buf, syslog->mtu, syslog->lens, syslog->pending);
+    syslog->stats.sent += sent;
+    syslog->stats.failed += syslog->pending - sent;
+    syslog->stats.batches++;
+    syslog->pending = 0;
+}
+
 static void print_syslog_data(data_output_t *output, data_t *data, char *format)
 {
     data_output_syslog_t *syslog = (data_output_syslog_t *)output;
 
-    // we expect a normal message around 500 bytes
-    // full stats report would be 12k and we want a max of MTU anyway
-    char message[1024];
-    abuf_t msg = {0};
-    abuf_init(&msg, message, sizeof(message));
+    size_t json_len;
+    char const *json = data_print_jsons_cached(data, &json_len);
+    if (!json)
+        return;
+
+    mutex_lock(&syslog->lock);
 
+    // the header only changes with the second of the timestamp
     time_t now;
-    struct tm tm_info;
     time(&now);
+    if (now != syslog->header_time) {
+        struct tm tm_info;
 #ifdef _WIN32
-    gmtime_s(&tm_info, &now);
+        gmtime_s(&tm_info, &now);
 #else
-    gmtime_r(&now, &tm_info);
+        gmtime_r(&now, &tm_info);
 #endif
-    char timestamp[21];
-    strftime(timestamp, 21, "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+        char timestamp[21];
+        strftime(timestamp, 21, "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+        syslog->header_len  = snprintf(syslog->header, sizeof(syslog->header), "<%d>1 %s %s rtl_433 - - - ", syslog->pri, timestamp, syslog->hostname);
+        syslog->header_time = now;
+    }
 
-    abuf_printf(&msg, "<%d>1 %s %s rtl_433 - - - ", syslog->pri, timestamp, syslog->hostname);
+    // we expect a normal message around 500 bytes
+    // full stats report would be 12k and we want a max of MTU anyway
+    if (syslog->header_len + json_len > syslog->mtu) {
+        if (!syslog->stats.oversize)
+            rtl433_fprintf(stderr, "Syslog message of %zu bytes exceeds the MTU of %u, dropped.\n", syslog->header_len + json_len, syslog->mtu);
+        syslog->stats.oversize++;
+        mutex_unlock(&syslog->lock);
+        return;
+    }
 
-    msg.tail += data_print_jsons(data, msg.tail, msg.left);
-    if (msg.tail >= msg.head + sizeof(message))
-        return; // abort on overflow, we don't actually want to send more than fits the MTU
+    char *message = syslog->buf + (size_t)syslog->pending * syslog->mtu;
+    memcpy(message, syslog->header, syslog->header_len);
+    memcpy(message + syslog->header_len, json, json_len);
+    if (!syslog->pending && syslog->flush_ms)
+        syslog->since_ms = (unsigned)(get_time_us() / 1000);
+    syslog->lens[syslog->pending++] = syslog->header_len + json_len;
 
-    size_t abuf_len = msg.tail - msg.head;
-    datagram_client_send(&syslog->client, message, abuf_len);
+    if (syslog->pending >= syslog->batch)
+        syslog_flush(syslog);
+    mutex_unlock(&syslog->lock);
+}
+
+static void data_output_syslog_poll(data_output_t *output)
+{
+    data_output_syslog_t *syslog = (data_output_syslog_t *)output;
+
+    mutex_lock(&syslog->lock);
+    if (syslog->pending && (!syslog->flush_ms || (unsigned)(get_time_us() / 1000) - syslog->since_ms >= syslog->flush_ms))
+        syslog_flush(syslog);
+    mutex_unlock(&syslog->lock);
+}
+
+int data_output_syslog_stats(data_output_t *output, syslog_stats_t *stats)
+{
+    data_output_syslog_t *syslog = (data_output_syslog_t *)output;
+
+    if (!output || output->print_data != print_syslog_data)
+        return -1;
+
+    mutex_lock(&syslog->lock);
+    *stats = syslog->stats;
+    mutex_unlock(&syslog->lock);
+    return 0;
+}
+
+void data_output_syslog_stats_reset(data_output_t *output)
+{
+    data_output_syslog_t *syslog = (data_output_syslog_t *)output;
+
+    if (!output || output->print_data != print_syslog_data)
+        return;
+
+    mutex_lock(&syslog->lock);
+    memset(&syslog->stats, 0, sizeof(syslog->stats));
+    mutex_unlock(&syslog->lock);
+}
+
+static data_t *data_output_syslog_stats_data(data_output_t *output, data_t *stats)
+{
+    syslog_stats_t ss = {0};
+    if (data_output_syslog_stats(output, &ss))
+        return stats;
+    return data_append(stats,
+            "sent",             "", DATA_INT, ss.sent,
+            "failed",           "", DATA_INT, ss.failed,
+            "oversize",         "", DATA_INT, ss.oversize,
+            "batches",          "", DATA_INT, ss.batches,
+            NULL);
 }
 
 static void data_output_syslog_free(data_output_t *output)
@@ -189,8 +329,11 @@ static void data_output_syslog_free(data_output_t *output)
     if (!syslog)
         return;
 
+    syslog_flush(syslog);
     datagram_client_close(&syslog->client);
 
+    mutex_destroy(&syslog->lock);
+    free(syslog->buf);
     free(syslog);
 
 #ifdef _WIN32
@@ -200,13 +343,23 @@ static void data_output_syslog_free(data_output_t *output)
 #endif
 }
 
-data_output_t *data_output_syslog_create(const char *host, const char *port)
+data_output_t *data_output_syslog_create(const char *host, const char *port, unsigned batch, unsigned flush_ms, unsigned mtu)
 {
     data_output_syslog_t *syslog = calloc(1, sizeof(data_output_syslog_t));
     if (!syslog) {
         rtl433_fprintf(stderr, "calloc() failed");
         return NULL;
     }
+    syslog->mtu      = mtu && mtu < SYSLOG_MTU_MAX ? mtu : SYSLOG_MTU_MAX;
+    syslog->batch    = batch < 1 ? 1 : batch > SYSLOG_BATCH_MAX ? SYSLOG_BATCH_MAX : batch;
+    syslog->flush_ms = flush_ms;
+    syslog->buf      = malloc((size_t)syslog->batch * syslog->mtu);
+    if (!syslog->buf) {
+        rtl433_fprintf(stderr, "malloc() failed");
+        free(syslog);
+        return NULL;
+    }
+    mutex_init(&syslog->lock);
 #ifdef _WIN32
     WSADATA wsa;
 
@@ -217,10 +370,13 @@ data_output_t *data_output_syslog_create(const char *host, const char *port)
     }
 #endif
 
-    syslog->output.print_data   = print_syslog_data;
-    syslog->output.output_free  = data_output_syslog_free;
-    syslog->output.file = NULL;
-    syslog->output.ext_callback = NULL; // prevents this printer to receive unknown signals
+    syslog->output.print_data         = print_syslog_data;
+    syslog->output.output_poll        = data_output_syslog_poll;
+    syslog->output.output_free        = data_output_syslog_free;
+    syslog->output.output_stats       = data_output_syslog_stats_data;
+    syslog->output.output_stats_reset = data_output_syslog_stats_reset;
+    syslog->output.file               = NULL;
+    syslog->output.ext_callback       = NULL; // prevents this printer to receive unknown signals
     // Severity 5 "Notice", Facility 20 "local use 4"
     syslog->pri = 20 * 8 + 5;
     gethostname(syslog->hostname, _POSIX_HOST_NAME_MAX + 1);
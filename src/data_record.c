@@ -0,0 +1,131 @@
+/** @file
+    Schema indexed records, O(1) field lookup for structured data.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data_record.h"
+
+static unsigned schema_hash(data_schema_t const *schema, char const *key)
+{
+    // interned keys are unique, hash the pointer
+    return (unsigned)(((uintptr_t)key >> 3) * 2654435761u) & schema->hash_mask;
+}
+
+data_schema_t *data_schema_create(char const *const *keys, int num_keys)
+{
+    if (num_keys < 0)
+        for (num_keys = 0; keys && keys[num_keys]; ++num_keys)
+            ;
+
+    data_schema_t *schema = calloc(1, sizeof(*schema));
+    if (!schema)
+        return NULL;
+
+    unsigned hash_size = 16;
+    while (hash_size < 2 * (unsigned)num_keys)
+        hash_size *= 2;
+    schema->hash_mask  = hash_size - 1;
+    schema->keys       = calloc(num_keys ? num_keys : 1, sizeof(*schema->keys));
+    schema->hash_keys  = calloc(hash_size, sizeof(*schema->hash_keys));
+    schema->hash_slots = calloc(hash_size, sizeof(*schema->hash_slots));
+    if (!schema->keys || !schema->hash_keys || !schema->hash_slots)
+        goto alloc_error;
+
+    for (int i = 0; i < num_keys; ++i) {
+        char const *key = data_key_intern(keys[i]);
+        if (!key)
+            goto alloc_error;
+        schema->keys[i] = key;
+
+        unsigned idx = schema_hash(schema, key);
+        while (schema->hash_keys[idx] && schema->hash_keys[idx] != key)
+            idx = (idx + 1) & schema->hash_mask;
+        if (!schema->hash_keys[idx]) {
+            schema->hash_keys[idx]  = key;
+            schema->hash_slots[idx] = i;
+        }
+    }
+    schema->num_slots = num_keys;
+    return schema;
+
+alloc_error:
+    data_schema_free(schema);
+    return NULL;
+}
+
+void data_schema_free(data_schema_t *schema)
+{
+    if (!schema)
+        return;
+    free(schema->hash_slots);
+    free(schema->hash_keys);
+    free(schema->keys);
+    free(schema);
+}
+
+int data_schema_slot(data_schema_t const *schema, data_t const *data)
+{
+    char const *key = data->key;
+    if (!(data->interned & DATA_INTERNED_KEY)) {
+        key = data_key_find(key);
+        if (!key)
+            return -1; // never interned, so it can't be one of ours
+    }
+
+    unsigned idx = schema_hash(schema, key);
+    while (schema->hash_keys[idx]) {
+        if (schema->hash_keys[idx] == key)
+            return schema->hash_slots[idx];
+        idx = (idx + 1) & schema->hash_mask;
+    }
+    return -1;
+}
+
+data_record_t *data_record_create(data_schema_t const *schema)
+{
+    data_record_t *record = calloc(1, sizeof(*record));
+    if (!record)
+        return NULL;
+    unsigned num_slots = schema->num_slots ? schema->num_slots : 1;
+    record->schema     = schema;
+    record->set        = calloc(num_slots, sizeof(*record->set));
+    record->slots      = calloc(num_slots, sizeof(*record->slots));
+    if (!record->set || !record->slots) {
+        data_record_free(record);
+        return NULL;
+    }
+    return record;
+}
+
+void data_record_free(data_record_t *record)
+{
+    if (!record)
+        return;
+    free(record->slots);
+    free(record->set);
+    free(record);
+}
+
+void data_record_index(data_record_t *record, data_t *data)
+{
+    // only clear the slots of the previous event
+    for (unsigned i = 0; i < record->num_set; ++i)
+        record->slots[record->set[i]] = NULL;
+    record->num_set = 0;
+
+    for (; data; data = data->next) {
+        int slot = data_schema_slot(record->schema, data);
+        if (slot < 0 || record->slots[slot])
+            continue;
+        record->slots[slot]            = data;
+        record->set[record->num_set++] = slot;
+    }
+}
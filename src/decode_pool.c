@@ -0,0 +1,316 @@
+/** @file
+    Worker pool to run the decoders of a package in parallel.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "decode_pool.h"
+#include "compat_thread.h"
+#include "data.h"
+#include "data_printer_ext.h"
+#include "redir_print.h"
+
+/// One decoder output call, kept until all groups of the package are done.
+typedef struct pool_output {
+    r_device *decoder;
+    data_t *data;
+    int has_ext;
+    extdata_t ext;
+    bitbuffer_t bits; ///< copy, the demodulators bits are gone once the decoder returns
+} pool_output_t;
+
+/// One demod group of the current package.
+typedef struct pool_task {
+    demod_group_t *group;
+    int events;
+    list_t output; ///< pool_output_t elements in call order
+} pool_task_t;
+
+typedef struct pool_worker {
+    struct decode_pool *pool;
+    thread_t thread;
+    mutex_t lock;  ///< guards next and end
+    unsigned next; ///< own tasks are taken from the front...
+    unsigned end;  ///< ...and stolen from the back
+} pool_worker_t;
+
+struct decode_pool {
+    unsigned num_workers;    ///< worker 0 is the thread calling decode_pool_run()
+    pool_worker_t *workers;
+    decode_output_fn output_fn;
+    list_t const *order;     ///< decoders in registration order, the order the output is passed on in
+    list_t replay;           ///< pool_output_t elements of the current package, NULL once passed on
+
+    mutex_t lock;            ///< guards generation, busy and exit
+    cond_t start;
+    cond_t done;
+    unsigned generation;     ///< incremented for each package
+    unsigned busy;           ///< worker threads still on the current package
+    int exit;
+
+    pool_task_t *tasks;
+    unsigned num_tasks;
+    unsigned tasks_size;
+    pulse_data_t const *pulses;
+};
+
+/// Output callback while a decoder runs on the pool.
+static void pool_collect_output(r_device *decoder, data_t *data, extdata_t *ext)
+{
+    pool_task_t *task     = decoder->output_ctx;
+    pool_output_t *output = malloc(sizeof(*output));
+    if (!output) {
+        rtl433_fprintf(stderr, "decode_pool: out of memory, dropping output of \"%s\"\n", decoder->name);
+        data_free(data);
+        return;
+    }
+    output->decoder = decoder;
+    output->data    = data;
+    output->has_ext = ext != NULL;
+    if (ext) {
+        output->ext = *ext;
+        if (ext->bitbuffer)
+            output->bits = *ext->bitbuffer;
+    }
+    list_push(&task->output, output);
+}
+
+static void pool_run_task(struct decode_pool *pool, pool_task_t *task)
+{
+    list_t *members = &task->group->members;
+    for (size_t i = 0; i < members->len; ++i) {
+        r_device *r_dev   = members->elems[i];
+        r_dev->output_fn  = pool_collect_output;
+        r_dev->output_ctx = task;
+    }
+
+    task->events = pulse_demod_device(pool->pulses, demod_group_device(task->group));
+
+    for (size_t i = 0; i < members->len; ++i) {
+        r_device *r_dev   = members->elems[i];
+        r_dev->output_fn  = pool->output_fn;
+        r_dev->output_ctx = NULL;
+    }
+}
+
+/// Next task of a worker, or one stolen from another worker.
+static pool_task_t *pool_take_task(struct decode_pool *pool, unsigned self)
+{
+    for (unsigned k = 0; k < pool->num_workers; ++k) {
+        pool_worker_t *worker = &pool->workers[(self + k) % pool->num_workers];
+        pool_task_t *task     = NULL;
+        mutex_lock(&worker->lock);
+        if (worker->next < worker->end) {
+            if (k == 0)
+                task = &pool->tasks[worker->next++];
+            else
+                task = &pool->tasks[--worker->end];
+        }
+        mutex_unlock(&worker->lock);
+        if (task)
+            return task;
+    }
+    return NULL;
+}
+
+static void pool_work(struct decode_pool *pool, unsigned self)
+{
+    pool_task_t *task;
+    while ((task = pool_take_task(pool, self)))
+        pool_run_task(pool, task);
+}
+
+static THREAD_RETURN THREAD_CALL pool_thread(void *arg)
+{
+    pool_worker_t *worker     = arg;
+    struct decode_pool *pool  = worker->pool;
+    unsigned self             = (unsigned)(worker - pool->workers);
+    unsigned generation       = 0;
+
+    mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->exit && pool->generation == generation)
+            cond_wait(&pool->start, &pool->lock);
+        if (pool->exit)
+            break;
+        generation = pool->generation;
+        mutex_unlock(&pool->lock);
+
+        pool_work(pool, self);
+
+        mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            cond_signal(&pool->done);
+    }
+    mutex_unlock(&pool->lock);
+    return 0;
+}
+
+decode_pool_t *decode_pool_create(unsigned num_threads, int affinity, decode_output_fn output_fn, list_t const *order)
+{
+    if (!output_fn || !order)
+        return NULL;
+    if (num_threads < 1)
+        num_threads = 1;
+
+    decode_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+    pool->workers = calloc(num_threads, sizeof(*pool->workers));
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+    pool->output_fn = output_fn;
+    pool->order     = order;
+    mutex_init(&pool->lock);
+    cond_init(&pool->start);
+    cond_init(&pool->done);
+
+    unsigned num_cpus = thread_num_cpus();
+    for (unsigned i = 0; i < num_threads; ++i) {
+        pool_worker_t *worker = &pool->workers[i];
+        worker->pool          = pool;
+        mutex_init(&worker->lock);
+        pool->num_workers = i + 1;
+        if (i == 0)
+            continue; // the calling thread
+        if (thread_start(&worker->thread, pool_thread, worker)) {
+            mutex_destroy(&worker->lock);
+            pool->num_workers = i;
+            decode_pool_free(pool);
+            return NULL;
+        }
+        if (affinity >= 0 && thread_set_affinity(worker->thread, (affinity + i - 1) % num_cpus))
+            rtl433_fprintf(stderr, "decode_pool: could not pin decoder thread %u\n", i);
+    }
+
+    return pool;
+}
+
+void decode_pool_free(decode_pool_t *pool)
+{
+    if (!pool)
+        return;
+
+    mutex_lock(&pool->lock);
+    pool->exit = 1;
+    cond_broadcast(&pool->start);
+    mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->num_workers; ++i) {
+        if (i > 0)
+            thread_join(pool->workers[i].thread);
+        mutex_destroy(&pool->workers[i].lock);
+    }
+    for (unsigned i = 0; i < pool->tasks_size; ++i) {
+        list_free_elems(&pool->tasks[i].output, NULL);
+    }
+    list_free_elems(&pool->replay, NULL);
+
+    cond_destroy(&pool->done);
+    cond_destroy(&pool->start);
+    mutex_destroy(&pool->lock);
+    free(pool->tasks);
+    free(pool->workers);
+    free(pool);
+}
+
+/// Pass on the output of a decoder call and release it.
+static void pool_pass_output(struct decode_pool *pool, pool_output_t *output)
+{
+    if (output->has_ext && output->ext.bitbuffer)
+        output->ext.bitbuffer = &output->bits;
+    pool->output_fn(output->decoder, output->data, output->has_ext ? &output->ext : NULL);
+    free(output);
+}
+
+int decode_pool_run(decode_pool_t *pool, demod_group_t **groups, unsigned num_groups, pulse_data_t const *pulses, int serial)
+{
+    int events = 0;
+
+    if (num_groups > pool->tasks_size) {
+        pool_task_t *tasks = realloc(pool->tasks, num_groups * sizeof(*tasks));
+        if (!tasks) {
+            rtl433_fprintf(stderr, "decode_pool: out of memory, decoding serially\n");
+            for (unsigned i = 0; i < num_groups; ++i)
+                events += pulse_demod_device(pulses, demod_group_device(groups[i]));
+            return events;
+        }
+        memset(&tasks[pool->tasks_size], 0, (num_groups - pool->tasks_size) * sizeof(*tasks));
+        pool->tasks      = tasks;
+        pool->tasks_size = num_groups;
+    }
+
+    pool->num_tasks = num_groups;
+    pool->pulses    = pulses;
+    for (unsigned i = 0; i < num_groups; ++i) {
+        pool->tasks[i].group  = groups[i];
+        pool->tasks[i].events = 0;
+    }
+
+    if (serial || pool->num_workers < 2 || num_groups < 2) {
+        // nothing to split, or debug output that should stay readable
+        for (unsigned i = 0; i < num_groups; ++i)
+            pool_run_task(pool, &pool->tasks[i]);
+    }
+    else {
+        // the workers are idle, no need to lock their ranges
+        for (unsigned i = 0; i < pool->num_workers; ++i) {
+            pool->workers[i].next = num_groups * i / pool->num_workers;
+            pool->workers[i].end  = num_groups * (i + 1) / pool->num_workers;
+        }
+
+        mutex_lock(&pool->lock);
+        pool->busy = pool->num_workers - 1;
+        pool->generation++;
+        cond_broadcast(&pool->start);
+        mutex_unlock(&pool->lock);
+
+        pool_work(pool, 0);
+
+        mutex_lock(&pool->lock);
+        while (pool->busy)
+            cond_wait(&pool->done, &pool->lock);
+        mutex_unlock(&pool->lock);
+    }
+
+    list_clear(&pool->replay, NULL);
+    for (unsigned i = 0; i < num_groups; ++i) {
+        pool_task_t *task = &pool->tasks[i];
+        events += task->events;
+        for (size_t j = 0; j < task->output.len; ++j)
+            list_push(&pool->replay, task->output.elems[j]);
+        list_clear(&task->output, NULL);
+    }
+
+    // pass on the output in registration order, the calls of each decoder in call order,
+    // i.e. exactly as running each decoder on its own in turn
+    size_t pending = pool->replay.len;
+    for (void **iter = pool->order->elems; pending && iter && *iter; ++iter) {
+        for (size_t j = 0; j < pool->replay.len; ++j) {
+            pool_output_t *output = pool->replay.elems[j];
+            if (output && output->decoder == *iter) {
+                pool_pass_output(pool, output);
+                pool->replay.elems[j] = NULL;
+                pending--;
+            }
+        }
+    }
+    // decoders that are not registered, if any
+    for (size_t j = 0; pending && j < pool->replay.len; ++j) {
+        if (pool->replay.elems[j]) {
+            pool_pass_output(pool, pool->replay.elems[j]);
+            pool->replay.elems[j] = NULL;
+            pending--;
+        }
+    }
+
+    return events;
+}
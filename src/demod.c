@@ -6,10 +6,14 @@
 #include "data_printer_json.h"
 #include "data_printer_udp.h"
 #include "data_printer_kv.h"
+#include "data_printer_cbor.h"
 #include "data_printer_ext.h"
 #include "output_mqtt.h"
+#include "output_queue.h"
+#include "file_writer.h"
 #include "redir_print.h"
 #include "pulse_demod.h"
+#include "pulse_file.h"
 
 #ifdef _WIN32
 #include <io.h>
@@ -21,6 +25,10 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 r_device *flex_create_device(char *spec); // maybe put this in some header file?
 
@@ -39,6 +47,7 @@ int dm_state_init(dm_state **out_dm, rtl_433_t *rtl) {
         memset(&dm->lowpass_filter_state, 0, sizeof(dm->lowpass_filter_state));
         memset(&dm->demod_FM_state, 0, sizeof(dm->demod_FM_state));
         dm->enable_FM_demod = 0;
+        dm->lazy_FM_demod = 0;
         dm->samp_grab = NULL;
         dm->am_analyze = (rtl->cfg->analyze_am ? am_analyze_create() : NULL);
         memset(&dm->load_info, 0, sizeof(dm->load_info));
@@ -48,6 +57,20 @@ int dm_state_init(dm_state **out_dm, rtl_433_t *rtl) {
         dm->report_time = rtl->cfg->report_time_preference;
         list_initialize(&dm->r_devs);
         list_ensure_size(&dm->r_devs, 100);
+        list_initialize(&dm->demod_groups);
+        list_initialize(&dm->demod_batch);
+        // the pool also keeps the output of the demod groups in registration order when decoding serially
+        dm->decode_pool = decode_pool_create(rtl->cfg->decode_threads, rtl->cfg->decode_affinity, data_acquired_handler, &dm->r_devs);
+        if (!dm->decode_pool)
+            rtl433_fprintf(stderr, "Could not start the decoder threads, decoding serially.\n");
+        dm->data_convert = NULL;
+        if (rtl->cfg->conversion_mode != CONVERT_NATIVE || rtl->cfg->new_model_keys) {
+            dm->data_convert = data_convert_create(rtl->cfg->conversion_mode, rtl->cfg->new_model_keys);
+            if (!dm->data_convert)
+                rtl433_fprintf(stderr, "Could not create the unit conversion plan, out of memory.\n");
+        }
+        dm->demod_runs = 0;
+        dm->demod_skipped = 0;
         list_initialize(&dm->output_handler);
         list_ensure_size(&dm->output_handler, 16);
         memset(&dm->pulse_data, 0, sizeof(dm->pulse_data));
@@ -57,6 +80,8 @@ int dm_state_init(dm_state **out_dm, rtl_433_t *rtl) {
         dm->frame_end_ago = 0;
         memset(&dm->now, 0, sizeof(dm->now));
         dm->sample_file_pos = 0;
+        dm->channelizer = NULL;
+        list_initialize(&dm->channels);
 
         if (dm->am_analyze) {
             dm->am_analyze->level_limit = &dm->rtl->cfg->level_limit;
@@ -111,7 +136,11 @@ int dm_state_destroy(dm_state *dm){
 
     sdr_deactivate(dm->rtl->dev);
 
+    decode_pool_free(dm->decode_pool);
+    list_free_elems(&dm->demod_batch, NULL);
+    list_free_elems(&dm->demod_groups, (list_elem_free_fn)demod_group_free);
     list_free_elems(&dm->r_devs, free);
+    data_convert_free(dm->data_convert);
     list_free_elems(&dm->output_handler, (list_elem_free_fn)data_output_free);
 
     if(dm->pulse_detect) pulse_detect_free(dm->pulse_detect);
@@ -119,6 +148,9 @@ int dm_state_destroy(dm_state *dm){
     if (dm->am_analyze)
         am_analyze_free(dm->am_analyze);
 
+    list_free_elems(&dm->channels, (list_elem_free_fn)dm_channel_free);
+    channelizer_free(dm->channelizer);
+
     free(dm);
     return 0;
 }
@@ -159,6 +191,9 @@ int add_dumper(dm_state *dm, char const *spec, int overwrite) {
     if (dumper->format == PULSE_OOK) {
         pulse_data_print_pulse_header(dumper->file);
     }
+    if (dumper->format == PULSE_BIN) {
+        pulse_data_print_bin_header(dumper->file);
+    }
     return 0;
 }
 
@@ -203,45 +238,30 @@ int run_ook_demods(dm_state *dm) {
     if (!dm) return 0;
 
     int p_events = 0;
-
-    for (void **iter = dm->r_devs.elems; iter && *iter; ++iter) {
-        r_device *r_dev = *iter;
-        switch (r_dev->modulation) {
-        case OOK_PULSE_PCM_RZ:
-            p_events += pulse_demod_pcm(&dm->pulse_data, r_dev);
-            break;
-        case OOK_PULSE_PPM:
-            p_events += pulse_demod_ppm(&dm->pulse_data, r_dev);
-            break;
-        case OOK_PULSE_PWM:
-            p_events += pulse_demod_pwm(&dm->pulse_data, r_dev);
-            break;
-        case OOK_PULSE_MANCHESTER_ZEROBIT:
-            p_events += pulse_demod_manchester_zerobit(&dm->pulse_data, r_dev);
-            break;
-        case OOK_PULSE_PIWM_RAW:
-            p_events += pulse_demod_piwm_raw(&dm->pulse_data, r_dev);
-            break;
-        case OOK_PULSE_PIWM_DC:
-            p_events += pulse_demod_piwm_dc(&dm->pulse_data, r_dev);
-            break;
-        case OOK_PULSE_DMC:
-            p_events += pulse_demod_dmc(&dm->pulse_data, r_dev);
-            break;
-        case OOK_PULSE_PWM_OSV1:
-            p_events += pulse_demod_osv1(&dm->pulse_data, r_dev);
-            break;
-            // FSK decoders
-        case FSK_PULSE_PCM:
-        case FSK_PULSE_PWM:
-            break;
-        case FSK_PULSE_MANCHESTER_ZEROBIT:
-            p_events += pulse_demod_manchester_zerobit(&dm->pulse_data, r_dev);
-            break;
-        default:
-            rtl433_fprintf(stderr, "Unknown modulation %d in protocol!\n", r_dev->modulation);
+    pulse_summary_t summary;
+    pulse_summary(&dm->pulse_data, &summary);
+
+    // decode on the worker pool, serially if debug output is requested to keep it readable
+    int use_pool = dm->decode_pool != NULL;
+    list_clear(&dm->demod_batch, NULL);
+
+    for (void **iter = dm->demod_groups.elems; iter && *iter; ++iter) {
+        demod_group_t *group = *iter;
+        r_device *r_dev      = demod_group_device(group);
+        if (r_dev->modulation == FSK_PULSE_PCM || r_dev->modulation == FSK_PULSE_PWM)
+            continue; // FSK only decoders
+        if (!dm->rtl->cfg->exhaustive_demod && !demod_group_accepts(group, &summary)) {
+            dm->demod_skipped += group->members.len;
+            continue;
         }
+        dm->demod_runs += group->members.len;
+        if (use_pool)
+            list_push(&dm->demod_batch, group);
+        else
+            p_events += pulse_demod_device(&dm->pulse_data, r_dev);
     }
+    if (use_pool)
+        p_events += decode_pool_run(dm->decode_pool, (demod_group_t **)dm->demod_batch.elems, dm->demod_batch.len, &dm->pulse_data, dm->rtl->cfg->verbosity);
 
     if (!p_events && dm->rtl->cfg->report_unknown && dm->pulse_data.num_pulses > 10) { // unknown OOK signal (no matching device demodulator) - pass to GUI as unknown signal if it has a significant length
         extdata_t ext = {
@@ -271,32 +291,30 @@ int run_fsk_demods(dm_state *dm) {
     if (!dm) return 0;
 
     int p_events = 0;
-    for (void **iter = dm->r_devs.elems; iter && *iter; ++iter) {
-        r_device *r_dev = *iter;
-        switch (r_dev->modulation) {
-            // OOK decoders
-            case OOK_PULSE_PCM_RZ:
-            case OOK_PULSE_PPM:
-            case OOK_PULSE_PWM:
-            case OOK_PULSE_MANCHESTER_ZEROBIT:
-            case OOK_PULSE_PIWM_RAW:
-            case OOK_PULSE_PIWM_DC:
-            case OOK_PULSE_DMC:
-            case OOK_PULSE_PWM_OSV1:
-                break;
-            case FSK_PULSE_PCM:
-                p_events += pulse_demod_pcm(&dm->fsk_pulse_data, r_dev);
-                break;
-            case FSK_PULSE_PWM:
-                p_events += pulse_demod_pwm(&dm->fsk_pulse_data, r_dev);
-                break;
-            case FSK_PULSE_MANCHESTER_ZEROBIT:
-                p_events += pulse_demod_manchester_zerobit(&dm->fsk_pulse_data, r_dev);
-                break;
-            default:
-                rtl433_fprintf(stderr, "Unknown modulation %d in protocol!\n", r_dev->modulation);
+    pulse_summary_t summary;
+    pulse_summary(&dm->fsk_pulse_data, &summary);
+
+    // decode on the worker pool, serially if debug output is requested to keep it readable
+    int use_pool = dm->decode_pool != NULL;
+    list_clear(&dm->demod_batch, NULL);
+
+    for (void **iter = dm->demod_groups.elems; iter && *iter; ++iter) {
+        demod_group_t *group = *iter;
+        r_device *r_dev      = demod_group_device(group);
+        if (r_dev->modulation < FSK_DEMOD_MIN_VAL)
+            continue; // OOK decoders
+        if (!dm->rtl->cfg->exhaustive_demod && !demod_group_accepts(group, &summary)) {
+            dm->demod_skipped += group->members.len;
+            continue;
         }
-    } // for demodulators
+        dm->demod_runs += group->members.len;
+        if (use_pool)
+            list_push(&dm->demod_batch, group);
+        else
+            p_events += pulse_demod_device(&dm->fsk_pulse_data, r_dev);
+    }
+    if (use_pool)
+        p_events += decode_pool_run(dm->decode_pool, (demod_group_t **)dm->demod_batch.elems, dm->demod_batch.len, &dm->fsk_pulse_data, dm->rtl->cfg->verbosity);
 
     if (!p_events && dm->rtl->cfg->report_unknown && dm->fsk_pulse_data.num_pulses > 10) { // unknown FSK signal (no matching device demodulator) - pass to GUI as unknown signal if it has a significant length
         extdata_t ext = {
@@ -358,13 +376,220 @@ int Perform_FM_Demodulation(dm_state *dm, unsigned char *iq_buf, unsigned long n
     return 0;
 }
 
+/// Samples per front end tile, IQ input plus AM and FM output of one tile stay in L1.
+#define FRONTEND_TILE_LEN 1024
+
+/// Single pass AM and FM demodulation, each tile of IQ samples is read once while hot in cache.
+/// Filter and FM state carry across tiles the same as across calls.
+static void demodulate_tiles(dm_state *dm, void const *iq_buf, int sample_size, unsigned long n_samples, filter_state_t *lowpass_filter_state, demodfm_state_t *demod_FM_state)
+{
+    uint16_t temp[FRONTEND_TILE_LEN];
+    for (unsigned long t = 0; t < n_samples; t += FRONTEND_TILE_LEN) {
+        uint32_t len = n_samples - t < FRONTEND_TILE_LEN ? n_samples - t : FRONTEND_TILE_LEN;
+        if (sample_size == 1) { // CU8
+            uint8_t const *iq_tile = &((uint8_t const *)iq_buf)[2 * t];
+            envelope_detect(iq_tile, temp, len);
+            baseband_low_pass_filter(temp, &dm->am_buf[t], len, lowpass_filter_state);
+            if (dm->enable_FM_demod && !dm->lazy_FM_demod)
+                baseband_demod_FM(iq_tile, &dm->buf.fm[t], len, demod_FM_state);
+        }
+        else { // CS16
+            int16_t const *iq_tile = &((int16_t const *)iq_buf)[2 * t];
+            magnitude_est_cs16(iq_tile, temp, len);
+            baseband_low_pass_filter(temp, &dm->am_buf[t], len, lowpass_filter_state);
+            if (dm->enable_FM_demod && !dm->lazy_FM_demod)
+                baseband_demod_FM_cs16(iq_tile, &dm->buf.fm[t], len, demod_FM_state);
+        }
+    }
+}
+
+int Perform_Demodulation(dm_state *dm, unsigned char *iq_buf, unsigned long n_samples) {
+    if (!dm) return RTL_433_ERROR_INVALID_PARAM;
+
+    demodulate_tiles(dm, iq_buf, dm->sample_size, n_samples, &dm->lowpass_filter_state, &dm->demod_FM_state);
+    return 0;
+}
+
+int Perform_Channel_Demodulation(dm_state *dm, dm_channel_t *chan, unsigned long n_samples) {
+    if (!dm || !chan) return RTL_433_ERROR_INVALID_PARAM;
+
+    // channels are always CS16
+    demodulate_tiles(dm, chan->iq_buf, 2, n_samples, &chan->lowpass_filter_state, &chan->demod_FM_state);
+    return 0;
+}
+
+/// Samples demodulated ahead of a requested span to settle the FM low pass filter.
+#define FM_LOOKBACK 32
+
+static void fm_lazy_run(fm_lazy_t *lazy, unsigned long start, unsigned long end) {
+    if (lazy->sample_size == 1) // CU8
+        baseband_demod_FM(&((uint8_t const *)lazy->iq_buf)[2 * start], &lazy->fm_buf[start], end - start, lazy->state);
+    else // CS16
+        baseband_demod_FM_cs16(&((int16_t const *)lazy->iq_buf)[2 * start], &lazy->fm_buf[start], end - start, lazy->state);
+}
+
+void fm_lazy_begin(fm_lazy_t *lazy, void const *iq_buf, int sample_size, unsigned long n_samples, int16_t *fm_buf, demodfm_state_t *state) {
+    lazy->iq_buf      = iq_buf;
+    lazy->sample_size = sample_size;
+    lazy->n_samples   = n_samples;
+    lazy->pos         = 0;
+    lazy->fm_buf      = fm_buf;
+    lazy->state       = state;
+}
+
+void fm_lazy_demod(void *ctx, int start, int end) {
+    fm_lazy_t *lazy = ctx;
+    if ((unsigned long)end <= lazy->pos)
+        return;
+
+    unsigned long from = lazy->pos;
+    if ((unsigned long)start > from + FM_LOOKBACK) {
+        // skip ahead, the discriminator needs the exact previous sample, the filter settles over the look-back
+        from = start - FM_LOOKBACK;
+        if (lazy->sample_size == 1) { // CU8
+            lazy->state->br = ((uint8_t const *)lazy->iq_buf)[2 * from - 2] - 128;
+            lazy->state->bi = ((uint8_t const *)lazy->iq_buf)[2 * from - 1] - 128;
+        }
+        else { // CS16
+            lazy->state->br = ((int16_t const *)lazy->iq_buf)[2 * from - 2];
+            lazy->state->bi = ((int16_t const *)lazy->iq_buf)[2 * from - 1];
+        }
+    }
+    fm_lazy_run(lazy, from, end);
+    lazy->pos = end;
+}
+
+void fm_lazy_end(fm_lazy_t *lazy) {
+    // always demodulate the tail, so the state carried to the next block is settled
+    unsigned long n = lazy->n_samples;
+    if (n >= FM_LOOKBACK)
+        fm_lazy_demod(lazy, n - FM_LOOKBACK, n);
+    else
+        fm_lazy_demod(lazy, 0, n);
+}
+
+static void dm_channel_free(dm_channel_t *chan) {
+    if (chan->pulse_detect) pulse_detect_free(chan->pulse_detect);
+    free(chan->iq_buf);
+    free(chan);
+}
+
+int dm_channels_init(dm_state *dm, uint32_t *center_frequency) {
+    if (!dm || !center_frequency) return RTL_433_ERROR_INVALID_PARAM;
+
+    r_cfg_t *cfg = dm->rtl->cfg;
+    int32_t offsets[MAX_FREQS];
+
+    // tune to the middle of the lowest and highest frequency
+    uint32_t f_min = cfg->frequency[0];
+    uint32_t f_max = cfg->frequency[0];
+    for (int i = 1; i < cfg->frequencies; i++) {
+        if (cfg->frequency[i] < f_min) f_min = cfg->frequency[i];
+        if (cfg->frequency[i] > f_max) f_max = cfg->frequency[i];
+    }
+    *center_frequency = f_min + (f_max - f_min) / 2;
+    for (int i = 0; i < cfg->frequencies; i++) {
+        offsets[i] = (int32_t)(cfg->frequency[i] - *center_frequency);
+    }
+
+    dm->channelizer = channelizer_create(cfg->samp_rate, offsets, cfg->frequencies, cfg->channel_decimation);
+    if (!dm->channelizer) {
+        rtl433_fprintf(stderr, "Frequencies span %u Hz, too wide for a sample rate of %u (or out of memory).\n", f_max - f_min, cfg->samp_rate);
+        return RTL_433_ERROR_INVALID_PARAM;
+    }
+    unsigned decimation = channelizer_decimation(dm->channelizer);
+
+    for (int i = 0; i < cfg->frequencies; i++) {
+        dm_channel_t *chan = calloc(1, sizeof(*chan));
+        if (!chan) {
+            rtl433_fprintf(stderr, "dm_channels_init: out of memory.\n");
+            return RTL_433_ERROR_OUTOFMEM;
+        }
+        list_push(&dm->channels, chan);
+        chan->frequency    = cfg->frequency[i];
+        chan->iq_buf       = malloc(2 * (MAXIMAL_BUF_LENGTH / decimation + 1) * sizeof(*chan->iq_buf));
+        chan->pulse_detect = pulse_detect_create();
+        if (!chan->iq_buf || !chan->pulse_detect) {
+            rtl433_fprintf(stderr, "dm_channels_init: out of memory.\n");
+            return RTL_433_ERROR_OUTOFMEM;
+        }
+    }
+
+    if (cfg->verbosity)
+        rtl433_fprintf(stderr, "Channelizer: %d channels at %u Hz around %u Hz.\n", cfg->frequencies, cfg->samp_rate / decimation, *center_frequency);
+    return 0;
+}
+
+/// Bytes of a mapped input to read before the pages behind are released.
+#define INPUT_MAP_RELEASE (64 * 1024 * 1024)
+
+/// Map a regular file for reading, returns NULL for pipes, empty files or if mapping fails.
+static uint8_t *map_input_file(FILE *file, size_t *len)
+{
+#ifndef _WIN32
+    struct stat st;
+    if (fstat(fileno(file), &st) || !S_ISREG(st.st_mode) || st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX)
+        return NULL;
+    // private and writable, pages are only copied if the pipeline should ever write to a block
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *len = (size_t)st.st_size;
+    return map;
+#else
+    return NULL;
+#endif
+}
+
+static void unmap_input_file(uint8_t *map, size_t len)
+{
+#ifndef _WIN32
+    munmap(map, len);
+#endif
+}
+
+/// Release the pages of a mapped input below @p pos, they won't be read again.
+static void release_input_file(uint8_t *map, size_t pos, size_t *released)
+{
+#ifndef _WIN32
+    if (pos < INPUT_MAP_RELEASE)
+        return;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t upto = (pos - INPUT_MAP_RELEASE) / page * page;
+    if (upto <= *released)
+        return;
+    madvise(map + *released, upto - *released, MADV_DONTNEED);
+    *released = upto;
+#endif
+}
+
+/// Clamp float to [-1,1] and scale to Q0.15.
+static void convert_cf32_cs16(float const *src, int16_t *dst, unsigned long n)
+{
+    for (unsigned long i = 0; i < n; i++) {
+        int s_tmp = src[i] * INT16_MAX;
+        if (s_tmp < -INT16_MAX)
+            s_tmp = -INT16_MAX;
+        else if (s_tmp > INT16_MAX)
+            s_tmp = INT16_MAX;
+        dst[i] = s_tmp;
+    }
+}
+
 int ReadFromFiles(dm_state *dm) {
     if (!dm) return RTL_433_ERROR_INVALID_PARAM;
 
     FILE *in_file;
 
-    unsigned char *test_mode_buf = malloc(DEFAULT_BUF_LENGTH * sizeof(unsigned char));
-    float *test_mode_float_buf = malloc(DEFAULT_BUF_LENGTH / sizeof(int16_t) * sizeof(float));
+    // blocks are as large as the SDR would deliver them
+    uint32_t block_size = dm->rtl->cfg->out_block_size;
+    if (block_size < MINIMAL_BUF_LENGTH || block_size > MAXIMAL_BUF_LENGTH)
+        block_size = DEFAULT_BUF_LENGTH;
+    block_size &= ~7u; // whole CF32 samples
+
+    unsigned char *test_mode_buf = malloc(block_size * sizeof(unsigned char));
+    float *test_mode_float_buf = malloc(block_size / sizeof(int16_t) * sizeof(float));
     if (!test_mode_buf || !test_mode_float_buf)
     {
         rtl433_fprintf(stderr, "Couldn't allocate read buffers!\n");
@@ -422,44 +647,90 @@ int ReadFromFiles(dm_state *dm) {
 
             continue;
         }
+        if (dm->load_info.format == PULSE_BIN) {
+            int type;
+            while (!dm->rtl->do_exit && (type = pulse_data_load_bin(in_file, &dm->pulse_data, NULL)) > 0) {
+                // the pulse widths are in samples of the recorded rate
+                if (dm->pulse_data.sample_rate != dm->rtl->cfg->samp_rate) {
+                    dm->rtl->cfg->samp_rate = dm->pulse_data.sample_rate;
+                    update_protocols(dm, dm->rtl->cfg);
+                }
+                if (type == PULSE_DATA_FSK) {
+                    dm->fsk_pulse_data = dm->pulse_data;
+                    run_fsk_demods(dm);
+                }
+                else {
+                    run_ook_demods(dm);
+                }
+            }
+
+            if (in_file != stdin)
+                fclose(in_file = stdin);
+
+            continue;
+        }
+
+        // default case for file-inputs, regular files are read from a mapping
+        size_t map_len      = 0;
+        size_t map_pos      = 0;
+        size_t map_released = 0;
+        uint8_t *map        = in_file != stdin ? map_input_file(in_file, &map_len) : NULL;
+        if (map && dm->rtl->cfg->verbosity > 1)
+            rtl433_fprintf(stderr, "Input file mapped, %zu bytes\n", map_len);
 
-        // default case for file-inputs
         int n_blocks = 0;
+        uint64_t pos = 0; // bytes passed to sdr_callback()
         unsigned long n_read;
         do {
+            unsigned char *block = test_mode_buf;
             if (dm->load_info.format == CF32_IQ) {
-                n_read = fread(test_mode_float_buf, sizeof(float), DEFAULT_BUF_LENGTH / 2, in_file);
-                // clamp float to [-1,1] and scale to Q0.15
-                for(unsigned long n = 0; n < n_read; n++) {
-                    int s_tmp = test_mode_float_buf[n] * INT16_MAX;
-                    if (s_tmp < -INT16_MAX)
-                        s_tmp = -INT16_MAX;
-                    else if (s_tmp > INT16_MAX)
-                        s_tmp = INT16_MAX;
-                    ((int16_t *)test_mode_buf)[n] = s_tmp;
+                float const *src = test_mode_float_buf;
+                if (map) {
+                    n_read = (map_len - map_pos) / sizeof(float);
+                    if (n_read > block_size / 2)
+                        n_read = block_size / 2;
+                    src = (float const *)(map + map_pos);
+                    map_pos += n_read * sizeof(float);
                 }
-                    n_read *= 2; // convert to byte count
-            } else {
-                n_read = fread(test_mode_buf, 1, DEFAULT_BUF_LENGTH, in_file);
+                else {
+                    n_read = fread(test_mode_float_buf, sizeof(float), block_size / 2, in_file);
+                }
+                convert_cf32_cs16(src, (int16_t *)test_mode_buf, n_read);
+                n_read *= 2; // convert to byte count
+            }
+            else if (map) {
+                // no copy, the block is passed right from the mapping
+                n_read = map_len - map_pos < block_size ? (unsigned long)(map_len - map_pos) : block_size;
+                block  = map + map_pos;
+                map_pos += n_read;
+            }
+            else {
+                n_read = fread(test_mode_buf, 1, block_size, in_file);
             }
             if (n_read == 0) break;  // sdr_callback() will Segmentation Fault with len=0
-            dm->sample_file_pos = ((float)n_blocks * DEFAULT_BUF_LENGTH + n_read) / dm->rtl->cfg->samp_rate / 2 / dm->sample_size;
-            n_blocks++; // this assumes n_read == DEFAULT_BUF_LENGTH
-            sdr_callback(test_mode_buf, n_read, dm->rtl);
+            pos += n_read;
+            dm->sample_file_pos = (double)pos / dm->rtl->cfg->samp_rate / 2 / dm->sample_size;
+            n_blocks++;
+            sdr_callback(block, n_read, dm->rtl);
+            if (map)
+                release_input_file(map, map_pos, &map_released);
         } while (n_read != 0 && !dm->rtl->do_exit);
 
+        if (map)
+            unmap_input_file(map, map_len);
+
         // Call a last time with cleared samples to ensure EOP detection
         if (dm->sample_size == 1) { // CU8
-            memset(test_mode_buf, 128, DEFAULT_BUF_LENGTH); // 128 is 0 in unsigned data
+            memset(test_mode_buf, 128, block_size); // 128 is 0 in unsigned data
             // or is 127.5 a better 0 in cu8 data?
-            //for (unsigned long n = 0; n < DEFAULT_BUF_LENGTH/2; n++)
+            //for (unsigned long n = 0; n < block_size/2; n++)
             //    ((uint16_t *)test_mode_buf)[n] = 0x807f;
         }
         else { // CF32, CS16
-            memset(test_mode_buf, 0, DEFAULT_BUF_LENGTH);
+            memset(test_mode_buf, 0, block_size);
         }
-        dm->sample_file_pos = ((float)n_blocks + 1) * DEFAULT_BUF_LENGTH / dm->rtl->cfg->samp_rate / 2 / dm->sample_size;
-        sdr_callback(test_mode_buf, DEFAULT_BUF_LENGTH, dm->rtl);
+        dm->sample_file_pos = (double)(pos + block_size) / dm->rtl->cfg->samp_rate / 2 / dm->sample_size;
+        sdr_callback(test_mode_buf, block_size, dm->rtl);
 
         //Always classify a signal at the end of the file
         if (dm->am_analyze)
@@ -484,7 +755,8 @@ int dumpSamplesToFile(dm_state *dm, unsigned char *iq_buf, unsigned long n_sampl
         file_info_t const *dumper = *iter;
         if (!dumper->file
                 || dumper->format == VCD_LOGIC
-                || dumper->format == PULSE_OOK)
+                || dumper->format == PULSE_OOK
+                || dumper->format == PULSE_BIN)
             continue;
 
         uint8_t* out_buf = iq_buf;  // Default is to dump IQ samples
@@ -608,173 +880,9 @@ static void data_acquired_handler(r_device *r_dev, data_t *data, extdata_t *ext)
 
     if (!unknown_dev) {
 
-        // replace textual battery key with numerical battery key
-        if (rtl->cfg->new_model_keys) {
-            for (data_t *d = data; d; d = d->next) {
-                if ((d->type == DATA_STRING) && !strcmp(d->key, "battery")) {
-                    free(d->key);
-                    d->key = strdup("battery_ok");
-                    int ok = d->value && !strcmp(d->value, "OK");
-                    free(d->value);
-                    d->type = DATA_INT;
-                    d->value = malloc(sizeof(int));
-                    *(int *)d->value = ok;
-                    break;
-                }
-            }
-        }
-
-        if (rtl->cfg->conversion_mode == CONVERT_SI) {
-            for (data_t *d = data; d; d = d->next) {
-                // Convert double type fields ending in _F to _C
-                if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_F")) {
-                    *(double*)d->value = fahrenheit2celsius(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_F", "_C");
-                    free(d->key);
-                    d->key = new_label;
-                    char *pos;
-                    if (d->format && (pos = strrchr(d->format, 'F'))) {
-                        *pos = 'C';
-                    }
-                }
-                // Convert double type fields ending in _mph to _kph
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_mph")) {
-                    *(double*)d->value = mph2kmph(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_mph", "_kph");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "mi/h", "km/h");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _mi_h to _km_h
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_mi_h")) {
-                    *(double*)d->value = mph2kmph(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_mi_h", "_km_h");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "mi/h", "km/h");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _in to _mm
-                else if ((d->type == DATA_DOUBLE) &&
-                         (str_endswith(d->key, "_in") || str_endswith(d->key, "_inch"))) {
-                    *(double*)d->value = inch2mm(*(double*)d->value);
-                    char *new_label = str_replace(str_replace(d->key, "_inch", "_in"), "_in", "_mm");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "in", "mm");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _in_h to _mm_h
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_in_h")) {
-                    *(double*)d->value = inch2mm(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_in_h", "_mm_h");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "in/h", "mm/h");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _inHg to _hPa
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_inHg")) {
-                    *(double*)d->value = inhg2hpa(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_inHg", "_hPa");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "inHg", "hPa");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _PSI to _kPa
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_PSI")) {
-                    *(double*)d->value = psi2kpa(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_PSI", "_kPa");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "PSI", "kPa");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-            }
-        }
-        if (rtl->cfg->conversion_mode == CONVERT_CUSTOMARY) {
-            for (data_t *d = data; d; d = d->next) {
-                // Convert double type fields ending in _C to _F
-                if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_C")) {
-                    *(double*)d->value = celsius2fahrenheit(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_C", "_F");
-                    free(d->key);
-                    d->key = new_label;
-                    char *pos;
-                    if (d->format && (pos = strrchr(d->format, 'C'))) {
-                        *pos = 'F';
-                    }
-                }
-                // Convert double type fields ending in _kph to _mph
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_kph")) {
-                    *(double*)d->value = kmph2mph(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_kph", "_mph");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "km/h", "mi/h");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _km_h to _mi_h
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_km_h")) {
-                    *(double*)d->value = kmph2mph(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_km_h", "_mi_h");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "km/h", "mi/h");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _mm to _inch
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_mm")) {
-                    *(double*)d->value = mm2inch(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_mm", "_in");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "mm", "in");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _mm_h to _in_h
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_mm_h")) {
-                    *(double*)d->value = mm2inch(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_mm_h", "_in_h");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "mm/h", "in/h");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _hPa to _inHg
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_hPa")) {
-                    *(double*)d->value = hpa2inhg(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_hPa", "_inHg");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "hPa", "inHg");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-                // Convert double type fields ending in _kPa to _PSI
-                else if ((d->type == DATA_DOUBLE) && str_endswith(d->key, "_kPa")) {
-                    *(double*)d->value = kpa2psi(*(double*)d->value);
-                    char *new_label = str_replace(d->key, "_kPa", "_PSI");
-                    free(d->key);
-                    d->key = new_label;
-                    char *new_format_label = str_replace(d->format, "kPa", "PSI");
-                    free(d->format);
-                    d->format = new_format_label;
-                }
-            }
-        }
+        // replace the battery key and convert units as requested, see data_convert_add_fields()
+        if (rtl->demod->data_convert)
+            data_convert_apply(rtl->demod->data_convert, data);
 
         // prepend "description" if requested
         if (rtl->cfg->report_description) {
@@ -843,12 +951,14 @@ static void data_acquired_handler(r_device *r_dev, data_t *data, extdata_t *ext)
             data_free(data);
             return;
         }
-        // alloc a new, extended base object for the linked list and copy the old base object (incl. next pointer)
-        data_ext_t *extdata = (data_ext_t*)malloc(sizeof(data_ext_t)); 
-        extdata->data = *data;
+        // move the base object of the linked list into a new, extended one (incl. next pointer)
+        data_ext_t *extdata = (data_ext_t*)data_replace_head(data, sizeof(data_ext_t));
+        if (!extdata) {
+            rtl433_fprintf(stderr, "data_acquired_handler: out of memory.\n");
+            data_free(data);
+            return;
+        }
         extdata->ext = *ext;
-        // free old base object and replace with new one
-        free(data); // note: we intentionally do not call data_free in order to keep the rest of the list
         data = &extdata->data;
     }
 
@@ -893,6 +1003,33 @@ void update_protocols(dm_state *dm, r_cfg_t *cfg)
         r_device *r_dev = *iter;
         update_protocol(cfg, r_dev);
     }
+
+    // the pulse limits changed, regroup
+    list_clear(&dm->demod_groups, (list_elem_free_fn)demod_group_free);
+    for (void **iter = dm->r_devs.elems; iter && *iter; ++iter) {
+        add_demod_group(dm, *iter);
+    }
+}
+
+/// Add a decoder to the group with identical demodulation parameters, or start a new group.
+static int add_demod_group(dm_state *dm, r_device *r_dev)
+{
+    for (void **iter = dm->demod_groups.elems; iter && *iter; ++iter) {
+        demod_group_t *group = *iter;
+        if (demod_group_matches(group, r_dev)) {
+            list_push(&group->members, r_dev);
+            return 1;
+        }
+    }
+
+    demod_group_t *group = calloc(1, sizeof(*group));
+    if (!group) {
+        rtl433_fprintf(stderr, "add_demod_group: failed to allocate a demodulation group!\n");
+        return 0;
+    }
+    demod_group_init(group, r_dev);
+    list_push(&dm->demod_groups, group);
+    return 1;
 }
 
 static int register_protocol(dm_state *dm, r_device *r_dev, char *arg)
@@ -917,7 +1054,13 @@ static int register_protocol(dm_state *dm, r_device *r_dev, char *arg)
 //  p->output_ctx = cfg;
     p->ctx = dm->rtl;
 
+    // keys the decoder does not list are resolved on first use
+    if (dm->data_convert)
+        data_convert_add_fields(dm->data_convert, (char const *const *)p->fields);
+
     list_push(&dm->r_devs, p);
+    if (!add_demod_group(dm, p))
+        return 0;
 
     if (dm->rtl->cfg->verbosity) {
         rtl433_fprintf(stderr, "Registering protocol [%d] \"%s\"\n", r_dev->protocol_num, r_dev->name);
@@ -956,28 +1099,44 @@ static char const **determine_csv_fields(dm_state *dm, char const **well_known,
     return (char const **)field_list.elems;
 }
 
-static FILE *fopen_output(char *param, int allow_overwrite) {
+static FILE *fopen_output(char *param, int allow_overwrite, int binary) {
     if (!param || !*param || *param == '-') {
+#ifdef _WIN32
+        if (binary)
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
         return stdout;
     }
 
     FILE *file = NULL;
     if (access(param, F_OK) != 0 || allow_overwrite) {
-        file = fopen(param, "a");
+        file = fopen(param, binary ? "ab" : "a");
         if (!file) rtl433_fprintf(stderr, "rtl_433: failed to open output file\n");
     }
     return file;
 }
 
+/// Attach the configured flush policy to a file output, unless it flushes every record anyway.
+static data_output_t *add_file_writer(dm_state *dm, data_output_t *output)
+{
+    r_cfg_t *cfg = dm->rtl->cfg;
+    if (!output || (cfg->output_flush_records == 1 && !cfg->output_fsync))
+        return output;
+    output->writer = file_writer_create(output->file, cfg->output_flush_records, cfg->output_flush_ms, cfg->output_fsync);
+    if (!output->writer)
+        rtl433_fprintf(stderr, "add_file_writer: could not buffer the output, flushing every record.\n");
+    return output;
+}
+
 int add_json_output(dm_state *dm, char *param, int allow_overwrite) {
     if (!dm) {
         rtl433_fprintf(stderr, "add_json_output: missing context.\n");
         return RTL_433_ERROR_INVALID_PARAM;
     }
 
-    FILE *file = fopen_output(param, allow_overwrite);
+    FILE *file = fopen_output(param, allow_overwrite, 0);
     if (file) {
-        list_push(&dm->output_handler, data_output_json_create(file));
+        list_push(&dm->output_handler, add_file_writer(dm, data_output_json_create(file)));
     }
     else {
         rtl433_fprintf(stderr, "add_json_output: failed to open output JSON file %s", param);
@@ -992,9 +1151,9 @@ int add_csv_output(dm_state *dm, char *param, int allow_overwrite) {
         return RTL_433_ERROR_INVALID_PARAM;
     }
 
-    FILE *file = fopen_output(param, allow_overwrite);
+    FILE *file = fopen_output(param, allow_overwrite, 0);
     if (file) {
-        list_push(&dm->output_handler, data_output_csv_create(file));
+        list_push(&dm->output_handler, add_file_writer(dm, data_output_csv_create(file)));
     }
     else {
         rtl433_fprintf(stderr, "add_csv_output: failed to open output CSV file %s", param);
@@ -1015,6 +1174,21 @@ void start_outputs(dm_state *dm, char const **well_known) {
         data_output_start(dm->output_handler.elems[i], output_fields, num_output_fields);
     }
     free(output_fields);
+
+    // move each started output to its own thread
+    if (dm->rtl->cfg->output_queue_depth) {
+        for (size_t i = 0; i < dm->output_handler.len; ++i) {
+            data_output_t *output = dm->output_handler.elems[i];
+            if (output && output->ext_callback)
+                continue; // external callbacks get the raw bitbuffer and pulses, print them directly
+            data_output_t *queued = data_output_queue_create(dm->output_handler.elems[i],
+                    dm->rtl->cfg->output_queue_depth, dm->rtl->cfg->output_queue_policy);
+            if (queued)
+                dm->output_handler.elems[i] = queued;
+            else if (dm->output_handler.elems[i])
+                rtl433_fprintf(stderr, "start_outputs: could not queue output %zu, printing it directly.\n", i);
+        }
+    }
 }
 
 int add_kv_output(dm_state *dm, char *param, int allow_overwrite) {
@@ -1023,9 +1197,9 @@ int add_kv_output(dm_state *dm, char *param, int allow_overwrite) {
         return RTL_433_ERROR_INVALID_PARAM;
     }
 
-    FILE *file = fopen_output(param, (dm->rtl->cfg->overwrite_modes & OVR_SUBJ_DEC_KV));
+    FILE *file = fopen_output(param, (dm->rtl->cfg->overwrite_modes & OVR_SUBJ_DEC_KV), 0);
     if (file) {
-        list_push(&dm->output_handler, data_output_kv_create(file));
+        list_push(&dm->output_handler, add_file_writer(dm, data_output_kv_create(file)));
     }
     else {
         rtl433_fprintf(stderr, "add_kv_output: failed to open output TXT file %s", param);
@@ -1034,6 +1208,23 @@ int add_kv_output(dm_state *dm, char *param, int allow_overwrite) {
     return 0;
 }
 
+int add_cbor_output(dm_state *dm, char *param, int allow_overwrite) {
+    if (!dm) {
+        rtl433_fprintf(stderr, "add_cbor_output: missing context.\n");
+        return RTL_433_ERROR_INVALID_PARAM;
+    }
+
+    FILE *file = fopen_output(param, allow_overwrite, 1);
+    if (file) {
+        list_push(&dm->output_handler, add_file_writer(dm, data_output_cbor_create(file)));
+    }
+    else {
+        rtl433_fprintf(stderr, "add_cbor_output: failed to open output CBOR file %s", param);
+    }
+
+    return 0;
+}
+
 int add_mqtt_output(dm_state *dm, char *host, char *port, char *opts)
 {
     if (!dm) {
@@ -1056,7 +1247,8 @@ int add_syslog_output(dm_state *dm, char *host, char *port) {
     }
 
     rtl433_fprintf(stderr, "Syslog UDP datagrams to %s port %s\n", host, port);
-    list_push(&dm->output_handler, data_output_syslog_create(host, port));
+    r_cfg_t *cfg = dm->rtl->cfg;
+    list_push(&dm->output_handler, data_output_syslog_create(host, port, cfg->output_udp_batch, cfg->output_udp_flush_ms, cfg->output_udp_mtu));
 
     return 0;
 }
@@ -77,8 +77,8 @@ static const uint8_t preamble_pattern[4] = {0xAA, 0xAA, 0xD2, 0x01};
 
 #define IKEA_SPARSNAS_ID_KEY_SUB 0x5D38E8CB
 
-static uint16_t ikea_sparsnas_pulses_per_kwh = 1000;
-static uint32_t ikea_sparsnas_sensor_id = 0;
+static uint16_t const ikea_sparsnas_pulses_per_kwh = 1000;
+static uint32_t const ikea_sparsnas_sensor_id = 0; // 0 to brute force it from the first package
 
 static uint32_t ikea_sparsnas_brute_force_encryption(uint8_t buffer[18]){
     
@@ -128,6 +128,7 @@ static uint32_t ikea_sparsnas_brute_force_encryption(uint8_t buffer[18]){
 
 static int ikea_sparsnas_callback(r_device *decoder, bitbuffer_t *bitbuffer, extdata_t *ext)
 {
+    uint32_t *sensor_id = decoder->decode_ctx; // found once per decoder instance, not shared between threads
 
     if ((bitbuffer->bits_per_row[0] < IKEA_SPARSNAS_MESSAGE_BITLEN) || (bitbuffer->bits_per_row[0] > IKEA_SPARSNAS_MESSAGE_BITLEN_MAX)) {
         if (decoder->verbose > 1) {
@@ -168,14 +169,14 @@ static int ikea_sparsnas_callback(r_device *decoder, bitbuffer_t *bitbuffer, ext
     }
 
     //Decryption
-    if (!ikea_sparsnas_sensor_id){
+    if (!*sensor_id){
         if (decoder->verbose > 1){
             rtl433_fprintf(stderr, "IKEA Sparsnäs: No sensor ID configured. Brute forcing encryption.\n");
         }
-        ikea_sparsnas_sensor_id = ikea_sparsnas_brute_force_encryption(buffer);
+        *sensor_id = ikea_sparsnas_brute_force_encryption(buffer);
         if (decoder->verbose > 1){
-            if (ikea_sparsnas_sensor_id){
-                rtl433_fprintf(stderr, "IKEA Sparsnäs: Found valid sensor ID %06d. If reported values does not make sense, this might be incorrect.\n", ikea_sparsnas_sensor_id);
+            if (*sensor_id){
+                rtl433_fprintf(stderr, "IKEA Sparsnäs: Found valid sensor ID %06d. If reported values does not make sense, this might be incorrect.\n", *sensor_id);
             } else {
                 rtl433_fprintf(stderr, "IKEA Sparsnäs: No valid sensor ID found.\n");
             }
@@ -185,7 +186,7 @@ static int ikea_sparsnas_callback(r_device *decoder, bitbuffer_t *bitbuffer, ext
     uint8_t decrypted[18];
 
     uint8_t key[5];
-    const uint32_t sensor_id_sub = ikea_sparsnas_sensor_id - IKEA_SPARSNAS_ID_KEY_SUB;
+    const uint32_t sensor_id_sub = *sensor_id - IKEA_SPARSNAS_ID_KEY_SUB;
 
     key[0] = (uint8_t)(sensor_id_sub >> 24);
     key[1] = (uint8_t)(sensor_id_sub);
@@ -210,18 +211,18 @@ static int ikea_sparsnas_callback(r_device *decoder, bitbuffer_t *bitbuffer, ext
         rtl433_fprintf(stderr, "IKEA Sparsnäs: Received sensor id: %d\n", rcv_sensor_id);
     }
     
-    if (rcv_sensor_id != ikea_sparsnas_sensor_id) {
+    if (rcv_sensor_id != *sensor_id) {
         if (decoder->verbose > 1){
-            rtl433_fprintf(stderr, "IKEA Sparsnäs: Malformed package, or wrong sensor id. Received sensor id (%d) not the same as sender (%d)\n", rcv_sensor_id, ikea_sparsnas_sensor_id);
+            rtl433_fprintf(stderr, "IKEA Sparsnäs: Malformed package, or wrong sensor id. Received sensor id (%d) not the same as sender (%d)\n", rcv_sensor_id, *sensor_id);
         }
     }
 
-    if ((!ikea_sparsnas_sensor_id) || (rcv_sensor_id != ikea_sparsnas_sensor_id)){
+    if ((!*sensor_id) || (rcv_sensor_id != *sensor_id)){
         
         data_t *data;
         data = data_make(
             "model",         "Model",               DATA_STRING, "IKEA Sparsnäs Energy Meter Monitor [Encrypted]",
-            "id",            "Sensor ID",           DATA_INT, ikea_sparsnas_sensor_id,
+            "id",            "Sensor ID",           DATA_INT, *sensor_id,
             "mic",           "Integrity",           DATA_STRING,    "CRC",
             NULL
         );
@@ -292,6 +293,19 @@ static char *output_fields[] = {
     NULL
 };
 
+r_device ikea_sparsnas;
+
+static r_device *ikea_sparsnas_create(char *arg)
+{
+    r_device *r_dev = create_device(&ikea_sparsnas);
+
+    uint32_t *sensor_id = malloc(sizeof (*sensor_id));
+    *sensor_id = ikea_sparsnas_sensor_id;
+    r_dev->decode_ctx = sensor_id;
+
+    return r_dev;
+}
+
 r_device ikea_sparsnas = {
     .name          = "IKEA Sparsnäs Energy Meter Monitor",
     .modulation    = FSK_PULSE_PCM,
@@ -300,6 +314,7 @@ r_device ikea_sparsnas = {
     .gap_limit     = 1000,
     .reset_limit   = 3000,
     .decode_fn     = &ikea_sparsnas_callback,
+    .create_fn     = &ikea_sparsnas_create,
     .disabled      = 1,
     .fields        = output_fields
 };
@@ -13,9 +13,6 @@
 #define RH_ASK_HEADER_LEN 4
 #define RH_ASK_MAX_MESSAGE_LEN (RH_ASK_MAX_PAYLOAD_LEN - RH_ASK_HEADER_LEN - 3)
 
-uint8_t rh_payload[RH_ASK_MAX_PAYLOAD_LEN] = {0};
-int rh_data_payload[RH_ASK_MAX_MESSAGE_LEN];
-
 // Note: all the "4to6 code" came from RadioHead source code.
 // see: http://www.airspayce.com/mikem/arduino/RadioHead/index.html
 
@@ -124,6 +121,8 @@ static int radiohead_ask_callback(r_device *decoder, bitbuffer_t *bitbuffer, ext
     data_t *data;
     uint8_t row = 0; // we are considering only first row
     int msg_len, data_len, header_to, header_from, header_id, header_flags;
+    uint8_t rh_payload[RH_ASK_MAX_PAYLOAD_LEN] = {0};
+    int rh_data_payload[RH_ASK_MAX_MESSAGE_LEN];
 
     msg_len = radiohead_ask_extract(decoder, bitbuffer, row, rh_payload);
     if (msg_len <= 0) {
@@ -161,6 +160,7 @@ static int sensible_living_callback(r_device *decoder, bitbuffer_t *bitbuffer, e
     uint8_t row = 0; // we are considering only first row
     int msg_len, house_id, sensor_type, sensor_count, alarms;
     int module_id, sensor_value, battery_voltage;
+    uint8_t rh_payload[RH_ASK_MAX_PAYLOAD_LEN] = {0};
 
     msg_len = radiohead_ask_extract(decoder, bitbuffer, row, rh_payload);
     if (msg_len <= 0) {
@@ -0,0 +1,108 @@
+/** @file
+    Buffered writes of file outputs, flushed in batches of records.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "file_writer.h"
+#include "compat_thread.h"
+#include "r_util.h"
+
+struct file_writer {
+    FILE *file;
+    char *buf;                 ///< stdio buffer of the file, NULL for stdout
+    unsigned records;
+    unsigned interval_ms;
+    int sync;
+    unsigned volatile written; ///< records written, only changed by the printing thread
+    unsigned volatile flushed; ///< value of written at the last flush
+    unsigned volatile since;   ///< time in ms of the first record after the last flush
+};
+
+file_writer_t *file_writer_create(FILE *file, unsigned records, unsigned interval_ms, int sync)
+{
+    file_writer_t *writer = calloc(1, sizeof(*writer));
+    if (!writer)
+        return NULL;
+
+    writer->file        = file;
+    writer->records     = records;
+    writer->interval_ms = interval_ms;
+    writer->sync        = sync;
+
+    // stdout might have been written to already, it keeps the stdio buffer
+    if (file != stdout) {
+        writer->buf = malloc(FILE_WRITER_BUFLEN);
+        if (writer->buf && setvbuf(file, writer->buf, _IOFBF, FILE_WRITER_BUFLEN)) {
+            free(writer->buf);
+            writer->buf = NULL;
+        }
+    }
+    return writer;
+}
+
+void file_writer_free(file_writer_t *writer)
+{
+    if (!writer)
+        return;
+    free(writer->buf);
+    free(writer);
+}
+
+static void writer_flush_upto(file_writer_t *writer, unsigned written)
+{
+    fflush(writer->file);
+    if (writer->sync) {
+#ifdef _WIN32
+        _commit(_fileno(writer->file));
+#else
+        fsync(fileno(writer->file)); // fails harmlessly on pipes and terminals
+#endif
+    }
+    compat_store_release(&writer->flushed, written);
+}
+
+void file_writer_record(file_writer_t *writer)
+{
+    unsigned flushed = compat_load_acquire(&writer->flushed);
+    unsigned written = writer->written + 1;
+    unsigned now     = writer->interval_ms ? (unsigned)(get_time_us() / 1000) : 0;
+
+    if (written - 1 == flushed)
+        compat_store_release(&writer->since, now);
+    compat_store_release(&writer->written, written);
+
+    if ((writer->records && written - flushed >= writer->records)
+            || (writer->interval_ms && now - compat_load_acquire(&writer->since) >= writer->interval_ms))
+        writer_flush_upto(writer, written);
+}
+
+void file_writer_poll(file_writer_t *writer)
+{
+    if (!writer->interval_ms)
+        return;
+
+    // a record printed meanwhile might get flushed early, which is harmless
+    unsigned written = compat_load_acquire(&writer->written);
+    if (written == compat_load_acquire(&writer->flushed))
+        return;
+    if ((unsigned)(get_time_us() / 1000) - compat_load_acquire(&writer->since) < writer->interval_ms)
+        return;
+    writer_flush_upto(writer, written);
+}
+
+void file_writer_flush(file_writer_t *writer)
+{
+    writer_flush_upto(writer, compat_load_acquire(&writer->written));
+}
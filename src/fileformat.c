@@ -43,7 +43,8 @@ int check_read_file_info(file_info_t *info)
             && info->format != CS16_IQ
             && info->format != CF32_IQ
             && info->format != S16_AM
-            && info->format != PULSE_OOK) {
+            && info->format != PULSE_OOK
+            && info->format != PULSE_BIN) {
         rtl433_fprintf(stderr, "File type not supported as input (%s).\n", info->spec);
         return 0; //exit(1);
     }
@@ -63,7 +64,8 @@ int check_write_file_info(file_info_t *info)
             && info->format != F32_I
             && info->format != F32_Q
             && info->format != U8_LOGIC
-            && info->format != VCD_LOGIC) {
+            && info->format != VCD_LOGIC
+            && info->format != PULSE_BIN) {
         rtl433_fprintf(stderr, "File type not supported as output (%s).\n", info->spec);
         return 0; //exit(1);
     }
@@ -85,6 +87,7 @@ char const *file_info_string(file_info_t *info)
     case VCD_LOGIC: return "VCD logic (text)"; break;
     case U8_LOGIC:  return "U8 logic (1ch uint8)"; break;
     case PULSE_OOK: return "OOK pulse data (text)"; break;
+    case PULSE_BIN: return "Pulse data (binary)"; break;
     default:        return "Unknown";  break;
     }
 }
@@ -116,6 +119,7 @@ static uint32_t file_type_guess_auto_format(uint32_t type)
     else if (type == F_Q) return F32_Q;
     else if (type == F_VCD) return VCD_LOGIC;
     else if (type == F_OOK) return PULSE_OOK;
+    else if (type == F_PULSE) return PULSE_BIN;
     else if (type == F_CS16) return CS16_IQ;
     else if (type == F_CF32) return CF32_IQ;
     else return type;
@@ -197,6 +201,7 @@ static void file_type(char const *filename, file_info_t *info)
             else if (len == 4 && !strncasecmp("cs32", t, 4)) file_type_set_format(&info->format, F_CS32);
             else if (len == 4 && !strncasecmp("cf32", t, 4)) file_type_set_format(&info->format, F_CF32);
             else if (len == 5 && !strncasecmp("logic", t, 5)) file_type_set_content(&info->format, F_LOGIC);
+            else if (len == 5 && !strncasecmp("pulse", t, 5)) file_type_set_content(&info->format, F_PULSE);
             else if (len == 3 && !strncasecmp("complex16u", t, 10)) file_type_set_format(&info->format, F_CU8);
             else if (len == 3 && !strncasecmp("complex16s", t, 10)) file_type_set_format(&info->format, F_CS8);
             else if (len == 4 && !strncasecmp("complex", t, 7)) file_type_set_format(&info->format, F_CF32);
@@ -231,6 +236,7 @@ Parse "[A-Za-z][0-9A-Za-z]+" as format or content specifier:
 2ch formats: "cu8", "cs8", "cs16", "cs32", "cf32"
 1ch formats: "u8", "s8", "s16", "u16", "s32", "u32", "f32"
 text formats: "vcd", "ook"
+binary formats: "pulse"
 content types: "iq", "i", "q", "am", "fm", "logic"
 
 Parses left to right, with the exception of a prefix up to the last colon ":"
@@ -0,0 +1,225 @@
+/** @file
+    Number formatting and string escaping for the data printers.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "fmt.h"
+
+// SIMD scanning can be disabled at build time with -DFMT_NO_SIMD
+#ifndef FMT_NO_SIMD
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FMT_HAVE_SSE2
+#endif
+#endif
+// the aligned loads may read around the string, which AddressSanitizer reports
+#if defined(__SANITIZE_ADDRESS__)
+#undef FMT_HAVE_SSE2
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#undef FMT_HAVE_SSE2
+#endif
+#endif
+
+#ifdef FMT_HAVE_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+static char const fmt_digit_pairs[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+static double const fmt_pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+static uint32_t const fmt_pow10_int[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+/// Decimal digits of @p value, two at a time from the end.
+static size_t fmt_uint(char *buf, uint64_t value)
+{
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = fmt_digit_pairs[pair + 1];
+        *--p = fmt_digit_pairs[pair];
+    }
+    if (value >= 10) {
+        *--p = fmt_digit_pairs[value * 2 + 1];
+        *--p = fmt_digit_pairs[value * 2];
+    }
+    else {
+        *--p = (char)('0' + value);
+    }
+    size_t len = tmp + sizeof(tmp) - p;
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    return len;
+}
+
+size_t fmt_int(char *buf, int value)
+{
+    if (value < 0) {
+        *buf = '-';
+        return 1 + fmt_uint(buf + 1, 0u - (unsigned)value);
+    }
+    return fmt_uint(buf, (unsigned)value);
+}
+
+/** Round @p mag * 10^precision to an integer like printf() does.
+
+    Below 2^40 the product is off by less than 2^-13 from the exact value,
+    a fraction clear of .5 then rounds the same way. Ties and big values
+    are left to snprintf().
+    @return 1 on success, 0 if the rounding can't be decided here
+*/
+static int fmt_round_scaled(double mag, int precision, uint64_t *digits)
+{
+    double scaled = mag * fmt_pow10[precision];
+    if (!(scaled < 1099511627776.0)) // also catches inf and NaN
+        return 0;
+    double whole = floor(scaled);
+    double frac  = scaled - whole;
+    if (frac > 0.499 && frac < 0.501)
+        return 0;
+    *digits = (uint64_t)whole + (frac > 0.5);
+    return 1;
+}
+
+/// Write the rounded digits with @p precision of them after the decimal point.
+static size_t fmt_scaled(char *buf, int negative, uint64_t digits, int precision)
+{
+    char *p = buf;
+    if (negative)
+        *p++ = '-';
+    p += fmt_uint(p, digits / fmt_pow10_int[precision]);
+    if (precision) {
+        uint64_t frac = digits % fmt_pow10_int[precision];
+        *p++ = '.';
+        for (int i = precision - 1; i >= 0; --i) {
+            p[i] = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        p += precision;
+    }
+    *p = '\0';
+    return p - buf;
+}
+
+size_t fmt_fixed(char *buf, double value, int precision)
+{
+    uint64_t digits;
+    if (precision >= 0 && precision <= 9 && fmt_round_scaled(fabs(value), precision, &digits))
+        return fmt_scaled(buf, signbit(value), digits, precision);
+    return (size_t)snprintf(buf, FMT_BUFLEN, "%.*f", precision, value);
+}
+
+size_t fmt_general(char *buf, double value)
+{
+    double mag = fabs(value);
+    if (mag == 0.0) {
+        strcpy(buf, signbit(value) ? "-0" : "0");
+        return strlen(buf);
+    }
+
+    // "%g" is "%.<5-X>f" with trailing zeros removed if the decimal exponent X is -4 to 5
+    if (mag >= 1e-4 && mag < 1e6) {
+        int exp = 5;
+        while (exp > -4 && mag < fmt_pow10[exp + 4] * 1e-4)
+            --exp;
+        int precision = 5 - exp;
+        uint64_t digits;
+        // six significant digits confirm the exponent, else rounding carried over
+        if (fmt_round_scaled(mag, precision, &digits) && digits >= 100000 && digits <= 999999) {
+            size_t len = fmt_scaled(buf, signbit(value), digits, precision);
+            if (precision) {
+                while (buf[len - 1] == '0')
+                    --len;
+                if (buf[len - 1] == '.')
+                    --len;
+                buf[len] = '\0';
+            }
+            return len;
+        }
+    }
+    return (size_t)snprintf(buf, FMT_BUFLEN, "%g", value);
+}
+
+int fmt_parse_fixed(char const *format, int *precision, char const **suffix)
+{
+    if (format[0] != '%')
+        return 0;
+    char const *p = format + 1;
+    *precision    = 6;
+    if (*p == '.') {
+        ++p;
+        if (*p < '0' || *p > '9')
+            return 0;
+        *precision = 0;
+        while (*p >= '0' && *p <= '9' && *precision <= 9)
+            *precision = *precision * 10 + (*p++ - '0');
+        if (*precision > 9)
+            return 0;
+    }
+    if (*p != 'f' || strchr(p + 1, '%'))
+        return 0;
+    *suffix = p + 1;
+    return 1;
+}
+
+#ifdef FMT_HAVE_SSE2
+static inline unsigned fmt_ctz(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return idx;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+size_t fmt_escape_span(char const *str, char c1, char c2)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const v1   = _mm_set1_epi8(c1);
+    __m128i const v2   = _mm_set1_epi8(c2);
+
+    // aligned loads never cross into the next page, the bytes before str are masked out
+    unsigned misalign    = (unsigned)((uintptr_t)str & 15);
+    __m128i const *block = (__m128i const *)(str - misalign);
+    for (unsigned skip = misalign;; skip = 0, ++block) {
+        __m128i v     = _mm_load_si128(block);
+        __m128i stop  = _mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(stop) >> skip << skip;
+        if (mask)
+            return (char const *)block + fmt_ctz(mask) - str;
+    }
+}
+#else
+size_t fmt_escape_span(char const *str, char c1, char c2)
+{
+    char const *p = str;
+    while (*p && *p != c1 && *p != c2)
+        ++p;
+    return p - str;
+}
+#endif
@@ -0,0 +1,159 @@
+/** @file
+    Single producer, single consumer ring of IQ sample buffers.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "iq_ring.h"
+#include "compat_thread.h"
+
+typedef struct iq_slot {
+    unsigned char *buf;
+    uint32_t len;
+    uint64_t dropped; ///< bytes dropped right before this buffer
+} iq_slot_t;
+
+struct iq_ring {
+    unsigned num_bufs;
+    uint32_t buf_size;
+    iq_slot_t *slots;
+
+    unsigned volatile head; ///< buffers pushed, written by the producer only
+    unsigned volatile tail; ///< buffers released, written by the consumer only
+    unsigned volatile closed;
+    unsigned volatile sleeping; ///< set by the consumer before it waits, the producer only signals then
+
+    mutex_t lock; ///< only to sleep and wake the consumer
+    cond_t cond;
+
+    uint64_t pending_drop; ///< bytes dropped since the last pushed buffer, producer only
+
+    // overrun counters, written by the producer and read by iq_ring_stats() on any thread
+    uint64_t volatile dropped_bytes;
+    unsigned volatile overruns;
+    uint64_t volatile last_overrun;
+};
+
+iq_ring_t *iq_ring_create(unsigned num_bufs, uint32_t buf_size)
+{
+    if (!num_bufs || !buf_size)
+        return NULL;
+
+    iq_ring_t *ring = calloc(1, sizeof(*ring));
+    if (!ring)
+        return NULL;
+    ring->slots = calloc(num_bufs, sizeof(*ring->slots));
+    if (!ring->slots) {
+        free(ring);
+        return NULL;
+    }
+    ring->num_bufs = num_bufs;
+    ring->buf_size = buf_size;
+    mutex_init(&ring->lock);
+    cond_init(&ring->cond);
+    for (unsigned i = 0; i < num_bufs; ++i) {
+        ring->slots[i].buf = malloc(buf_size);
+        if (!ring->slots[i].buf) {
+            iq_ring_free(ring);
+            return NULL;
+        }
+    }
+    return ring;
+}
+
+void iq_ring_free(iq_ring_t *ring)
+{
+    if (!ring)
+        return;
+    for (unsigned i = 0; i < ring->num_bufs; ++i)
+        free(ring->slots[i].buf);
+    cond_destroy(&ring->cond);
+    mutex_destroy(&ring->lock);
+    free(ring->slots);
+    free(ring);
+}
+
+static void iq_ring_wake(iq_ring_t *ring)
+{
+    mutex_lock(&ring->lock);
+    cond_signal(&ring->cond);
+    mutex_unlock(&ring->lock);
+}
+
+int iq_ring_push(iq_ring_t *ring, unsigned char const *buf, uint32_t len)
+{
+    unsigned head = ring->head;
+    if (head - compat_load_acquire(&ring->tail) >= ring->num_bufs || len > ring->buf_size) {
+        // consumer is behind, drop instead of stalling the SDR
+        ring->pending_drop += len;
+        compat_fetch_add64(&ring->dropped_bytes, len);
+        compat_fetch_add(&ring->overruns, 1);
+        compat_store_release64(&ring->last_overrun, (uint64_t)time(NULL));
+        return -1;
+    }
+
+    iq_slot_t *slot = &ring->slots[head % ring->num_bufs];
+    memcpy(slot->buf, buf, len);
+    slot->len          = len;
+    slot->dropped      = ring->pending_drop;
+    ring->pending_drop = 0;
+    compat_store_release(&ring->head, head + 1);
+
+    // the exchanges on sleeping are ordered, either the consumer sees the new head or we see it asleep
+    if (compat_exchange(&ring->sleeping, 0))
+        iq_ring_wake(ring);
+    return 0;
+}
+
+void iq_ring_close(iq_ring_t *ring)
+{
+    compat_store_release(&ring->closed, 1);
+    iq_ring_wake(ring);
+}
+
+void iq_ring_reopen(iq_ring_t *ring)
+{
+    ring->closed = 0;
+}
+
+unsigned char *iq_ring_wait(iq_ring_t *ring, uint32_t *len, uint64_t *dropped)
+{
+    unsigned tail = ring->tail;
+    if (compat_load_acquire(&ring->head) == tail) {
+        mutex_lock(&ring->lock);
+        for (;;) {
+            compat_exchange(&ring->sleeping, 1); // announce before the last look at head
+            if (compat_load_acquire(&ring->head) != tail || compat_load_acquire(&ring->closed))
+                break;
+            cond_wait(&ring->cond, &ring->lock);
+        }
+        compat_store_release(&ring->sleeping, 0);
+        mutex_unlock(&ring->lock);
+        if (compat_load_acquire(&ring->head) == tail)
+            return NULL; // closed and drained
+    }
+
+    iq_slot_t *slot = &ring->slots[tail % ring->num_bufs];
+    *len            = slot->len;
+    *dropped        = slot->dropped;
+    return slot->buf;
+}
+
+void iq_ring_release(iq_ring_t *ring)
+{
+    compat_store_release(&ring->tail, ring->tail + 1);
+}
+
+void iq_ring_stats(iq_ring_t *ring, uint64_t *dropped_bytes, unsigned *overruns, time_t *last_overrun)
+{
+    // read while the producer runs, each counter is consistent but they may be slightly apart
+    *dropped_bytes = compat_load_acquire64(&ring->dropped_bytes);
+    *overruns      = compat_load_acquire(&ring->overruns);
+    *last_overrun  = (time_t)compat_load_acquire64(&ring->last_overrun);
+}
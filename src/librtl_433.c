@@ -30,10 +30,16 @@
 #include "sdr.h"
 #include "baseband.h"
 #include "pulse_detect.h"
+#include "pulse_file.h"
 #include "pulse_analyze.h"
 #include "pulse_demod.h"
 #include "r_util.h"
 #include "redir_print.h"
+#include "compat_thread.h"
+#include "output_queue.h"
+#include "output_mqtt.h"
+#include "data_printer_udp.h"
+#include "data_printer_jsonstr.h"
 
 #ifdef _WIN32
 #include <io.h>
@@ -144,6 +150,7 @@ RTL_433_API int rtl_433_init(rtl_433_t **out_rtl) {
         rtl->bytes_to_read_left = 0;
         rtl->input_pos = 0;
         rtl->demod = NULL;
+        rtl->iq_ring = NULL;
         rtl->center_frequency = 0;
         baseband_init(); /* initialize tables */
     }
@@ -242,19 +249,72 @@ static data_t *create_report_data(rtl_433_t *rtl, int level)
         list_push(&dev_data_list, data);
     }
 
+    // fraction of samples the pulse detectors skipped as silent
+    uint64_t gate_samples = 0, gate_skipped = 0;
+    if (rtl->demod->pulse_detect)
+        pulse_detect_gate_stats(rtl->demod->pulse_detect, &gate_samples, &gate_skipped);
+    for (void **iter = rtl->demod->channels.elems; iter && *iter; ++iter) {
+        dm_channel_t *chan = *iter;
+        uint64_t samples, skipped;
+        pulse_detect_gate_stats(chan->pulse_detect, &samples, &skipped);
+        gate_samples += samples;
+        gate_skipped += skipped;
+    }
+
     data = data_make(
             "count",            "", DATA_INT, rtl->frames_count,
             "fsk",              "", DATA_INT, rtl->frames_fsk,
             "events",           "", DATA_INT, rtl->frames_events,
+            "skipped",          "", DATA_DOUBLE, gate_samples ? (double)gate_skipped / gate_samples : 0.0,
+            "demods",           "", DATA_INT, rtl->demod->demod_runs,
+            "demods_skipped",   "", DATA_INT, rtl->demod->demod_skipped,
             NULL);
 
+    if (rtl->iq_ring) {
+        uint64_t dropped_bytes;
+        unsigned overruns;
+        time_t last_overrun;
+        char time_str[LOCAL_TIME_BUFLEN];
+        iq_ring_stats(rtl->iq_ring, &dropped_bytes, &overruns, &last_overrun);
+        data_append(data,
+                "dropped",          "", DATA_DOUBLE, (double)(dropped_bytes / 2 / rtl->demod->sample_size),
+                "overruns",         "", DATA_INT, overruns,
+                "last_overrun",     "", DATA_STRING, last_overrun ? format_time_str(time_str, NULL, last_overrun) : "",
+                NULL);
+    }
+
     data = data_make(
             "enabled",          "", DATA_INT, r_devs->len,
             "frames",           "", DATA_DATA, data,
             "stats",            "", DATA_ARRAY, data_array(dev_data_list.len, DATA_DATA, dev_data_list.elems),
             NULL);
 
+    // metrics of the outputs that keep counters, queued outputs nest those of the wrapped output
+    list_t queue_data_list = {0};
+    for (size_t i = 0; i < rtl->demod->output_handler.len; ++i) {
+        data_t *stats = data_output_stats(rtl->demod->output_handler.elems[i], NULL);
+        if (!stats)
+            continue;
+        list_push(&queue_data_list, data_prepend(stats,
+                "output",           "", DATA_INT, (int)i,
+                NULL));
+    }
+    if (queue_data_list.len)
+        data_append(data,
+                "outputs",          "", DATA_ARRAY, data_array(queue_data_list.len, DATA_DATA, queue_data_list.elems),
+                NULL);
+
+    // JSON text shared by the syslog and MQTT outputs
+    unsigned json_serialized, json_reused;
+    data_print_jsons_stats(&json_serialized, &json_reused);
+    if (json_serialized)
+        data_append(data,
+                "json_serialized",  "", DATA_INT, json_serialized,
+                "json_reused",      "", DATA_INT, json_reused,
+                NULL);
+
     list_free_elems(&dev_data_list, NULL);
+    list_free_elems(&queue_data_list, NULL);
     return data;
 }
 
@@ -265,6 +325,19 @@ static void flush_report_data(rtl_433_t *rtl)
     rtl->frames_count = 0;
     rtl->frames_fsk = 0;
     rtl->frames_events = 0;
+    rtl->demod->demod_runs = 0;
+    rtl->demod->demod_skipped = 0;
+
+    if (rtl->demod->pulse_detect)
+        pulse_detect_gate_stats_reset(rtl->demod->pulse_detect);
+    for (void **iter = rtl->demod->channels.elems; iter && *iter; ++iter) {
+        dm_channel_t *chan = *iter;
+        pulse_detect_gate_stats_reset(chan->pulse_detect);
+    }
+
+    for (size_t i = 0; i < rtl->demod->output_handler.len; ++i)
+        data_output_stats_reset(rtl->demod->output_handler.elems[i]);
+    data_print_jsons_stats_reset();
 
     for (void **iter = r_devs->elems; iter && *iter; ++iter) {
         r_device *r_dev = *iter;
@@ -316,16 +389,24 @@ RTL_433_API int start(rtl_433_t *rtl, struct sigaction *sigact){
     rtl->bytes_to_read_left = rtl->cfg->bytes_to_read;
     rtl->input_pos = 0;
 
+    if (rtl->cfg->data_arena)
+        data_arena_enable(1);
+
     dm_state_init(&rtl->demod, rtl);
     if (!rtl->demod) {
         rtl433_fprintf(stderr, "start(): Could not initialize demod (internal error)");
         return r;
     }
+
+    baseband_impl_t dsp_impl = baseband_select_impl(rtl->cfg->force_scalar);
+    if (rtl->cfg->verbosity)
+        rtl433_fprintf(stderr, "Using %s DSP kernels.\n", baseband_impl_name(dsp_impl));
         
     // Activate output modules
     if (rtl->cfg->outputs_configured &  OUTPUT_JSON) add_json_output(rtl->demod, rtl->cfg->output_path_json, ((rtl->cfg->overwrite_modes & OVR_SUBJ_DEC_JSON) != 0));
     if (rtl->cfg->outputs_configured &  OUTPUT_CSV)  add_csv_output(rtl->demod, rtl->cfg->output_path_csv, ((rtl->cfg->overwrite_modes & OVR_SUBJ_DEC_CSV) != 0));
     if (rtl->cfg->outputs_configured &  OUTPUT_KV)   add_kv_output(rtl->demod, rtl->cfg->output_path_kv, ((rtl->cfg->overwrite_modes & OVR_SUBJ_DEC_KV) != 0));
+    if (rtl->cfg->outputs_configured &  OUTPUT_CBOR) add_cbor_output(rtl->demod, rtl->cfg->output_path_cbor, ((rtl->cfg->overwrite_modes & OVR_SUBJ_DEC_CBOR) != 0));
     if (rtl->cfg->outputs_configured &  OUTPUT_MQTT) add_mqtt_output(rtl->demod, rtl->cfg->output_mqtt_host, rtl->cfg->output_mqtt_port, rtl->cfg->output_mqtt_opts);
     if (rtl->cfg->outputs_configured &  OUTPUT_UDP)  add_syslog_output(rtl->demod, rtl->cfg->output_udp_host, rtl->cfg->output_udp_port);
     if (rtl->cfg->outputs_configured &  OUTPUT_EXT)  add_ext_output(rtl->demod, rtl->cfg->output_extcallback);
@@ -347,6 +428,13 @@ RTL_433_API int start(rtl_433_t *rtl, struct sigaction *sigact){
                         break;
                     }
                 }
+                // FM is only needed during pulses if lazy demodulation is requested, unless it is dumped
+                rtl->demod->lazy_FM_demod = rtl->demod->enable_FM_demod && rtl->cfg->lazy_fm_demod;
+                for (void **iter = rtl->demod->dumper.elems; iter && *iter; ++iter) {
+                    file_info_t const *dumper = *iter;
+                    if (dumper->format == S16_FM || dumper->format == F32_FM)
+                        rtl->demod->lazy_FM_demod = 0;
+                }
 
                 if (!rtl->cfg->verbosity) {
                     // print registered decoder ranges
@@ -422,6 +510,8 @@ RTL_433_API int start(rtl_433_t *rtl, struct sigaction *sigact){
 
     dm_state_destroy(rtl->demod);
     rtl->demod = NULL;
+    if (rtl->cfg->data_arena)
+        data_arena_enable(0); // all events are released, drop the pooled chunks
     return r >= 0 ? r : -r;
 }
 
@@ -434,8 +524,6 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
         return;
     }
 
-    char time_str[LOCAL_TIME_BUFLEN];
-
     for (size_t i = 0; i < rtl->demod->output_handler.len; ++i) { // list might contain NULLs
         data_output_poll(rtl->demod->output_handler.elems[i]);
     }
@@ -460,15 +548,16 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
         rtl->demod->frame_end_ago += n_samples;
 
 #ifndef _WIN32
-    alarm(3); // require callback to run every 3 second, abort otherwise
+    if (!rtl->iq_ring)
+        alarm(3); // require callback to run every 3 second, abort otherwise
 #endif
 
     if (rtl->demod->samp_grab) {
         samp_grab_push(rtl->demod->samp_grab, iq_buf, len);
     }
 
-    Perform_AM_Demodulation(rtl->demod, iq_buf, n_samples); // fills demod->am_buf
-    Perform_FM_Demodulation(rtl->demod, iq_buf, n_samples); // fills demod->buf.fm
+    if (!rtl->demod->channelizer)
+        Perform_Demodulation(rtl->demod, iq_buf, n_samples); // fills demod->am_buf and demod->buf.fm
 
     // Handle special input formats
     if (rtl->demod->load_info.format == S16_AM) { // The IQ buffer is really AM demodulated data
@@ -480,7 +569,10 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
     }
 
     int d_events = 0; // Sensor events successfully detected
-    if (rtl->demod->r_devs.len || rtl->cfg->analyze_pulses || rtl->demod->dumper.len || rtl->demod->samp_grab) {
+    if (rtl->demod->channelizer) {
+        d_events = run_channels(rtl, iq_buf, n_samples); // each channel has its own pulse detection
+    }
+    else if (rtl->demod->r_devs.len || rtl->cfg->analyze_pulses || rtl->demod->dumper.len || rtl->demod->samp_grab) {
         // Detect a package and loop through demodulators with pulse data
         int package_type = PULSE_DATA_OOK;  // Just to get us started
         
@@ -491,6 +583,12 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
                 break;
             }
         }
+        fm_lazy_t fm_lazy;
+        int lazy_fm = rtl->demod->lazy_FM_demod && rtl->demod->load_info.format != S16_FM;
+        if (lazy_fm)
+            fm_lazy_begin(&fm_lazy, iq_buf, rtl->demod->sample_size, n_samples, rtl->demod->buf.fm, &rtl->demod->demod_FM_state);
+        pulse_detect_set_fm_source(rtl->demod->pulse_detect, lazy_fm ? fm_lazy_demod : NULL, &fm_lazy);
+
         while (package_type != 0) {
             int p_events = 0;  // Sensor events successfully detected per package
             package_type = pulse_detect_package(rtl->demod->pulse_detect, rtl->demod->am_buf, rtl->demod->buf.fm, n_samples, rtl->cfg->level_limit, rtl->cfg->samp_rate, rtl->input_pos, &rtl->demod->pulse_data, &rtl->demod->fsk_pulse_data);
@@ -501,49 +599,15 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
                 // always update the last frame end
                 rtl->demod->frame_end_ago = rtl->demod->pulse_data.end_ago;
             }
-            if (package_type == PULSE_DATA_OOK) {
-                calc_rssi_snr(rtl, &rtl->demod->pulse_data);
-                if (rtl->cfg->analyze_pulses) rtl433_fprintf(stderr, "Detected OOK package\t%s\n", time_pos_str(rtl, rtl->demod->pulse_data.start_ago, time_str));
-
-                p_events += run_ook_demods(rtl->demod);
-                rtl->frames_count++;
-                rtl->frames_events += p_events > 0;
-
-                for (void **iter = rtl->demod->dumper.elems; iter && *iter; ++iter) {
-                    file_info_t const *dumper = *iter;
-                    if (dumper->format == VCD_LOGIC) pulse_data_print_vcd(dumper->file, &rtl->demod->pulse_data, '\'');
-                    if (dumper->format == U8_LOGIC) pulse_data_dump_raw(rtl->demod->u8_buf, n_samples, rtl->input_pos, &rtl->demod->pulse_data, 0x02);
-                    if (dumper->format == PULSE_OOK) pulse_data_dump(dumper->file, &rtl->demod->pulse_data);
-                }
-
-                if (rtl->cfg->verbosity > 2) pulse_data_print(&rtl->demod->pulse_data);
-                if (rtl->cfg->analyze_pulses && (rtl->cfg->grab_mode <= GRAB_ALL_DEVICES || (rtl->cfg->grab_mode == GRAB_UNKNOWN_DEVICES && p_events == 0) || (rtl->cfg->grab_mode == GRAB_KNOWN_DEVICES && p_events > 0))) {
-                    pulse_analyzer(&rtl->demod->pulse_data, package_type, rtl);
-                }
-
-            }
-            else if (package_type == PULSE_DATA_FSK) {
-                calc_rssi_snr(rtl, &rtl->demod->fsk_pulse_data);
-                if (rtl->cfg->analyze_pulses) rtl433_fprintf(stderr, "Detected FSK package\t %s\n", time_pos_str(rtl, rtl->demod->fsk_pulse_data.start_ago, time_str));
-
-                p_events += run_fsk_demods(rtl->demod);
-                rtl->frames_fsk++;
-                rtl->frames_events += p_events > 0;
-
-                for (void **iter = rtl->demod->dumper.elems; iter && *iter; ++iter) {
-                    file_info_t const *dumper = *iter;
-                    if (dumper->format == VCD_LOGIC) pulse_data_print_vcd(dumper->file, &rtl->demod->fsk_pulse_data, '"');
-                    if (dumper->format == U8_LOGIC) pulse_data_dump_raw(rtl->demod->u8_buf, n_samples, rtl->input_pos, &rtl->demod->fsk_pulse_data, 0x04);
-                    if (dumper->format == PULSE_OOK) pulse_data_dump(dumper->file, &rtl->demod->fsk_pulse_data);
-                }
-
-                if (rtl->cfg->verbosity > 2) pulse_data_print(&rtl->demod->fsk_pulse_data);
-                if (rtl->cfg->analyze_pulses && (rtl->cfg->grab_mode <= GRAB_ALL_DEVICES || (rtl->cfg->grab_mode == GRAB_UNKNOWN_DEVICES && p_events == 0) || (rtl->cfg->grab_mode == GRAB_KNOWN_DEVICES && p_events > 0))) {
-                    pulse_analyzer(&rtl->demod->fsk_pulse_data, package_type, rtl);
-                }
-            } // if (package_type == ...
+            if (package_type == PULSE_DATA_OOK)
+                p_events += run_package(rtl, package_type, &rtl->demod->pulse_data, NULL, n_samples);
+            else if (package_type == PULSE_DATA_FSK)
+                p_events += run_package(rtl, package_type, &rtl->demod->fsk_pulse_data, NULL, n_samples);
             d_events += p_events;
         } // while (package_type)...
+        if (lazy_fm)
+            fm_lazy_end(&fm_lazy);
+        pulse_detect_set_fm_source(rtl->demod->pulse_detect, NULL, NULL);
 
         // add event counter to the frames currently tracked
         rtl->demod->frame_event_count += d_events;
@@ -575,7 +639,7 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
         }
     } // if (rtl->cfg->analyze...
 
-    if (rtl->demod->am_analyze) {
+    if (rtl->demod->am_analyze && !rtl->demod->channelizer) {
         am_analyze(rtl->demod->am_analyze, rtl->demod->am_buf, n_samples, rtl->cfg->verbosity > 1/*, NULL, NULL, 0*/);
     }
 
@@ -602,7 +666,7 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
     time_t rawtime;
     time(&rawtime);
     int hop_index = rtl->cfg->hop_times > rtl->frequency_index ? rtl->frequency_index : rtl->cfg->hop_times - 1;
-    if (rtl->cfg->frequencies > 1 && difftime(rawtime, rtl->hop_start_time) > rtl->cfg->hop_time[hop_index]) {
+    if (rtl->cfg->frequencies > 1 && !rtl->demod->channelizer && difftime(rawtime, rtl->hop_start_time) > rtl->cfg->hop_time[hop_index]) {
         rtl->do_exit_async = 1;
 #ifndef _WIN32
         alarm(0); // cancel the watchdog timer
@@ -627,6 +691,46 @@ void sdr_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
     }
 }
 
+/// SDR callback with cfg->dsp_ring_buffers: only queue the samples for the DSP thread.
+static void sdr_ring_callback(unsigned char *iq_buf, uint32_t len, void *ctx)
+{
+    rtl_433_t *rtl = (rtl_433_t*) ctx;
+
+    if (rtl->do_exit || rtl->do_exit_async)
+        return;
+
+#ifndef _WIN32
+    alarm(3); // require the SDR to deliver every 3 second, the DSP thread may lag behind
+#endif
+
+    iq_ring_push(rtl->iq_ring, iq_buf, len);
+}
+
+static THREAD_RETURN THREAD_CALL dsp_thread(void *arg)
+{
+    rtl_433_t *rtl = (rtl_433_t*) arg;
+    unsigned char *iq_buf;
+    uint32_t len;
+    uint64_t dropped;
+
+    while ((iq_buf = iq_ring_wait(rtl->iq_ring, &len, &dropped))) {
+        if (dropped) {
+            uint64_t n_dropped = dropped / 2 / rtl->demod->sample_size;
+            uint64_t dropped_bytes;
+            unsigned overruns;
+            time_t last_overrun;
+            char time_str[LOCAL_TIME_BUFLEN];
+            iq_ring_stats(rtl->iq_ring, &dropped_bytes, &overruns, &last_overrun);
+            rtl433_fprintf(stderr, "DSP overrun: dropped %llu samples at %s (%u buffers dropped in total)\n",
+                    (unsigned long long)n_dropped, format_time_str(time_str, NULL, last_overrun), overruns);
+            rtl->input_pos += n_dropped; // keep the sample positions in sync
+        }
+        sdr_callback(iq_buf, len, rtl);
+        iq_ring_release(rtl->iq_ring);
+    }
+    return 0;
+}
+
 static int InitSdr(rtl_433_t *rtl) {
     if (!rtl || !rtl->demod) {
         rtl433_fprintf(stderr, "InitSdr: missing context (internal error).\n");
@@ -680,12 +784,27 @@ static int ReadRtlAsync(rtl_433_t *rtl, struct sigaction *sigact) {
     if (rtl->cfg->verbosity) {
         rtl433_fprintf(stderr, "Reading samples in async mode...\n");
     }
+    // Receive all frequencies at once instead of hopping
+    uint32_t channels_center = 0;
+    if (rtl->cfg->channelize && rtl->cfg->frequencies > 1 && !rtl->demod->channelizer) {
+        r = dm_channels_init(rtl->demod, &channels_center);
+        if (r)
+            return r;
+    }
+    // Decouple the DSP from the SDR thread
+    if (rtl->cfg->dsp_ring_buffers) {
+        rtl->iq_ring = iq_ring_create(rtl->cfg->dsp_ring_buffers, rtl->cfg->out_block_size);
+        if (!rtl->iq_ring) {
+            rtl433_fprintf(stderr, "ReadRtlAsync: could not allocate the DSP ring buffers.\n");
+            return RTL_433_ERROR_OUTOFMEM;
+        }
+    }
     uint32_t samp_rate = rtl->cfg->samp_rate;
     while (!rtl->do_exit) {
         time(&rtl->hop_start_time);
 
         /* Set the frequency */
-        rtl->center_frequency = rtl->cfg->frequency[rtl->frequency_index];
+        rtl->center_frequency = channels_center ? channels_center : rtl->cfg->frequency[rtl->frequency_index];
         r = sdr_set_center_freq(rtl->dev, rtl->center_frequency, 1); // always verbose
 
         if (samp_rate != rtl->cfg->samp_rate) {
@@ -701,7 +820,21 @@ static int ReadRtlAsync(rtl_433_t *rtl, struct sigaction *sigact) {
             alarm(3); // require callback to run every 3 second, abort otherwise
         }
 #endif
-        r = sdr_start(rtl->dev, sdr_callback, (void *)rtl, DEFAULT_ASYNC_BUF_NUMBER, rtl->cfg->out_block_size);
+        thread_t dsp;
+        if (rtl->iq_ring) {
+            iq_ring_reopen(rtl->iq_ring);
+            if (thread_start(&dsp, dsp_thread, rtl)) {
+                rtl433_fprintf(stderr, "ReadRtlAsync: could not start the DSP thread.\n");
+                r = RTL_433_ERROR_INTERNAL;
+                break;
+            }
+        }
+        r = sdr_start(rtl->dev, rtl->iq_ring ? sdr_ring_callback : sdr_callback, (void *)rtl, DEFAULT_ASYNC_BUF_NUMBER, rtl->cfg->out_block_size);
+        if (rtl->iq_ring) {
+            // finish the queued buffers of this round
+            iq_ring_close(rtl->iq_ring);
+            thread_join(dsp);
+        }
         if (r < 0) {
             rtl433_fprintf(stderr, "WARNING: async read failed (%i).\n", r);
             break;
@@ -714,22 +847,29 @@ static int ReadRtlAsync(rtl_433_t *rtl, struct sigaction *sigact) {
         rtl->do_exit_async = 0;
         rtl->frequency_index = (rtl->frequency_index + 1) % rtl->cfg->frequencies;
     }
+    iq_ring_free(rtl->iq_ring);
+    rtl->iq_ring = NULL;
     return r;
 }
 
-static void calc_rssi_snr(rtl_433_t *rtl, pulse_data_t *pulse_data){
+static void calc_rssi_snr(rtl_433_t *rtl, pulse_data_t *pulse_data, dm_channel_t const *chan){
     if (!rtl || !rtl->demod || !pulse_data) {
         rtl433_fprintf(stderr, "calc_rssi_snr: missing context (internal error).\n");
         return;
     }
 
+    // a channel is CS16 at the decimated rate, centered on its own frequency
+    uint32_t samp_rate = chan ? rtl->cfg->samp_rate / channelizer_decimation(rtl->demod->channelizer) : rtl->cfg->samp_rate;
+    uint32_t center_frequency = chan ? chan->frequency : rtl->center_frequency;
+    int sample_size = chan ? 2 : rtl->demod->sample_size;
+
     float asnr = (float)pulse_data->ook_high_estimate / ((float)pulse_data->ook_low_estimate + 1);
-    float foffs1 = (float)pulse_data->fsk_f1_est / INT16_MAX * rtl->cfg->samp_rate / 2.0;
-    float foffs2 = (float)pulse_data->fsk_f2_est / INT16_MAX * rtl->cfg->samp_rate / 2.0;
-    pulse_data->freq1_hz = (foffs1 + rtl->center_frequency);
-    pulse_data->freq2_hz = (foffs2 + rtl->center_frequency);
+    float foffs1 = (float)pulse_data->fsk_f1_est / INT16_MAX * samp_rate / 2.0;
+    float foffs2 = (float)pulse_data->fsk_f2_est / INT16_MAX * samp_rate / 2.0;
+    pulse_data->freq1_hz = (foffs1 + center_frequency);
+    pulse_data->freq2_hz = (foffs2 + center_frequency);
     // NOTE: for (CU8) amplitude is 10x (because it's squares)
-    if (rtl->demod->sample_size == 1) { // amplitude (CU8)
+    if (sample_size == 1) { // amplitude (CU8)
         pulse_data->rssi_db = 10.0f * log10f(pulse_data->ook_high_estimate) - 42.1442f; // 10*log10f(16384.0f)
         pulse_data->noise_db = 10.0f * log10f(pulse_data->ook_low_estimate + 1) - 42.1442f; // 10*log10f(16384.0f)
         pulse_data->snr_db = 10.0f * log10f(asnr);
@@ -741,6 +881,101 @@ static void calc_rssi_snr(rtl_433_t *rtl, pulse_data_t *pulse_data){
     }
 }
 
+/// Scale pulses detected in a channel (decimated samples) to input samples, as the decoders expect.
+static void channel_pulses_to_input_rate(pulse_data_t *out, pulse_data_t const *in, unsigned decimation)
+{
+    *out = *in;
+    out->offset      = in->offset * decimation;
+    out->sample_rate = in->sample_rate * decimation;
+    out->start_ago   = in->start_ago * decimation;
+    out->end_ago     = in->end_ago * decimation;
+    for (unsigned i = 0; i < in->num_pulses; i++) {
+        out->pulse[i] = in->pulse[i] * decimation;
+        out->gap[i]   = in->gap[i] * decimation;
+    }
+}
+
+/// Decode, count, dump and analyze one detected package, either from the whole band or from a channel.
+static int run_package(rtl_433_t *rtl, int package_type, pulse_data_t *pulse_data, dm_channel_t const *chan, unsigned long n_samples)
+{
+    dm_state *dm = rtl->demod;
+    int fsk = package_type == PULSE_DATA_FSK;
+    uint32_t frequency = chan ? chan->frequency : rtl->center_frequency;
+    char time_str[LOCAL_TIME_BUFLEN];
+
+    calc_rssi_snr(rtl, pulse_data, chan);
+    if (rtl->cfg->analyze_pulses) {
+        if (chan)
+            rtl433_fprintf(stderr, "Detected %s package on %u Hz\t%s%s\n", fsk ? "FSK" : "OOK", chan->frequency, fsk ? " " : "", time_pos_str(rtl, pulse_data->start_ago, time_str));
+        else
+            rtl433_fprintf(stderr, "Detected %s package\t%s%s\n", fsk ? "FSK" : "OOK", fsk ? " " : "", time_pos_str(rtl, pulse_data->start_ago, time_str));
+    }
+
+    int p_events = fsk ? run_fsk_demods(dm) : run_ook_demods(dm);
+    if (fsk)
+        rtl->frames_fsk++;
+    else
+        rtl->frames_count++;
+    rtl->frames_events += p_events > 0;
+
+    for (void **iter = dm->dumper.elems; iter && *iter; ++iter) {
+        file_info_t const *dumper = *iter;
+        if (dumper->format == VCD_LOGIC) pulse_data_print_vcd(dumper->file, pulse_data, fsk ? '"' : '\'');
+        if (dumper->format == U8_LOGIC && !chan) pulse_data_dump_raw(dm->u8_buf, n_samples, rtl->input_pos, pulse_data, fsk ? 0x04 : 0x02);
+        if (dumper->format == PULSE_OOK) pulse_data_dump(dumper->file, pulse_data);
+        if (dumper->format == PULSE_BIN) pulse_data_dump_bin(dumper->file, pulse_data, fsk, frequency);
+    }
+
+    if (rtl->cfg->verbosity > 2) pulse_data_print(pulse_data);
+    if (rtl->cfg->analyze_pulses && (rtl->cfg->grab_mode <= GRAB_ALL_DEVICES || (rtl->cfg->grab_mode == GRAB_UNKNOWN_DEVICES && p_events == 0) || (rtl->cfg->grab_mode == GRAB_KNOWN_DEVICES && p_events > 0))) {
+        pulse_analyzer(pulse_data, package_type, rtl);
+    }
+    return p_events;
+}
+
+/// Channelizer mode: split the block into channels, then detect and decode each channel.
+static int run_channels(rtl_433_t *rtl, unsigned char *iq_buf, unsigned long n_samples)
+{
+    dm_state *dm = rtl->demod;
+    unsigned decimation = channelizer_decimation(dm->channelizer);
+    uint32_t channel_rate = rtl->cfg->samp_rate / decimation;
+    int16_t *channel_bufs[MAX_FREQS];
+    int d_events = 0;
+
+    for (size_t c = 0; c < dm->channels.len; ++c) {
+        dm_channel_t *chan = dm->channels.elems[c];
+        channel_bufs[c] = chan->iq_buf;
+    }
+    unsigned long n_out = channelizer_process(dm->channelizer, iq_buf, dm->sample_size, n_samples, channel_bufs);
+
+    for (size_t c = 0; c < dm->channels.len; ++c) {
+        dm_channel_t *chan = dm->channels.elems[c];
+        Perform_Channel_Demodulation(dm, chan, n_out); // fills demod->am_buf and demod->buf.fm (unless lazy)
+        fm_lazy_t fm_lazy;
+        if (dm->lazy_FM_demod)
+            fm_lazy_begin(&fm_lazy, chan->iq_buf, 2, n_out, dm->buf.fm, &chan->demod_FM_state);
+        pulse_detect_set_fm_source(chan->pulse_detect, dm->lazy_FM_demod ? fm_lazy_demod : NULL, &fm_lazy);
+
+        int package_type;
+        while ((package_type = pulse_detect_package(chan->pulse_detect, dm->am_buf, dm->buf.fm, n_out, rtl->cfg->level_limit, channel_rate, rtl->input_pos / decimation, &chan->pulse_data, &chan->fsk_pulse_data))) {
+            int p_events = 0;
+            if (package_type == PULSE_DATA_OOK) {
+                channel_pulses_to_input_rate(&dm->pulse_data, &chan->pulse_data, decimation);
+                p_events += run_package(rtl, package_type, &dm->pulse_data, chan, n_out);
+            }
+            else if (package_type == PULSE_DATA_FSK) {
+                channel_pulses_to_input_rate(&dm->fsk_pulse_data, &chan->fsk_pulse_data, decimation);
+                p_events += run_package(rtl, package_type, &dm->fsk_pulse_data, chan, n_out);
+            }
+            d_events += p_events;
+        }
+        if (dm->lazy_FM_demod)
+            fm_lazy_end(&fm_lazy);
+        pulse_detect_set_fm_source(chan->pulse_detect, NULL, NULL);
+    }
+    return d_events;
+}
+
 char *time_pos_str(rtl_433_t *rtl, unsigned samples_ago, char *buf)
 {
     if (rtl->demod->report_time == REPORT_TIME_SAMPLES) {
@@ -15,15 +15,30 @@
 #include "util.h"
 #include "data_printer_jsonstr.h"
 #include "redir_print.h"
+#include "fmt.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "mongoose.h"
+#include "compat_thread.h"
 
 /* MQTT client abstraction */
 
+#define MQTT_POLL_MS      500     // event loop timeout, new messages wake it up earlier
+#define MQTT_SEND_LIMIT   65536   // bytes waiting on the connection before the queue is held back
+#define MQTT_BACKOFF_MIN  0.5     // seconds before the first reconnect
+#define MQTT_BACKOFF_MAX  60.0    // seconds between reconnects at most
+#define MQTT_QUEUE_DEPTH  1024    // default for the "queue" option
+
+/// Messages queued together, topic and payload pairs each NUL terminated.
+typedef struct mqtt_batch {
+    char *msgs;
+    size_t len;
+    unsigned count;
+} mqtt_batch_t;
+
 typedef struct mqtt_client {
     struct mg_send_mqtt_handshake_opts opts;
     int prev_status;
@@ -31,6 +46,24 @@ typedef struct mqtt_client {
     char client_id[256];
     uint16_t message_id;
     int publish_flags; // MG_MQTT_RETAIN | MG_MQTT_QOS(0)
+
+    // owned by the client thread
+    struct mg_connection *conn; ///< the broker connection, NULL while waiting to reconnect
+    int connected;              ///< the broker accepted the connection
+    double reconnect_at;        ///< mg_time() of the next connect attempt
+    double backoff;             ///< seconds to wait after the next failure
+
+    // shared with the printing thread
+    mutex_t lock;
+    mqtt_batch_t *queue;
+    unsigned size;
+    unsigned head;
+    unsigned count;
+    int exit;
+    mqtt_stats_t stats;
+    unsigned volatile wake_pending; ///< a byte is on its way to wake the event loop
+    sock_t wake[2];                 ///< written by the printing thread, read by the event loop
+    thread_t thread;
 } mqtt_client_t;
 
 static void mqtt_client_event(struct mg_connection *nc, int ev, void *ev_data)
@@ -68,6 +101,10 @@ static void mqtt_client_event(struct mg_connection *nc, int ev, void *ev_data)
         }
         else {
             rtl433_fprintf(stderr, "MQTT Connection established.\n");
+            if (ctx) {
+                ctx->connected = 1;
+                ctx->backoff   = MQTT_BACKOFF_MIN;
+            }
         }
         break;
     case MG_EV_MQTT_PUBACK:
@@ -82,19 +119,99 @@ static void mqtt_client_event(struct mg_connection *nc, int ev, void *ev_data)
         break;
     }
     case MG_EV_CLOSE:
-        if (!ctx)
+        if (!ctx || nc != ctx->conn)
             break; // shuttig down
         if (ctx->prev_status == 0)
             rtl433_fprintf(stderr, "MQTT Connection failed...\n");
-        // reconnect
-        if (mg_connect(nc->mgr, ctx->address, mqtt_client_event) == NULL) {
-            rtl433_fprintf(stderr, "MQTT connect(%s) failed\n", ctx->address);
-        }
+        // reconnect later, waiting longer after each failure
+        ctx->conn         = NULL;
+        ctx->connected    = 0;
+        ctx->reconnect_at = mg_time() + ctx->backoff;
+        ctx->backoff      = ctx->backoff * 2 < MQTT_BACKOFF_MAX ? ctx->backoff * 2 : MQTT_BACKOFF_MAX;
         break;
     }
 }
 
-static struct mg_mgr *mqtt_client_init(char const *host, char const *port, char const *user, char const *pass, char const *client_id, int retain)
+static void mqtt_client_wake_event(struct mg_connection *nc, int ev, void *ev_data)
+{
+    mqtt_client_t *ctx = (mqtt_client_t *)nc->mgr->user_data;
+
+    if (ev == MG_EV_RECV) {
+        mbuf_remove(&nc->recv_mbuf, nc->recv_mbuf.len);
+        if (ctx)
+            compat_store_release(&ctx->wake_pending, 0);
+    }
+}
+
+static void mqtt_client_connect(struct mg_mgr *mgr)
+{
+    mqtt_client_t *ctx = (mqtt_client_t *)mgr->user_data;
+
+    ctx->conn = mg_connect(mgr, ctx->address, mqtt_client_event);
+    if (!ctx->conn) {
+        rtl433_fprintf(stderr, "MQTT connect(%s) failed\n", ctx->address);
+        ctx->reconnect_at = mg_time() + ctx->backoff;
+        ctx->backoff      = ctx->backoff * 2 < MQTT_BACKOFF_MAX ? ctx->backoff * 2 : MQTT_BACKOFF_MAX;
+    }
+}
+
+/// Pass queued messages to the connection while it keeps up.
+static void mqtt_client_send(struct mg_mgr *mgr)
+{
+    mqtt_client_t *ctx = (mqtt_client_t *)mgr->user_data;
+
+    while (ctx->connected && ctx->conn->send_mbuf.len < MQTT_SEND_LIMIT) {
+        mutex_lock(&ctx->lock);
+        if (!ctx->count) {
+            mutex_unlock(&ctx->lock);
+            break;
+        }
+        mqtt_batch_t batch = ctx->queue[ctx->head];
+        ctx->head          = (ctx->head + 1) % ctx->size;
+        ctx->count--;
+        ctx->stats.published += batch.count;
+        mutex_unlock(&ctx->lock);
+
+        for (char *topic = batch.msgs; topic < batch.msgs + batch.len;) {
+            char *payload = topic + strlen(topic) + 1;
+            size_t len    = strlen(payload);
+            mg_mqtt_publish(ctx->conn, topic, ++ctx->message_id, ctx->publish_flags, payload, len);
+            topic = payload + len + 1;
+        }
+        free(batch.msgs);
+    }
+}
+
+static THREAD_RETURN THREAD_CALL mqtt_client_thread(void *arg)
+{
+    struct mg_mgr *mgr = arg;
+    mqtt_client_t *ctx = (mqtt_client_t *)mgr->user_data;
+
+    for (;;) {
+        mg_mgr_poll(mgr, MQTT_POLL_MS);
+
+        if (!ctx->conn && mg_time() >= ctx->reconnect_at)
+            mqtt_client_connect(mgr);
+
+        mutex_lock(&ctx->lock);
+        int exit = ctx->exit;
+        mutex_unlock(&ctx->lock);
+
+        mqtt_client_send(mgr);
+        if (exit)
+            break;
+    }
+
+    // give the last messages a moment to go out
+    for (int i = 0; i < 10 && ctx->connected && (ctx->count || ctx->conn->send_mbuf.len); ++i) {
+        mg_mgr_poll(mgr, 100);
+        mqtt_client_send(mgr);
+    }
+
+    return (THREAD_RETURN)0;
+}
+
+static struct mg_mgr *mqtt_client_init(char const *host, char const *port, char const *user, char const *pass, char const *client_id, int retain, unsigned depth)
 {
     struct mg_mgr *mgr = calloc(1, sizeof(*mgr));
     if (!mgr) {
@@ -105,6 +222,7 @@ static struct mg_mgr *mqtt_client_init(char const *host, char const *port, char
     mqtt_client_t *ctx = calloc(1, sizeof(*ctx));
     if (!ctx) {
         rtl433_fprintf(stderr, "calloc() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
+        free(mgr);
         return NULL; // exit(1); // handled at caller
     }
     ctx->opts.user_name = user;
@@ -115,127 +233,234 @@ static struct mg_mgr *mqtt_client_init(char const *host, char const *port, char
     //ctx->timeout = 10000L;
     //ctx->cleansession = 1;
     strncpy(ctx->client_id, client_id, sizeof(ctx->client_id));
+    ctx->backoff = MQTT_BACKOFF_MIN;
+    ctx->wake[0] = ctx->wake[1] = INVALID_SOCKET;
+
+    ctx->size  = depth;
+    ctx->queue = calloc(depth, sizeof(*ctx->queue));
+    if (!ctx->queue) {
+        rtl433_fprintf(stderr, "calloc() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
+        free(ctx);
+        free(mgr);
+        return NULL; // exit(1); // handled at caller
+    }
+    mutex_init(&ctx->lock);
 
     mg_mgr_init(mgr, ctx);
 
+    // new messages wake the event loop through a socket pair
+    if (!mg_socketpair(ctx->wake, SOCK_STREAM)) {
+        rtl433_fprintf(stderr, "MQTT could not create the wakeup socket pair\n");
+        goto error;
+    }
+    if (!mg_add_sock(mgr, ctx->wake[1], mqtt_client_wake_event)) {
+        rtl433_fprintf(stderr, "MQTT could not create the wakeup socket pair\n");
+        closesocket(ctx->wake[1]);
+        goto error;
+    }
+    ctx->wake[1] = INVALID_SOCKET; // closed by the manager from now on
+
     // if the host is an IPv6 address it needs quoting
     if (strchr(host, ':'))
         snprintf(ctx->address, sizeof(ctx->address), "[%s]:%s", host, port);
     else
         snprintf(ctx->address, sizeof(ctx->address), "%s:%s", host, port);
 
-    if (mg_connect(mgr, ctx->address, mqtt_client_event) == NULL) {
+    ctx->conn = mg_connect(mgr, ctx->address, mqtt_client_event);
+    if (ctx->conn == NULL) {
         rtl433_fprintf(stderr, "MQTT connect(%s) failed\n", ctx->address);
-        return NULL; // exit(1); // handled at caller
+        goto error;
+    }
+
+    if (thread_start(&ctx->thread, mqtt_client_thread, mgr)) {
+        rtl433_fprintf(stderr, "MQTT could not start the client thread\n");
+        goto error;
     }
 
     return mgr;
-}
 
-static int mqtt_client_poll(struct mg_mgr *mgr)
-{
-    return mg_mgr_poll(mgr, 0);
+error:
+    mgr->user_data = NULL;
+    mg_mgr_free(mgr); // closes the connection and the added end of the socket pair
+    if (ctx->wake[0] != INVALID_SOCKET)
+        closesocket(ctx->wake[0]);
+    free(ctx->queue);
+    mutex_destroy(&ctx->lock);
+    free(ctx);
+    free(mgr);
+    return NULL; // exit(1); // handled at caller
 }
 
-static void mqtt_client_publish(struct mg_mgr *mgr, char const *topic, char const *str)
+/// Queue messages for the client thread, drops the oldest if the queue is full.
+static void mqtt_client_publish(struct mg_mgr *mgr, char const *msgs, size_t len, unsigned count)
 {
     mqtt_client_t *ctx = (mqtt_client_t *)mgr->user_data;
-    ctx->message_id++;
 
-    for (struct mg_connection *c = mg_next(mgr, NULL); c != NULL; c = mg_next(mgr, c)) {
-        if (c->proto_handler)
-            mg_mqtt_publish(c, topic, ctx->message_id, ctx->publish_flags, str, strlen(str));
+    mqtt_batch_t batch = {.msgs = malloc(len), .len = len, .count = count};
+    if (!batch.msgs) {
+        mutex_lock(&ctx->lock);
+        ctx->stats.dropped += count;
+        mutex_unlock(&ctx->lock);
+        return;
     }
+    memcpy(batch.msgs, msgs, len);
+
+    mutex_lock(&ctx->lock);
+    if (ctx->count == ctx->size) {
+        mqtt_batch_t *oldest = &ctx->queue[ctx->head];
+        ctx->stats.dropped += oldest->count;
+        free(oldest->msgs);
+        ctx->head = (ctx->head + 1) % ctx->size;
+        ctx->count--;
+    }
+    ctx->queue[(ctx->head + ctx->count) % ctx->size] = batch;
+    ctx->count++;
+    if (ctx->stats.max_depth < ctx->count)
+        ctx->stats.max_depth = ctx->count;
+    mutex_unlock(&ctx->lock);
+
+    // only the first message since the loop woke up needs to send the byte
+    if (compat_fetch_add(&ctx->wake_pending, 1) == 0)
+        send(ctx->wake[0], "w", 1, 0);
 }
 
 static void mqtt_client_free(struct mg_mgr *mgr)
 {
-    free(mgr->user_data);
+    mqtt_client_t *ctx = (mqtt_client_t *)mgr->user_data;
+
+    mutex_lock(&ctx->lock);
+    ctx->exit = 1;
+    mutex_unlock(&ctx->lock);
+    compat_fetch_add(&ctx->wake_pending, 1);
+    send(ctx->wake[0], "x", 1, 0);
+    thread_join(ctx->thread);
+
     mgr->user_data = NULL;
     mg_mgr_free(mgr);
+    closesocket(ctx->wake[0]);
+
+    for (unsigned i = 0; i < ctx->count; ++i)
+        free(ctx->queue[(ctx->head + i) % ctx->size].msgs);
+    free(ctx->queue);
+    mutex_destroy(&ctx->lock);
+    free(ctx);
+    free(mgr);
 }
 
 /* Helper */
 
 /// clean the topic inplace to [-.A-Za-z0-9], esp. not whitespace, +, #, /, $
-static char *mqtt_sanitize_topic(char *topic)
+static inline char mqtt_sanitize_topic(char c)
 {
-    for (char *p = topic; *p; ++p)
-        if (*p != '-' && *p != '.' && (*p < 'A' || *p > 'Z') && (*p < 'a' || *p > 'z') && (*p < '0' || *p > '9'))
-            *p = '_';
-
-    return topic;
+    if (c != '-' && c != '.' && (c < 'A' || c > 'Z') && (c < 'a' || c > 'z') && (c < '0' || c > '9'))
+        return '_';
+    return c;
 }
 
-/* MQTT printer */
+/* MQTT topic templates */
 
-typedef struct {
-    data_output_t output;
-    struct mg_mgr *mgr;
-    char topic[256];
-    char hostname[64];
-    char *devices;
-    char *events;
-    char *states;
-    //char *homie;
-    //char *hass;
-} data_output_mqtt_t;
+static struct {
+    char const *brand;
+    char const *type;
+    char const *model;
+    char const *subtype;
+    char const *channel;
+    char const *id;
+} mqtt_keys;
 
-static void print_mqtt_array(data_output_t *output, data_array_t *array, char *format)
+static int mqtt_keys_intern(void)
 {
-    data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
-
-    char *orig = mqtt->topic + strlen(mqtt->topic); // save current topic
-
-    for (int c = 0; c < array->num_values; ++c) {
-        sprintf(orig, "/%d", c);
-        print_array_value(output, array, format, c);
-    }
-    *orig = '\0'; // restore topic
+    mqtt_keys.brand   = data_key_intern("brand");
+    mqtt_keys.type    = data_key_intern("type");
+    mqtt_keys.model   = data_key_intern("model");
+    mqtt_keys.subtype = data_key_intern("subtype");
+    mqtt_keys.channel = data_key_intern("channel");
+    mqtt_keys.id      = data_key_intern("id");
+    return mqtt_keys.brand && mqtt_keys.type && mqtt_keys.model
+            && mqtt_keys.subtype && mqtt_keys.channel && mqtt_keys.id ? 0 : -1;
 }
 
-static char *append_topic(char *topic, data_t *data)
+/// Fields a topic format can refer to, in the order of the tokens.
+enum mqtt_topic_field {
+    TOPIC_TYPE,
+    TOPIC_MODEL,
+    TOPIC_SUBTYPE,
+    TOPIC_CHANNEL,
+    TOPIC_ID,
+    TOPIC_FIELDS,
+};
+
+/// One step of a topic: literal text, then optionally a field.
+typedef struct mqtt_topic_op {
+    size_t text_off; ///< literal text in mqtt_topic_t::text
+    size_t text_len;
+    int slot;        ///< index into mqtt_topic_t::keys, -1 for text only
+    int leading_slash;
+    char const *def; ///< default if the field is missing, NULL to skip the token
+    size_t def_len;
+} mqtt_topic_op_t;
+
+/// A topic format parsed once, expanding it per event is a copy loop.
+typedef struct mqtt_topic {
+    char *format;
+    char *text;                      ///< literal text of all ops, with the hostname folded in
+    mqtt_topic_op_t *ops;
+    unsigned ops_len;
+    char const *keys[TOPIC_FIELDS];  ///< interned keys of the fields used
+    unsigned keys_len;
+} mqtt_topic_t;
+
+static void mqtt_topic_free(mqtt_topic_t *tpl)
 {
-    if (data->type == DATA_STRING) {
-        strcpy(topic, data->value);
-        mqtt_sanitize_topic(topic);
-        topic += strlen(data->value);
-    }
-    else if (data->type == DATA_INT) {
-        topic += sprintf(topic, "%d", *(int *)data->value);
-    }
-    else {
-        rtl433_fprintf(stderr, "Can't append data type %d to topic\n", data->type);
-    }
-
-    return topic;
+    if (!tpl)
+        return;
+    free(tpl->format);
+    free(tpl->text);
+    free(tpl->ops);
+    free(tpl);
 }
 
-static char *expand_topic(char *topic, char const *format, data_t *data, char const *hostname)
+/** Parse a topic format like "rtl_433/[hostname]/devices[/type][/model][/id]".
+
+    Tokens are "[key]", "[/key]" to prepend a slash and "[key:default]".
+    Keys are "hostname", "type", "model", "subtype", "channel" and "id",
+    the hostname is fixed and becomes literal text.
+    @param format: the format, owned by the topic, freed on failure
+    @return the topic or NULL if the format is invalid
+*/
+static mqtt_topic_t *mqtt_topic_compile(char *format, char const *hostname)
 {
-    // collect well-known top level keys
-    data_t *data_type    = NULL;
-    data_t *data_model   = NULL;
-    data_t *data_subtype = NULL;
-    data_t *data_channel = NULL;
-    data_t *data_id      = NULL;
-    for (data_t *d = data; d; d = d->next) {
-        if (!strcmp(d->key, "type"))
-            data_type = d;
-        else if (!strcmp(d->key, "model"))
-            data_model = d;
-        else if (!strcmp(d->key, "subtype"))
-            data_subtype = d;
-        else if (!strcmp(d->key, "channel"))
-            data_channel = d;
-        else if (!strcmp(d->key, "id"))
-            data_id = d;
+    char const *field_keys[TOPIC_FIELDS] = {
+            [TOPIC_TYPE]    = mqtt_keys.type,
+            [TOPIC_MODEL]   = mqtt_keys.model,
+            [TOPIC_SUBTYPE] = mqtt_keys.subtype,
+            [TOPIC_CHANNEL] = mqtt_keys.channel,
+            [TOPIC_ID]      = mqtt_keys.id,
+    };
+
+    mqtt_topic_t *tpl = calloc(1, sizeof(*tpl));
+    if (!tpl) {
+        rtl433_fprintf(stderr, "calloc() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
+        free(format);
+        return NULL;
+    }
+    tpl->format = format;
+
+    // worst case is every byte a token, each needs an op and may add the hostname
+    size_t format_len = strlen(format);
+    size_t host_len   = strlen(hostname);
+    tpl->text = malloc(format_len + format_len / 2 * (host_len + 1) + 1);
+    tpl->ops  = calloc(format_len / 2 + 1, sizeof(*tpl->ops));
+    if (!tpl->text || !tpl->ops) {
+        rtl433_fprintf(stderr, "malloc() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
+        mqtt_topic_free(tpl);
+        return NULL;
     }
 
+    size_t text_len  = 0;
+    size_t run_start = 0;
     // consume entire format string
-    while (format && *format) {
-        data_t *data_token  = NULL;
-        char const *string_token = NULL;
+    while (*format) {
         int leading_slash   = 0;
         char const *t_start = NULL;
         char const *t_end   = NULL;
@@ -243,7 +468,7 @@ static char *expand_topic(char *topic, char const *format, data_t *data, char co
         char const *d_end   = NULL;
         // copy until '['
         while (*format && *format != '[')
-            *topic++ = *format++;
+            tpl->text[text_len++] = *format++;
         // skip '['
         if (!*format)
             break;
@@ -266,47 +491,189 @@ static char *expand_topic(char *topic, char const *format, data_t *data, char co
         // check for proper closing
         if (*format != ']') {
             rtl433_fprintf(stderr, "%s: unterminated token\n", __func__);
+            mqtt_topic_free(tpl);
             return NULL; // exit(1); // handled at caller
         }
         ++format;
 
         // resolve token
-        if (!strncmp(t_start, "hostname", t_end - t_start))
-            string_token = hostname;
+        int field;
+        if (!strncmp(t_start, "hostname", t_end - t_start)) {
+            if (leading_slash)
+                tpl->text[text_len++] = '/';
+            memcpy(&tpl->text[text_len], hostname, host_len);
+            text_len += host_len;
+            continue;
+        }
         else if (!strncmp(t_start, "type", t_end - t_start))
-            data_token = data_type;
+            field = TOPIC_TYPE;
         else if (!strncmp(t_start, "model", t_end - t_start))
-            data_token = data_model;
+            field = TOPIC_MODEL;
         else if (!strncmp(t_start, "subtype", t_end - t_start))
-            data_token = data_subtype;
+            field = TOPIC_SUBTYPE;
         else if (!strncmp(t_start, "channel", t_end - t_start))
-            data_token = data_channel;
+            field = TOPIC_CHANNEL;
         else if (!strncmp(t_start, "id", t_end - t_start))
-            data_token = data_id;
+            field = TOPIC_ID;
         else {
             rtl433_fprintf(stderr, "%s: unknown token \"%.*s\"\n", __func__, (int)(t_end - t_start), t_start);
+            mqtt_topic_free(tpl);
             return NULL; // exit(1); // handled at caller
         }
 
+        // find or add the slot of the field
+        int slot = 0;
+        while (slot < (int)tpl->keys_len && tpl->keys[slot] != field_keys[field])
+            ++slot;
+        if (slot == (int)tpl->keys_len)
+            tpl->keys[tpl->keys_len++] = field_keys[field];
+
+        tpl->ops[tpl->ops_len++] = (mqtt_topic_op_t){
+                .text_off      = run_start,
+                .text_len      = text_len - run_start,
+                .slot          = slot,
+                .leading_slash = leading_slash,
+                .def           = d_start,
+                .def_len       = d_end - d_start,
+        };
+        run_start = text_len;
+    }
+
+    // trailing text
+    tpl->ops[tpl->ops_len++] = (mqtt_topic_op_t){
+            .text_off = run_start,
+            .text_len = text_len - run_start,
+            .slot     = -1,
+    };
+    return tpl;
+}
+
+static char *append_topic(char *topic, data_t *data)
+{
+    if (data->type == DATA_STRING) {
+        for (char const *p = data->value; *p; ++p)
+            *topic++ = mqtt_sanitize_topic(*p);
+    }
+    else if (data->type == DATA_INT) {
+        topic += fmt_int(topic, *(int *)data->value);
+    }
+    else {
+        rtl433_fprintf(stderr, "Can't append data type %d to topic\n", data->type);
+    }
+
+    return topic;
+}
+
+static char *expand_topic(char *topic, mqtt_topic_t const *tpl, data_t *data)
+{
+    // collect the fields used, in one pass over the top level keys
+    data_t *fields[TOPIC_FIELDS] = {0};
+    if (tpl->keys_len) {
+        for (data_t *d = data; d; d = d->next) {
+            for (unsigned k = 0; k < tpl->keys_len; ++k) {
+                if (data_key_is(d, tpl->keys[k])) {
+                    fields[k] = d;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (mqtt_topic_op_t const *op = tpl->ops; op < tpl->ops + tpl->ops_len; ++op) {
+        memcpy(topic, &tpl->text[op->text_off], op->text_len);
+        topic += op->text_len;
+        if (op->slot < 0)
+            continue;
+
         // append token or default
-        if (!data_token && !string_token && !d_start)
+        data_t *field = fields[op->slot];
+        if (!field && !op->def)
             continue;
-        if (leading_slash)
+        if (op->leading_slash)
             *topic++ = '/';
-        if (data_token)
-            topic = append_topic(topic, data_token);
-        else if (string_token)
-            topic += sprintf(topic, "%s", string_token);
-        else
-            topic += sprintf(topic, "%.*s", (int)(d_end - d_start), d_start);
+        if (field) {
+            topic = append_topic(topic, field);
+        }
+        else {
+            memcpy(topic, op->def, op->def_len);
+            topic += op->def_len;
+        }
     }
 
     *topic = '\0';
     return topic;
 }
 
+/* MQTT printer */
+
+typedef struct {
+    data_output_t output;
+    struct mg_mgr *mgr;
+    int coalesce;
+    char *batch;          ///< messages of the current event, see mqtt_batch_t
+    size_t batch_len;
+    size_t batch_size;
+    unsigned batch_count;
+    char topic[256];
+    char hostname[64];
+    mqtt_topic_t *devices;
+    mqtt_topic_t *events;
+    mqtt_topic_t *states;
+    //char *homie;
+    //char *hass;
+} data_output_mqtt_t;
+
+/// Send the collected messages to the client.
+static void mqtt_output_flush(data_output_mqtt_t *mqtt)
+{
+    if (!mqtt->batch_count)
+        return;
+    mqtt_client_publish(mqtt->mgr, mqtt->batch, mqtt->batch_len, mqtt->batch_count);
+    mqtt->batch_len   = 0;
+    mqtt->batch_count = 0;
+}
+
+static void mqtt_output_publish(data_output_mqtt_t *mqtt, char const *topic, char const *str)
+{
+    size_t topic_len = strlen(topic) + 1;
+    size_t str_len   = strlen(str) + 1;
+
+    if (mqtt->batch_len + topic_len + str_len > mqtt->batch_size) {
+        size_t size = mqtt->batch_size ? mqtt->batch_size : 1024;
+        while (mqtt->batch_len + topic_len + str_len > size)
+            size *= 2;
+        char *batch = realloc(mqtt->batch, size);
+        if (!batch) {
+            rtl433_fprintf(stderr, "realloc() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
+            return;
+        }
+        mqtt->batch      = batch;
+        mqtt->batch_size = size;
+    }
+    memcpy(mqtt->batch + mqtt->batch_len, topic, topic_len);
+    memcpy(mqtt->batch + mqtt->batch_len + topic_len, str, str_len);
+    mqtt->batch_len += topic_len + str_len;
+    mqtt->batch_count++;
+
+    if (!mqtt->coalesce)
+        mqtt_output_flush(mqtt);
+}
+
+static void print_mqtt_array(data_output_t *output, data_array_t *array, char *format)
+{
+    data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
+
+    char *orig = mqtt->topic + strlen(mqtt->topic); // save current topic
+
+    for (int c = 0; c < array->num_values; ++c) {
+        sprintf(orig, "/%d", c);
+        print_array_value(output, array, format, c);
+    }
+    *orig = '\0'; // restore topic
+}
+
 // <prefix>[/type][/model][/subtype][/channel][/id]/battery: "OK"|"LOW"
-static void print_mqtt_data(data_output_t *output, data_t *data, char *format)
+static void print_mqtt_fields(data_output_t *output, data_t *data, char *format)
 {
     data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
 
@@ -318,32 +685,30 @@ static void print_mqtt_data(data_output_t *output, data_t *data, char *format)
         // collect well-known top level keys
         data_t *data_model = NULL;
         for (data_t *d = data; d; d = d->next) {
-            if (!strcmp(d->key, "model"))
+            if (data_key_is(d, mqtt_keys.model))
                 data_model = d;
         }
 
         // "states" topic
         if (!data_model) {
             if (mqtt->states) {
-                size_t message_size = 20000; // state message need a large buffer
-                char *message       = malloc(message_size);
-                data_print_jsons(data, message, message_size);
-                if (expand_topic(mqtt->topic, mqtt->states, data, mqtt->hostname) == NULL)
+                char const *message = data_print_jsons_cached(data, NULL);
+                if (!message)
                     return;
-                mqtt_client_publish(mqtt->mgr, mqtt->topic, message);
+                expand_topic(mqtt->topic, mqtt->states, data);
+                mqtt_output_publish(mqtt, mqtt->topic, message);
                 *mqtt->topic = '\0'; // clear topic
-                free(message);
             }
             return;
         }
 
         // "events" topic
         if (mqtt->events) {
-            char message[1024]; // we expect the biggest strings to be around 500 bytes.
-            data_print_jsons(data, message, sizeof(message));
-            if (expand_topic(mqtt->topic, mqtt->events, data, mqtt->hostname) == NULL)
+            char const *message = data_print_jsons_cached(data, NULL);
+            if (!message)
                 return;
-            mqtt_client_publish(mqtt->mgr, mqtt->topic, message);
+            expand_topic(mqtt->topic, mqtt->events, data);
+            mqtt_output_publish(mqtt, mqtt->topic, message);
             *mqtt->topic = '\0'; // clear topic
         }
 
@@ -352,16 +717,14 @@ static void print_mqtt_data(data_output_t *output, data_t *data, char *format)
             return;
         }
 
-        end = expand_topic(mqtt->topic, mqtt->devices, data, mqtt->hostname);
-        if (end == NULL)
-            return;
+        end = expand_topic(mqtt->topic, mqtt->devices, data);
     }
 
     while (data) {
-        if (!strcmp(data->key, "brand")
-                || !strcmp(data->key, "type")
-                || !strcmp(data->key, "model")
-                || !strcmp(data->key, "subtype")) {
+        if (data_key_is(data, mqtt_keys.brand)
+                || data_key_is(data, mqtt_keys.type)
+                || data_key_is(data, mqtt_keys.model)
+                || data_key_is(data, mqtt_keys.subtype)) {
             // skip, except "id", "channel"
         }
         else {
@@ -376,36 +739,37 @@ static void print_mqtt_data(data_output_t *output, data_t *data, char *format)
     *orig = '\0'; // restore topic
 }
 
+static void print_mqtt_data(data_output_t *output, data_t *data, char *format)
+{
+    data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
+
+    int top_level = !*mqtt->topic;
+    print_mqtt_fields(output, data, format);
+    if (top_level)
+        mqtt_output_flush(mqtt);
+}
+
 static void print_mqtt_string(data_output_t *output, char const *str, char *format)
 {
     data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
-    mqtt_client_publish(mqtt->mgr, mqtt->topic, str);
+    mqtt_output_publish(mqtt, mqtt->topic, str);
 }
 
 static void print_mqtt_double(data_output_t *output, double data, char *format)
 {
-    char str[20];
-    int ret = snprintf(str, 20, "%f", data);
+    char str[FMT_BUFLEN];
+    fmt_fixed(str, data, 6);
+    str[19] = '\0'; // values are limited to 19 chars, only huge ones are longer
     print_mqtt_string(output, str, format);
 }
 
 static void print_mqtt_int(data_output_t *output, int data, char *format)
 {
-    char str[20];
-    int ret = snprintf(str, 20, "%d", data);
+    char str[FMT_BUFLEN];
+    fmt_int(str, data);
     print_mqtt_string(output, str, format);
 }
 
-static void data_output_mqtt_poll(data_output_t *output)
-{
-    data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
-
-    if (!mqtt)
-        return;
-
-    mqtt_client_poll(mqtt->mgr);
-}
-
 static void data_output_mqtt_free(data_output_t *output)
 {
     data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
@@ -413,16 +777,31 @@ static void data_output_mqtt_free(data_output_t *output)
     if (!mqtt)
         return;
 
-    free(mqtt->devices);
-    free(mqtt->events);
-    free(mqtt->states);
+    mqtt_topic_free(mqtt->devices);
+    mqtt_topic_free(mqtt->events);
+    mqtt_topic_free(mqtt->states);
     //free(mqtt->homie);
     //free(mqtt->hass);
 
-    mqtt_client_free(mqtt->mgr);
+    if (mqtt->mgr)
+        mqtt_client_free(mqtt->mgr);
+    free(mqtt->batch);
     free(mqtt);
 }
 
+static data_t *data_output_mqtt_stats_data(data_output_t *output, data_t *stats)
+{
+    mqtt_stats_t ms = {0};
+    if (data_output_mqtt_stats(output, &ms))
+        return stats;
+    return data_append(stats,
+            "depth",            "", DATA_INT, ms.depth,
+            "max_depth",        "", DATA_INT, ms.max_depth,
+            "published",        "", DATA_INT, ms.published,
+            "dropped",          "", DATA_INT, ms.dropped,
+            NULL);
+}
+
 static char *mqtt_topic_default(char const *topic, char const *base, char const *suffix)
 {
     if (topic)
@@ -438,6 +817,11 @@ static char *mqtt_topic_default(char const *topic, char const *base, char const
 
 data_output_t *data_output_mqtt_create(char const *host, char const *port, char *opts, char const *dev_hint)
 {
+    if (mqtt_keys_intern()) {
+        rtl433_fprintf(stderr, "data_key_intern() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
+        return NULL; // exit(1); // Handled at caller
+    }
+
     data_output_mqtt_t *mqtt = calloc(1, sizeof(data_output_mqtt_t));
     if (!mqtt) {
         rtl433_fprintf(stderr, "calloc() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
@@ -467,9 +851,13 @@ data_output_t *data_output_mqtt_create(char const *host, char const *port, char
     char const *path_events = "events";
     char const *path_states = "states";
 
+    char *devices = NULL;
+    char *events  = NULL;
+    char *states  = NULL;
     char *user = NULL;
     char *pass = NULL;
     int retain = 0;
+    unsigned depth = MQTT_QUEUE_DEPTH;
 
     // parse auth and format options
     char *key, *val;
@@ -484,9 +872,13 @@ data_output_t *data_output_mqtt_create(char const *host, char const *port, char
             pass = val;
         else if (!strcasecmp(key, "r") || !strcasecmp(key, "retain"))
             retain = atobv(val, 1);
+        else if (!strcasecmp(key, "q") || !strcasecmp(key, "queue"))
+            depth = val ? (unsigned)strtoul(val, NULL, 10) : MQTT_QUEUE_DEPTH;
+        else if (!strcasecmp(key, "coalesce"))
+            mqtt->coalesce = atobv(val, 1);
         // Simple key-topic mapping
         else if (!strcasecmp(key, "d") || !strcasecmp(key, "devices"))
-            mqtt->devices = mqtt_topic_default(val, base_topic, path_devices);
+            devices = mqtt_topic_default(val, base_topic, path_devices);
         // deprecated, remove this
         else if (!strcasecmp(key, "c") || !strcasecmp(key, "usechannel")) {
             rtl433_fprintf(stderr, "\"usechannel=...\" has been removed. Use a topic format string:\n");
@@ -498,10 +890,10 @@ data_output_t *data_output_mqtt_create(char const *host, char const *port, char
         }
         // JSON events to single topic
         else if (!strcasecmp(key, "e") || !strcasecmp(key, "events"))
-            mqtt->events = mqtt_topic_default(val, base_topic, path_events);
+            events = mqtt_topic_default(val, base_topic, path_events);
         // JSON states to single topic
         else if (!strcasecmp(key, "s") || !strcasecmp(key, "states"))
-            mqtt->states = mqtt_topic_default(val, base_topic, path_states);
+            states = mqtt_topic_default(val, base_topic, path_states);
         // TODO: Homie Convention https://homieiot.github.io/
         //else if (!strcasecmp(key, "o") || !strcasecmp(key, "homie"))
         //    mqtt->homie = mqtt_topic_default(val, NULL, "homie"); // base topic
@@ -510,34 +902,79 @@ data_output_t *data_output_mqtt_create(char const *host, char const *port, char
         //    mqtt->hass = mqtt_topic_default(val, NULL, "homeassistant"); // discovery prefix
         else {
             rtl433_fprintf(stderr, "Invalid key \"%s\" option.\n", key);
+            free(devices);
+            free(events);
+            free(states);
+            free(mqtt);
             return NULL; // exit(1); // Handled at caller
         }
     }
 
     // Default is to use all formats
-    if (!mqtt->devices && !mqtt->events && !mqtt->states) {
-        mqtt->devices = mqtt_topic_default(NULL, base_topic, path_devices);
-        mqtt->events  = mqtt_topic_default(NULL, base_topic, path_events);
-        mqtt->states  = mqtt_topic_default(NULL, base_topic, path_states);
-    }
-    if (mqtt->devices)
-        rtl433_fprintf(stderr, "Publishing device info to MQTT topic \"%s\".\n", mqtt->devices);
-    if (mqtt->events)
-        rtl433_fprintf(stderr, "Publishing events info to MQTT topic \"%s\".\n", mqtt->events);
-    if (mqtt->states)
-        rtl433_fprintf(stderr, "Publishing states info to MQTT topic \"%s\".\n", mqtt->states);
-
-    mqtt->output.print_data   = print_mqtt_data;
-    mqtt->output.print_array  = print_mqtt_array;
-    mqtt->output.print_string = print_mqtt_string;
-    mqtt->output.print_double = print_mqtt_double;
-    mqtt->output.print_int    = print_mqtt_int;
-    mqtt->output.output_poll  = data_output_mqtt_poll;
-    mqtt->output.output_free  = data_output_mqtt_free;
-
-    mqtt->mgr = mqtt_client_init(host, port, user, pass, client_id, retain);
-    if (mqtt->mgr == NULL)
+    if (!devices && !events && !states) {
+        devices = mqtt_topic_default(NULL, base_topic, path_devices);
+        events  = mqtt_topic_default(NULL, base_topic, path_events);
+        states  = mqtt_topic_default(NULL, base_topic, path_states);
+    }
+    if (devices)
+        rtl433_fprintf(stderr, "Publishing device info to MQTT topic \"%s\".\n", devices);
+    if (events)
+        rtl433_fprintf(stderr, "Publishing events info to MQTT topic \"%s\".\n", events);
+    if (states)
+        rtl433_fprintf(stderr, "Publishing states info to MQTT topic \"%s\".\n", states);
+
+    // parse the topic formats once, expanding them is then a copy per event
+    mqtt->devices = devices ? mqtt_topic_compile(devices, mqtt->hostname) : NULL;
+    mqtt->events  = events ? mqtt_topic_compile(events, mqtt->hostname) : NULL;
+    mqtt->states  = states ? mqtt_topic_compile(states, mqtt->hostname) : NULL;
+    if ((devices && !mqtt->devices) || (events && !mqtt->events) || (states && !mqtt->states)) {
+        rtl433_fprintf(stderr, "Invalid MQTT topic format.\n");
+        data_output_mqtt_free(&mqtt->output); // frees the topics compiled so far
+        return NULL; // exit(1); // Handled at caller
+    }
+
+    mqtt->output.print_data         = print_mqtt_data;
+    mqtt->output.print_array        = print_mqtt_array;
+    mqtt->output.print_string       = print_mqtt_string;
+    mqtt->output.print_double       = print_mqtt_double;
+    mqtt->output.print_int          = print_mqtt_int;
+    mqtt->output.output_free        = data_output_mqtt_free;
+    mqtt->output.output_stats       = data_output_mqtt_stats_data;
+    mqtt->output.output_stats_reset = data_output_mqtt_stats_reset;
+
+    mqtt->mgr = mqtt_client_init(host, port, user, pass, client_id, retain, depth ? depth : 1);
+    if (mqtt->mgr == NULL) {
+        data_output_mqtt_free(&mqtt->output);
         return NULL;
+    }
 
     return &mqtt->output;
 }
+
+int data_output_mqtt_stats(data_output_t *output, mqtt_stats_t *stats)
+{
+    data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
+
+    if (!output || output->print_data != print_mqtt_data)
+        return -1;
+
+    mqtt_client_t *ctx = (mqtt_client_t *)mqtt->mgr->user_data;
+    mutex_lock(&ctx->lock);
+    *stats       = ctx->stats;
+    stats->depth = ctx->count;
+    mutex_unlock(&ctx->lock);
+    return 0;
+}
+
+void data_output_mqtt_stats_reset(data_output_t *output)
+{
+    data_output_mqtt_t *mqtt = (data_output_mqtt_t *)output;
+
+    if (!output || output->print_data != print_mqtt_data)
+        return;
+
+    mqtt_client_t *ctx = (mqtt_client_t *)mqtt->mgr->user_data;
+    mutex_lock(&ctx->lock);
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    mutex_unlock(&ctx->lock);
+}
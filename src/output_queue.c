@@ -0,0 +1,245 @@
+/** @file
+    Queued output, runs an output handler on its own thread.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "output_queue.h"
+#include "compat_thread.h"
+#include "r_util.h"
+
+typedef struct queue_entry {
+    data_t *data;
+    uint64_t queued_us;
+} queue_entry_t;
+
+typedef struct {
+    data_output_t output;
+    data_output_t *inner;
+    output_queue_policy_t policy;
+    thread_t thread;
+
+    mutex_t lock;          ///< guards everything below
+    cond_t not_empty;
+    cond_t not_full;
+    queue_entry_t *entries;
+    unsigned size;
+    unsigned head;
+    unsigned count;
+    int poll;              ///< a poll is pending
+    int exit;
+    output_queue_stats_t stats;
+} data_output_queue_t;
+
+static THREAD_RETURN THREAD_CALL queue_thread(void *arg)
+{
+    data_output_queue_t *queue = arg;
+
+    mutex_lock(&queue->lock);
+    for (;;) {
+        while (!queue->count && !queue->poll && !queue->exit)
+            cond_wait(&queue->not_empty, &queue->lock);
+
+        if (queue->poll) {
+            queue->poll = 0;
+            mutex_unlock(&queue->lock);
+            data_output_poll(queue->inner);
+            mutex_lock(&queue->lock);
+        }
+        else if (queue->count) {
+            queue_entry_t entry = queue->entries[queue->head];
+            queue->head         = (queue->head + 1) % queue->size;
+            queue->count--;
+            cond_signal(&queue->not_full);
+
+            uint64_t latency = get_time_us() - entry.queued_us;
+            queue->stats.printed++;
+            queue->stats.latency_us += latency;
+            if (queue->stats.max_latency_us < latency)
+                queue->stats.max_latency_us = latency;
+            mutex_unlock(&queue->lock);
+
+            data_output_print(queue->inner, entry.data);
+            data_free(entry.data);
+            mutex_lock(&queue->lock);
+        }
+        else {
+            break; // exit, and all events are printed
+        }
+    }
+    mutex_unlock(&queue->lock);
+    return 0;
+}
+
+static void print_queue_data(data_output_t *output, data_t *data, char *format)
+{
+    data_output_queue_t *queue = (data_output_queue_t *)output;
+    (void)format;
+
+    mutex_lock(&queue->lock);
+    if (queue->count == queue->size) {
+        if (queue->policy == QUEUE_DROP_NEWEST) {
+            queue->stats.dropped++;
+            mutex_unlock(&queue->lock);
+            return;
+        }
+        else if (queue->policy == QUEUE_DROP_OLDEST) {
+            data_free(queue->entries[queue->head].data);
+            queue->head = (queue->head + 1) % queue->size;
+            queue->count--;
+            queue->stats.dropped++;
+        }
+        else {
+            while (queue->count == queue->size)
+                cond_wait(&queue->not_full, &queue->lock);
+        }
+    }
+
+    queue_entry_t *entry = &queue->entries[(queue->head + queue->count) % queue->size];
+    entry->data          = data_retain(data);
+    entry->queued_us     = get_time_us();
+    queue->count++;
+    if (queue->stats.max_depth < queue->count)
+        queue->stats.max_depth = queue->count;
+    cond_signal(&queue->not_empty);
+    mutex_unlock(&queue->lock);
+}
+
+static void data_output_queue_poll(data_output_t *output)
+{
+    data_output_queue_t *queue = (data_output_queue_t *)output;
+
+    mutex_lock(&queue->lock);
+    if (!queue->poll) {
+        queue->poll = 1;
+        cond_signal(&queue->not_empty);
+    }
+    mutex_unlock(&queue->lock);
+}
+
+static void data_output_queue_free(data_output_t *output)
+{
+    data_output_queue_t *queue = (data_output_queue_t *)output;
+
+    if (!queue)
+        return;
+
+    mutex_lock(&queue->lock);
+    queue->exit = 1;
+    cond_signal(&queue->not_empty);
+    mutex_unlock(&queue->lock);
+    thread_join(queue->thread);
+
+    data_output_free(queue->inner);
+    cond_destroy(&queue->not_full);
+    cond_destroy(&queue->not_empty);
+    mutex_destroy(&queue->lock);
+    free(queue->entries);
+    free(queue);
+}
+
+static data_t *data_output_queue_stats_data(data_output_t *output, data_t *stats)
+{
+    data_output_queue_t *queue = (data_output_queue_t *)output;
+
+    mutex_lock(&queue->lock);
+    output_queue_stats_t qs = queue->stats;
+    qs.depth = queue->count;
+    mutex_unlock(&queue->lock);
+
+    stats = data_append(stats,
+            "depth",            "", DATA_INT, qs.depth,
+            "max_depth",        "", DATA_INT, qs.max_depth,
+            "printed",          "", DATA_INT, qs.printed,
+            "dropped",          "", DATA_INT, qs.dropped,
+            "latency_avg_ms",   "", DATA_DOUBLE, qs.printed ? qs.latency_us / 1000.0 / qs.printed : 0.0,
+            "latency_max_ms",   "", DATA_DOUBLE, qs.max_latency_us / 1000.0,
+            NULL);
+
+    // the counters of the wrapped output are safe to read from here
+    data_t *inner = data_output_stats(queue->inner, NULL);
+    if (inner)
+        stats = data_append(stats,
+                "inner",            "", DATA_DATA, inner,
+                NULL);
+    return stats;
+}
+
+static void data_output_queue_stats_clear(data_output_t *output)
+{
+    data_output_queue_t *queue = (data_output_queue_t *)output;
+
+    data_output_queue_stats_reset(output);
+    data_output_stats_reset(queue->inner);
+}
+
+data_output_t *data_output_queue_create(data_output_t *output, unsigned depth, output_queue_policy_t policy)
+{
+    // extended data points to the buffers of the decoder, those are reused before the thread prints
+    if (!output || !depth || output->ext_callback)
+        return NULL;
+
+    data_output_queue_t *queue = calloc(1, sizeof(data_output_queue_t));
+    if (!queue)
+        return NULL;
+    queue->entries = calloc(depth, sizeof(*queue->entries));
+    if (!queue->entries) {
+        free(queue);
+        return NULL;
+    }
+
+    queue->output.print_data         = print_queue_data;
+    queue->output.output_poll        = data_output_queue_poll;
+    queue->output.output_free        = data_output_queue_free;
+    queue->output.output_stats       = data_output_queue_stats_data;
+    queue->output.output_stats_reset = data_output_queue_stats_clear;
+    queue->inner                     = output;
+    queue->policy                    = policy;
+    queue->size                      = depth;
+
+    mutex_init(&queue->lock);
+    cond_init(&queue->not_empty);
+    cond_init(&queue->not_full);
+    if (thread_start(&queue->thread, queue_thread, queue)) {
+        cond_destroy(&queue->not_full);
+        cond_destroy(&queue->not_empty);
+        mutex_destroy(&queue->lock);
+        free(queue->entries);
+        free(queue);
+        return NULL;
+    }
+
+    return &queue->output;
+}
+
+int data_output_queue_stats(data_output_t *output, output_queue_stats_t *stats)
+{
+    data_output_queue_t *queue = (data_output_queue_t *)output;
+
+    if (!output || output->print_data != print_queue_data)
+        return -1;
+
+    mutex_lock(&queue->lock);
+    *stats       = queue->stats;
+    stats->depth = queue->count;
+    mutex_unlock(&queue->lock);
+    return 0;
+}
+
+void data_output_queue_stats_reset(data_output_t *output)
+{
+    data_output_queue_t *queue = (data_output_queue_t *)output;
+
+    if (!output || output->print_data != print_queue_data)
+        return;
+
+    mutex_lock(&queue->lock);
+    memset(&queue->stats, 0, sizeof(queue->stats));
+    mutex_unlock(&queue->lock);
+}
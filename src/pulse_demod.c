@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <math.h>
 #include <limits.h>
+#include <string.h>
 #include "redir_print.h"
 
 static int account_event(r_device *device, int ret)
@@ -37,6 +38,216 @@ static int account_event(r_device *device, int ret)
     return ret;
 }
 
+/// Rows in use by either bitbuffer, rows after these are cleared in both.
+static unsigned bitbuffer_rows_used(bitbuffer_t const *a, bitbuffer_t const *b)
+{
+    unsigned rows = MAX(a->num_rows, b->num_rows);
+    return MIN(rows, BITBUF_ROWS);
+}
+
+/// Copy the row counts and the first rows of a bitbuffer, the rest of dst must already match.
+static void bitbuffer_copy_rows(bitbuffer_t *dst, bitbuffer_t const *src, unsigned rows)
+{
+    dst->num_rows = src->num_rows;
+    memcpy(dst->bits_per_row, src->bits_per_row, sizeof(dst->bits_per_row));
+    memcpy(dst->syncs_before_row, src->syncs_before_row, sizeof(dst->syncs_before_row));
+    memcpy(dst->bb, src->bb, rows * sizeof(dst->bb[0]));
+}
+
+/// Compare the row counts and the first rows of two bitbuffers.
+static int bitbuffer_cmp_rows(bitbuffer_t const *a, bitbuffer_t const *b, unsigned rows)
+{
+    return a->num_rows != b->num_rows
+            || memcmp(a->bits_per_row, b->bits_per_row, sizeof(a->bits_per_row))
+            || memcmp(a->syncs_before_row, b->syncs_before_row, sizeof(a->syncs_before_row))
+            || memcmp(a->bb, b->bb, rows * sizeof(a->bb[0]));
+}
+
+/// Decode callback of a group: every member decodes the shared bits, statistics are accounted per member.
+static int demod_group_decode(r_device *device, bitbuffer_t *bits, extdata_t *ext)
+{
+    demod_group_t *group = device->decode_ctx;
+    int messages = 0;
+
+    // the demodulators hand over cleared bits, only the rows in use (now or by the last package) differ
+    unsigned bits_rows = MIN(bits->num_rows, BITBUF_ROWS);
+    bitbuffer_copy_rows(&group->work, bits, MAX(group->work_rows, bits_rows));
+    group->work_rows = bits_rows;
+    for (size_t i = 0; i < group->members.len; ++i) {
+        r_device *member = group->members.elems[i];
+        // the last member may change the demodulated bits, all others get the copy
+        bitbuffer_t *member_bits = i + 1 < group->members.len ? &group->work : bits;
+        extdata_t member_ext = *ext;
+        member_ext.bitbuffer = member_bits;
+
+        messages += account_event(member, member->decode_fn(member, member_bits, &member_ext));
+
+        // copy on write: most decoders only read the bits, and only the rows in use
+        if (member_bits == &group->work) {
+            unsigned rows = bitbuffer_rows_used(&group->work, bits);
+            if (bitbuffer_cmp_rows(&group->work, bits, rows))
+                bitbuffer_copy_rows(&group->work, bits, rows);
+        }
+    }
+    return messages;
+}
+
+#define PULSE_WIDTH_BINS 64
+
+/// Log spaced histogram bin of a width, 4 bins per octave (about 20% wide).
+static unsigned pulse_width_bin(int width)
+{
+    if (width < 4)
+        return width < 0 ? 0 : width;
+    unsigned octave = 2;
+    while (octave < 31 && width >> (octave + 1))
+        octave++;
+    unsigned bin = 4 * (octave - 1) + ((width >> (octave - 2)) & 3);
+    return bin < PULSE_WIDTH_BINS - 1 ? bin : PULSE_WIDTH_BINS - 1;
+}
+
+/// Histogram bins overlapping the open interval (lo, hi).
+static uint64_t pulse_width_bins(int lo, int hi)
+{
+    uint64_t bins = 0;
+    for (unsigned bin = 0; bin < PULSE_WIDTH_BINS; ++bin) {
+        int bin_lo, bin_hi;
+        if (bin < 4) {
+            bin_lo = bin_hi = bin;
+        }
+        else {
+            unsigned octave = bin / 4 + 1;
+            bin_lo = (4 + bin % 4) << (octave - 2);
+            bin_hi = bin == PULSE_WIDTH_BINS - 1 ? INT_MAX : ((5 + bin % 4) << (octave - 2)) - 1;
+        }
+        if (bin_hi > lo && bin_lo < hi)
+            bins |= (uint64_t)1 << bin;
+    }
+    return bins;
+}
+
+void pulse_summary(pulse_data_t const *pulses, pulse_summary_t *summary)
+{
+    summary->pulse_bins = 0;
+    summary->gap_bins   = 0;
+    for (unsigned n = 0; n < pulses->num_pulses; ++n) {
+        summary->pulse_bins |= (uint64_t)1 << pulse_width_bin(pulses->pulse[n]);
+        summary->gap_bins |= (uint64_t)1 << pulse_width_bin(pulses->gap[n]);
+    }
+}
+
+/// Acceptance windows of the demodulator, mirrors the bounds in the pulse_demod_*() functions.
+static void demod_group_windows(demod_group_t *group)
+{
+    r_device const *d = &group->device;
+    int tol           = d->s_tolerance;
+
+    group->filtered   = 1;
+    group->pulse_bins = 0;
+    group->gap_bins   = 0;
+
+    switch (d->modulation) {
+    case OOK_PULSE_PCM_RZ:
+    case FSK_PULSE_PCM:
+        if (d->s_short_width == d->s_long_width) {
+            group->filtered = 0; // NRZ, every pulse adds bits
+            break;
+        }
+        // the bits are cleared on any pulse off by more than 25% of a bit period
+        tol = d->s_long_width / 4;
+        group->pulse_bins = pulse_width_bins(d->s_short_width - tol - 1, d->s_short_width + tol + 1);
+        break;
+    case OOK_PULSE_PPM: {
+        // any short gap starts a new row, longer gaps need to match a symbol
+        int gap_max = d->s_reset_limit;
+        if (tol > 0) {
+            gap_max = MAX(gap_max, d->s_short_width + tol);
+            gap_max = MAX(gap_max, d->s_long_width + tol);
+            if (d->s_sync_width > 0)
+                gap_max = MAX(gap_max, d->s_sync_width + tol);
+        }
+        else {
+            gap_max = MAX(gap_max, (d->s_short_width + d->s_long_width) / 2 + 1);
+            gap_max = MAX(gap_max, d->s_gap_limit ? d->s_gap_limit : d->s_reset_limit);
+        }
+        group->gap_bins = pulse_width_bins(-1, gap_max);
+        break;
+    }
+    case OOK_PULSE_PWM:
+    case FSK_PULSE_PWM:
+        if (tol <= 0) {
+            group->filtered = 0; // the windows cover all pulse widths
+            break;
+        }
+        group->pulse_bins = pulse_width_bins(d->s_short_width - tol, d->s_short_width + tol)
+                | pulse_width_bins(d->s_long_width - tol, d->s_long_width + tol);
+        if (d->s_sync_width > 0)
+            group->pulse_bins |= pulse_width_bins(d->s_sync_width - tol, d->s_sync_width + tol);
+        break;
+    case OOK_PULSE_DMC:
+    case OOK_PULSE_PIWM_DC:
+        // pulses and gaps are symbols
+        group->pulse_bins = pulse_width_bins(d->s_short_width - tol, d->s_short_width + tol)
+                | pulse_width_bins(d->s_long_width - tol, d->s_long_width + tol);
+        group->gap_bins = group->pulse_bins;
+        break;
+    default:
+        group->filtered = 0; // Manchester, PIWM raw and OSV1 may decode any package
+    }
+}
+
+int demod_group_accepts(demod_group_t const *group, pulse_summary_t const *summary)
+{
+    return !group->filtered
+            || (summary->pulse_bins & group->pulse_bins)
+            || (summary->gap_bins & group->gap_bins);
+}
+
+void demod_group_init(demod_group_t *group, r_device *first)
+{
+    group->device = *first; // copy
+    group->device.name       = "demod group";
+    group->device.decode_fn  = demod_group_decode;
+    group->device.create_fn  = NULL;
+    group->device.decode_ctx = group;
+    group->device.verbose    = 0; // verbose decoders are not grouped
+    list_initialize(&group->members);
+    list_push(&group->members, first);
+    demod_group_windows(group);
+}
+
+int demod_group_matches(demod_group_t const *group, r_device const *r_dev)
+{
+    r_device const *g     = &group->device;
+    r_device const *first = group->members.elems[0];
+    return r_dev->decode_fn && first->decode_fn // without decode_fn the bits are only printed
+            && !r_dev->verbose && !first->verbose // debug output comes from the demodulator of a decoder
+            && g->modulation == r_dev->modulation
+            && g->s_short_width == r_dev->s_short_width
+            && g->s_long_width == r_dev->s_long_width
+            && g->s_reset_limit == r_dev->s_reset_limit
+            && g->s_gap_limit == r_dev->s_gap_limit
+            && g->s_sync_width == r_dev->s_sync_width
+            && g->s_tolerance == r_dev->s_tolerance
+            && g->f_short_width == r_dev->f_short_width // PCM uses the reciprocals
+            && g->f_long_width == r_dev->f_long_width;
+}
+
+r_device *demod_group_device(demod_group_t *group)
+{
+    if (group->members.len == 1)
+        return group->members.elems[0];
+    return &group->device;
+}
+
+void demod_group_free(demod_group_t *group)
+{
+    if (!group)
+        return;
+    list_free_elems(&group->members, NULL);
+    free(group);
+}
+
 int pulse_demod_pcm(const pulse_data_t *pulses, r_device *device)
 {
     int events = 0;
@@ -649,6 +860,34 @@ int pulse_demod_osv1(const pulse_data_t *pulses, r_device *device)
     return events;
 }
 
+int pulse_demod_device(const pulse_data_t *pulses, r_device *device)
+{
+    switch (device->modulation) {
+    case OOK_PULSE_PCM_RZ:
+    case FSK_PULSE_PCM:
+        return pulse_demod_pcm(pulses, device);
+    case OOK_PULSE_PPM:
+        return pulse_demod_ppm(pulses, device);
+    case OOK_PULSE_PWM:
+    case FSK_PULSE_PWM:
+        return pulse_demod_pwm(pulses, device);
+    case OOK_PULSE_MANCHESTER_ZEROBIT:
+    case FSK_PULSE_MANCHESTER_ZEROBIT:
+        return pulse_demod_manchester_zerobit(pulses, device);
+    case OOK_PULSE_PIWM_RAW:
+        return pulse_demod_piwm_raw(pulses, device);
+    case OOK_PULSE_PIWM_DC:
+        return pulse_demod_piwm_dc(pulses, device);
+    case OOK_PULSE_DMC:
+        return pulse_demod_dmc(pulses, device);
+    case OOK_PULSE_PWM_OSV1:
+        return pulse_demod_osv1(pulses, device);
+    default:
+        rtl433_fprintf(stderr, "Unknown modulation %d in protocol!\n", device->modulation);
+        return 0;
+    }
+}
+
 int pulse_demod_string(const char *code, r_device *device)
 {
     int events = 0;
@@ -18,6 +18,11 @@
 #include <string.h>
 #include "redir_print.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PD_HAVE_SSE2
+#endif
+
 void pulse_data_clear(pulse_data_t *data)
 {
     *data = (pulse_data_t const){0};
@@ -350,6 +355,13 @@ struct pulse_detect {
     int ook_high_estimate; // Estimate for the OOK high level
 
     pulse_FSK_state_t FSK_state;
+
+    uint64_t gate_samples; // Samples seen, for the energy gate stats
+    uint64_t gate_skipped; // Samples fast-forwarded by the energy gate
+
+    pulse_detect_fm_fn fm_fn; // On demand FM demodulation, if set
+    void *fm_ctx;
+    int fm_end;               // fm_data is valid up to here in the current buffer
 };
 
 pulse_detect_t *pulse_detect_create()
@@ -362,6 +374,125 @@ void pulse_detect_free(pulse_detect_t *pulse_detect)
     free(pulse_detect);
 }
 
+void pulse_detect_gate_stats(pulse_detect_t const *pulse_detect, uint64_t *samples, uint64_t *skipped)
+{
+    *samples = pulse_detect->gate_samples;
+    *skipped = pulse_detect->gate_skipped;
+}
+
+void pulse_detect_gate_stats_reset(pulse_detect_t *pulse_detect)
+{
+    pulse_detect->gate_samples = 0;
+    pulse_detect->gate_skipped = 0;
+}
+
+void pulse_detect_set_fm_source(pulse_detect_t *pulse_detect, pulse_detect_fm_fn fm_fn, void *ctx)
+{
+    pulse_detect->fm_fn  = fm_fn;
+    pulse_detect->fm_ctx = ctx;
+}
+
+#define PD_FM_SPAN 256 // Samples of fm_data requested at once in on demand mode
+
+/// Make sure fm_data is valid at the current sample.
+static inline void pulse_detect_need_fm(pulse_detect_t *s, int len)
+{
+    if (s->fm_fn && s->data_counter >= s->fm_end) {
+        int start = s->data_counter;
+        s->fm_end = MIN(start + PD_FM_SPAN, len);
+        s->fm_fn(s->fm_ctx, start, s->fm_end);
+    }
+}
+
+#define PD_GATE_BLOCK 256 // Sub-block size for the energy gate
+
+/// Default OOK high level estimate while idle, a ratio of the low level.
+static inline int ook_idle_high_estimate(int ook_low_estimate)
+{
+    int high = OOK_HIGH_LOW_RATIO * ook_low_estimate;
+    high = MAX(high, OOK_MIN_HIGH_LEVEL);
+    high = MIN(high, OOK_MAX_HIGH_LEVEL);
+    return high;
+}
+
+/// Level to exceed to start a pulse, same arithmetic as the state machine.
+static inline int ook_start_level(int ook_low_estimate, int ook_high_estimate, int16_t level_limit)
+{
+    int16_t ook_threshold = ook_low_estimate + (ook_high_estimate - ook_low_estimate) / 2;
+    if (level_limit != 0)
+        ook_threshold = level_limit;
+    return ook_threshold + ook_threshold / 8;
+}
+
+/// Length of the run of leading samples not above level, 8 samples per compare with SSE2.
+static int run_below_level(int16_t const *data, int len, int level)
+{
+    int n = 0;
+    if (level >= INT16_MAX)
+        return len;
+#ifdef PD_HAVE_SSE2
+    __m128i const lvl = _mm_set1_epi16((int16_t)MAX(level, INT16_MIN));
+    for (; n + 8 <= len; n += 8) {
+        __m128i v = _mm_loadu_si128((__m128i const *)&data[n]);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi16(v, lvl)))
+            break; // edge in these 8 samples
+    }
+#endif
+    while (n < len && data[n] <= level)
+        n++;
+    return n;
+}
+
+/** Samples of a gap that can be skipped without any state change.
+
+    In a gap the low and high estimates are constant, so is the start level.
+    The run ends at the next rising edge or where the gap becomes too long.
+*/
+static int pulse_detect_gap_run(pulse_detect_t const *s, int16_t const *am, int len, int16_t level_limit, int samples_per_ms)
+{
+    // first gap length that ends the package
+    int eop_length = MIN(MAX(PD_MAX_GAP_RATIO * s->max_pulse, PD_MIN_GAP_MS * samples_per_ms), PD_MAX_GAP_MS * samples_per_ms) + 1;
+    int max_run = eop_length - s->pulse_length - 1; // the EOP sample itself goes through the state machine
+    if (max_run <= 0)
+        return 0;
+    return run_below_level(am, MIN(len, max_run), ook_start_level(s->ook_low_estimate, s->ook_high_estimate, level_limit));
+}
+
+/** Energy gate: fast-forward an idle block that cannot start a pulse.
+
+    While idle the low estimate never drops below min(low, min(am) - 1) and the
+    start level is monotonic in the low estimate. If no sample exceeds the start
+    level at that bound the state machine would only update the noise estimate,
+    which is done here without the per sample state machine. The result is identical.
+
+    @return 1 if the block was skipped
+*/
+static int pulse_detect_gate(pulse_detect_t *s, int16_t const *am, int len, int16_t level_limit)
+{
+    int am_min = INT16_MAX;
+    int am_max = INT16_MIN;
+    for (int i = 0; i < len; i++) { // plain loop, vectorized by the compiler
+        am_min = MIN(am_min, am[i]);
+        am_max = MAX(am_max, am[i]);
+    }
+
+    int low_bound = MIN(s->ook_low_estimate, am_min - 1);
+    int start_level = ook_start_level(low_bound, ook_idle_high_estimate(low_bound), level_limit);
+    if (am_max > start_level)
+        return 0;
+
+    // Estimate low (noise) level, same as the idle state
+    int low = s->ook_low_estimate;
+    for (int i = 0; i < len; i++) {
+        int const ook_low_delta = am[i] - low;
+        low += ook_low_delta / OOK_EST_LOW_RATIO;
+        low += ((ook_low_delta > 0) ? 1 : -1);
+    }
+    s->ook_low_estimate  = low;
+    s->ook_high_estimate = ook_idle_high_estimate(low);
+    return 1;
+}
+
 /// Demodulate On/Off Keying (OOK) and Frequency Shift Keying (FSK) from an envelope signal
 int pulse_detect_package(pulse_detect_t *pulse_detect, int16_t const *envelope_data, int16_t const *fm_data, int len, int16_t level_limit, uint32_t samp_rate, uint64_t sample_offset, pulse_data_t *pulses, pulse_data_t *fsk_pulses)
 {
@@ -373,10 +504,36 @@ int pulse_detect_package(pulse_detect_t *pulse_detect, int16_t const *envelope_d
         // age the pulse_data if this is a fresh buffer
         pulses->start_ago += len;
         fsk_pulses->start_ago += len;
+        s->gate_samples += len;
+        s->fm_end = 0;
     }
 
+    int gate_next = s->data_counter; // Next position to try the energy gate at
+
     // Process all new samples
     while (s->data_counter < len) {
+        // Skip silent blocks while idle, once the noise estimate has settled
+        if (s->data_counter >= gate_next && s->ook_state == PD_OOK_STATE_IDLE
+                && s->lead_in_counter > OOK_EST_LOW_RATIO
+                && s->ook_high_estimate == ook_idle_high_estimate(s->ook_low_estimate)
+                && len - s->data_counter >= PD_GATE_BLOCK) {
+            if (pulse_detect_gate(s, &envelope_data[s->data_counter], PD_GATE_BLOCK, level_limit)) {
+                s->data_counter += PD_GATE_BLOCK;
+                s->gate_skipped += PD_GATE_BLOCK;
+                continue;
+            }
+            gate_next = s->data_counter + PD_GATE_BLOCK; // signal in this block, step through it
+        }
+
+        // Skip over gaps run by run, only the edge sample goes through the state machine
+        if (s->ook_state == PD_OOK_STATE_GAP) {
+            int run = pulse_detect_gap_run(s, &envelope_data[s->data_counter], len - s->data_counter, level_limit, samples_per_ms);
+            s->pulse_length += run;
+            s->data_counter += run;
+            if (s->data_counter >= len)
+                break;
+        }
+
         // Calculate OOK detection threshold and hysteresis
         int16_t const am_n    = envelope_data[s->data_counter];
         int16_t ook_threshold = s->ook_low_estimate + (s->ook_high_estimate - s->ook_low_estimate) / 2;
@@ -416,6 +573,7 @@ int pulse_detect_package(pulse_detect_t *pulse_detect, int16_t const *envelope_d
                 }
                 break;
             case PD_OOK_STATE_PULSE:
+                pulse_detect_need_fm(s, len);
                 s->pulse_length++;
                 // End of pulse detected?
                 if (am_n < (ook_threshold - ook_hysteresis)) {    // Gap?
@@ -446,6 +604,8 @@ int pulse_detect_package(pulse_detect_t *pulse_detect, int16_t const *envelope_d
                 }
                 break;
             case PD_OOK_STATE_GAP_START:    // Beginning of gap - it might be a spurious gap
+                if (pulses->num_pulses == 0)
+                    pulse_detect_need_fm(s, len);
                 s->pulse_length++;
                 // Pulse detected again already? (This is a spurious short gap)
                 if (am_n > (ook_threshold + ook_hysteresis)) {    // New pulse?
@@ -0,0 +1,303 @@
+/** @file
+    Binary pulse data files, and conversion to and from OOK text.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pulse_file.h"
+#include "fileformat.h"
+#include "redir_print.h"
+
+/* Encoding */
+
+static uint8_t *put_varint(uint8_t *p, uint64_t val)
+{
+    while (val >= 0x80) {
+        *p++ = (uint8_t)val | 0x80;
+        val >>= 7;
+    }
+    *p++ = (uint8_t)val;
+    return p;
+}
+
+static uint8_t *put_svarint(uint8_t *p, int64_t val)
+{
+    return put_varint(p, ((uint64_t)val << 1) ^ (uint64_t)(val >> 63));
+}
+
+static uint8_t *put_float(uint8_t *p, float val)
+{
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    for (int i = 0; i < 4; ++i)
+        *p++ = (uint8_t)(bits >> (8 * i));
+    return p;
+}
+
+/// Reads a varint, returns NULL if it runs past @p end.
+static uint8_t const *get_varint(uint8_t const *p, uint8_t const *end, uint64_t *val)
+{
+    uint64_t v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *val = v;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint8_t const *get_svarint(uint8_t const *p, uint8_t const *end, int64_t *val)
+{
+    uint64_t v;
+    p = get_varint(p, end, &v);
+    if (p)
+        *val = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    return p;
+}
+
+static uint8_t const *get_float(uint8_t const *p, uint8_t const *end, float *val)
+{
+    if (end - p < 4)
+        return NULL;
+    uint32_t bits = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    memcpy(val, &bits, sizeof(bits));
+    return p + 4;
+}
+
+/* Writer */
+
+RTL_433_API void pulse_data_print_bin_header(FILE *file)
+{
+    uint8_t header[13];
+    memcpy(header, PULSE_FILE_MAGIC, 4);
+    header[4]       = PULSE_FILE_VERSION;
+    int64_t created = (int64_t)time(NULL);
+    for (int i = 0; i < 8; ++i)
+        header[5 + i] = (uint8_t)((uint64_t)created >> (8 * i));
+    fwrite(header, 1, sizeof(header), file);
+}
+
+RTL_433_API void pulse_data_dump_bin(FILE *file, pulse_data_t const *data, int fsk, uint32_t center_frequency)
+{
+    uint8_t buf[PULSE_FILE_RECORD_MAX];
+    uint8_t *p = buf;
+
+    unsigned num_pulses = data->num_pulses < PD_MAX_PULSES ? data->num_pulses : PD_MAX_PULSES;
+    p = put_varint(p, data->offset);
+    p = put_varint(p, data->sample_rate);
+    p = put_varint(p, center_frequency);
+    p = put_svarint(p, data->ook_low_estimate);
+    p = put_svarint(p, data->ook_high_estimate);
+    p = put_svarint(p, data->fsk_f1_est);
+    p = put_svarint(p, data->fsk_f2_est);
+    p = put_float(p, data->freq1_hz);
+    p = put_float(p, data->freq2_hz);
+    p = put_float(p, data->rssi_db);
+    p = put_float(p, data->snr_db);
+    p = put_float(p, data->noise_db);
+    p = put_varint(p, num_pulses);
+    // widths repeat a lot, their differences are mostly a single byte
+    int prev_pulse = 0;
+    int prev_gap   = 0;
+    for (unsigned i = 0; i < num_pulses; ++i) {
+        p          = put_svarint(p, (int64_t)data->pulse[i] - prev_pulse);
+        p          = put_svarint(p, (int64_t)data->gap[i] - prev_gap);
+        prev_pulse = data->pulse[i];
+        prev_gap   = data->gap[i];
+    }
+
+    uint8_t head[11];
+    head[0]       = fsk ? PULSE_DATA_FSK : PULSE_DATA_OOK;
+    uint8_t *tail = put_varint(head + 1, (uint64_t)(p - buf));
+    fwrite(head, 1, tail - head, file);
+    fwrite(buf, 1, p - buf, file);
+}
+
+/* Reader */
+
+static int read_varint(FILE *file, uint64_t *val)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = getc(file);
+        if (c == EOF)
+            return -1;
+        v |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *val = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int pulse_data_load_bin(FILE *file, pulse_data_t *data, uint32_t *center_frequency)
+{
+    uint8_t buf[PULSE_FILE_RECORD_MAX];
+
+    pulse_data_clear(data);
+
+    int type;
+    while ((type = getc(file)) == PULSE_FILE_MAGIC[0]) {
+        // a file header, possibly of a concatenated file
+        uint8_t header[12];
+        if (fread(header, 1, sizeof(header), file) != sizeof(header)
+                || memcmp(header, PULSE_FILE_MAGIC + 1, 3)) {
+            rtl433_fprintf(stderr, "%s: not a binary pulse file\n", __func__);
+            return -1;
+        }
+        if (header[3] != PULSE_FILE_VERSION) {
+            rtl433_fprintf(stderr, "%s: unsupported binary pulse file version %d\n", __func__, header[3]);
+            return -1;
+        }
+    }
+    if (type == EOF)
+        return 0;
+    if (type != PULSE_DATA_OOK && type != PULSE_DATA_FSK) {
+        rtl433_fprintf(stderr, "%s: unknown record type %d\n", __func__, type);
+        return -1;
+    }
+
+    uint64_t len;
+    if (read_varint(file, &len) || len > sizeof(buf) || fread(buf, 1, (size_t)len, file) != len) {
+        rtl433_fprintf(stderr, "%s: truncated record\n", __func__);
+        return -1;
+    }
+
+    uint8_t const *p   = buf;
+    uint8_t const *end = buf + len;
+    uint64_t offset, sample_rate, frequency, num_pulses;
+    int64_t ook_low, ook_high, fsk_f1, fsk_f2;
+    p = get_varint(p, end, &offset);
+    p = p ? get_varint(p, end, &sample_rate) : NULL;
+    p = p ? get_varint(p, end, &frequency) : NULL;
+    p = p ? get_svarint(p, end, &ook_low) : NULL;
+    p = p ? get_svarint(p, end, &ook_high) : NULL;
+    p = p ? get_svarint(p, end, &fsk_f1) : NULL;
+    p = p ? get_svarint(p, end, &fsk_f2) : NULL;
+    p = p ? get_float(p, end, &data->freq1_hz) : NULL;
+    p = p ? get_float(p, end, &data->freq2_hz) : NULL;
+    p = p ? get_float(p, end, &data->rssi_db) : NULL;
+    p = p ? get_float(p, end, &data->snr_db) : NULL;
+    p = p ? get_float(p, end, &data->noise_db) : NULL;
+    p = p ? get_varint(p, end, &num_pulses) : NULL;
+    if (!p || num_pulses > PD_MAX_PULSES || !sample_rate || sample_rate > UINT32_MAX || frequency > UINT32_MAX) {
+        rtl433_fprintf(stderr, "%s: invalid record\n", __func__);
+        pulse_data_clear(data);
+        return -1;
+    }
+    data->offset            = offset;
+    data->sample_rate       = (uint32_t)sample_rate;
+    data->ook_low_estimate  = (int)ook_low;
+    data->ook_high_estimate = (int)ook_high;
+    data->fsk_f1_est        = (int)fsk_f1;
+    data->fsk_f2_est        = (int)fsk_f2;
+    if (center_frequency)
+        *center_frequency = (uint32_t)frequency;
+
+    int64_t pulse = 0;
+    int64_t gap   = 0;
+    for (unsigned i = 0; i < num_pulses; ++i) {
+        int64_t d_pulse, d_gap;
+        p = get_svarint(p, end, &d_pulse);
+        p = p ? get_svarint(p, end, &d_gap) : NULL;
+        // the widths are deltas to the previous pulse, each must stay a valid width
+        if (!p || d_pulse < -pulse || d_pulse > INT_MAX - pulse || d_gap < -gap || d_gap > INT_MAX - gap) {
+            rtl433_fprintf(stderr, "%s: invalid record\n", __func__);
+            pulse_data_clear(data);
+            return -1;
+        }
+        pulse += d_pulse;
+        gap += d_gap;
+        data->pulse[i] = (int)pulse;
+        data->gap[i]   = (int)gap;
+    }
+    data->num_pulses = (unsigned)num_pulses;
+    // any remaining bytes are fields of later versions
+    return type;
+}
+
+/* Converter */
+
+RTL_433_API int pulse_file_convert(char const *in_spec, char const *out_spec)
+{
+    file_info_t in_info  = {0};
+    file_info_t out_info = {0};
+    parse_file_info(in_spec, &in_info);
+    parse_file_info(out_spec, &out_info);
+    if ((in_info.format != PULSE_OOK && in_info.format != PULSE_BIN)
+            || (out_info.format != PULSE_OOK && out_info.format != PULSE_BIN)) {
+        rtl433_fprintf(stderr, "%s: only OOK text and binary pulse files convert (%s, %s)\n", __func__, in_spec, out_spec);
+        return -1;
+    }
+
+    FILE *in  = strcmp(in_info.path, "-") ? fopen(in_info.path, "rb") : stdin;
+    FILE *out = strcmp(out_info.path, "-") ? fopen(out_info.path, "wb") : stdout;
+    if (!in || !out) {
+        rtl433_fprintf(stderr, "%s: failed to open %s\n", __func__, !in ? in_spec : out_spec);
+        if (in && in != stdin)
+            fclose(in);
+        if (out && out != stdout)
+            fclose(out);
+        return -1;
+    }
+
+    pulse_data_t *data = malloc(sizeof(*data));
+    if (!data) {
+        rtl433_fprintf(stderr, "malloc() failed in %s() %s:%d\n", __func__, __FILE__, __LINE__);
+        if (in != stdin)
+            fclose(in);
+        if (out != stdout)
+            fclose(out);
+        return -1;
+    }
+
+    if (out_info.format == PULSE_OOK)
+        pulse_data_print_pulse_header(out);
+    else
+        pulse_data_print_bin_header(out);
+
+    int count = 0;
+    for (;;) {
+        uint32_t center_frequency = 0;
+        int fsk;
+        if (in_info.format == PULSE_OOK) {
+            pulse_data_load(in, data);
+            if (!data->num_pulses)
+                break;
+            fsk = data->fsk_f2_est != 0; // text has no record type
+        }
+        else {
+            int r = pulse_data_load_bin(in, data, &center_frequency);
+            if (r < 0)
+                count = -1;
+            if (r <= 0)
+                break;
+            fsk = r == PULSE_DATA_FSK;
+        }
+
+        if (out_info.format == PULSE_OOK)
+            pulse_data_dump(out, data);
+        else
+            pulse_data_dump_bin(out, data, fsk, center_frequency);
+        ++count;
+    }
+
+    free(data);
+    if (in != stdin)
+        fclose(in);
+    if (out != stdout)
+        fclose(out);
+    return count;
+}
@@ -21,6 +21,13 @@ void get_time_now(struct timeval *tv)
         perror("gettimeofday");
 }
 
+uint64_t get_time_us(void)
+{
+    struct timeval now;
+    get_time_now(&now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
 char *format_time_str(char *buf, char const *format, time_t time_secs)
 {
     time_t etime;